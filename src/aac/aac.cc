@@ -9,6 +9,8 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/runtime.h>
 
+#include "adts-index.h"
+
 class AACDecoder : public InputPlugin
 {
 public:
@@ -41,40 +43,6 @@ const char * const AACDecoder::mimes[] = {"audio/aac", nullptr};
  */
 #define BUFFER_SIZE (FAAD_MIN_STREAMSIZE * 16)
 
-/*
- * These routines are derived from MPlayer.
- */
-
-/// \param srate (out) sample rate
-/// \param num (out) number of audio frames in this ADTS frame
-/// \return size of the ADTS frame in bytes
-/// aac_parse_frames needs a buffer at least 8 bytes long
-int aac_parse_frame (unsigned char * buf, int *srate, int *num)
-{
-    int i = 0, sr, fl = 0;
-    static int srates[] =
-     { 96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000,
-         11025, 8000, 0, 0, 0 };
-
-    if ((buf[i] != 0xFF) || ((buf[i + 1] & 0xF6) != 0xF0))
-        return 0;
-
-/* We currently have no use for the id below.
-        id = (buf[i+1] >> 3) & 0x01;    //id=1 mpeg2, 0: mpeg4
-*/
-    sr = (buf[i + 2] >> 2) & 0x0F;
-    if (sr > 11)
-        return 0;
-    *srate = srates[sr];
-
-    fl =
-     ((buf[i + 3] & 0x03) << 11) | (buf[i + 4] << 3) | ((buf[i +
-     5] >> 5) & 0x07);
-    *num = (buf[i + 6] & 0x02) + 1;
-
-    return fl;
-}
-
 #define PROBE_DEBUG(...)
 
 /* Searches <length> bytes of data for an ADTS header.  Returns the offset of
@@ -89,7 +57,7 @@ static int find_aac_header (unsigned char * data, int length, int * size)
         if (data[offset] != 255)
             continue;
 
-        *size = aac_parse_frame (data + offset, &a, &b);
+        *size = adts_parse_header (data + offset, &a, &b);
 
         if (*size < 8)
             continue;
@@ -265,6 +233,17 @@ bool AACDecoder::read_tag (const char * filename, VFSFile & file, Tuple & tuple,
     // TODO: error handling
     calc_aac_info (file, &length, &bitrate, &samplerate, &channels);
 
+    /* an index saved during playback gives the exact length */
+    ADTSIndex index;
+    if (index.load (filename))
+    {
+        int64_t size = file.fsize ();
+        length = index.length_ms ();
+
+        if (size > 0 && length > 0)
+            bitrate = size * 8 / length;
+    }
+
     if (length > 0)
         tuple.set_int (Tuple::Length, length);
     if (bitrate > 0)
@@ -327,6 +306,54 @@ static void aac_seek (VFSFile & file, NeAACDecHandle dec, int time, int len,
     }
 }
 
+/* Seeks to <time> using a frame index.  Decoding starts at least one frame
+ * early, so that the decoder has the overlap from the previous frame.  Returns
+ * the number of samples (at the ADTS sample rate) to be dropped from the
+ * output to reach the exact position. */
+static int64_t aac_seek_indexed (VFSFile & file, NeAACDecHandle dec,
+ const ADTSIndex & index, int time, unsigned char * buf, int size, int * buflen)
+{
+    int64_t target = (int64_t) time * index.rate / 1000;
+    auto & point = index.find (aud::max (target - 2048, (int64_t) 0));
+
+    int64_t offset = point.offset, sample = point.sample;
+    int64_t prev_offset = -1, prev_sample = 0;
+
+    /* walk the frame headers up to the frame containing the target */
+    while (true)
+    {
+        unsigned char header[7];
+        int rate, blocks, frame_size;
+
+        if (file.fseek (offset, VFS_SEEK_SET) || file.fread (header, 1, 7) != 7 ||
+         ! (frame_size = adts_parse_header (header, & rate, & blocks)) ||
+         sample + 1024 * blocks > target)
+            break;
+
+        prev_offset = offset;
+        prev_sample = sample;
+        offset += frame_size;
+        sample += 1024 * blocks;
+    }
+
+    if (prev_offset >= 0)
+    {
+        offset = prev_offset;
+        sample = prev_sample;
+    }
+
+    if (file.fseek (offset, VFS_SEEK_SET))
+    {
+        * buflen = 0;
+        return 0;
+    }
+
+    * buflen = file.fread (buf, 1, size);
+    NeAACDecPostSeekReset (dec, -1);
+
+    return aud::max (target - sample, (int64_t) 0);
+}
+
 bool AACDecoder::play (const char * filename, VFSFile & file)
 {
     NeAACDecHandle decoder = 0;
@@ -337,6 +364,15 @@ bool AACDecoder::play (const char * filename, VFSFile & file)
     Tuple tuple = get_playback_tuple ();
     int bitrate = 1000 * aud::max (0, tuple.get_int (Tuple::Bitrate));
 
+    /* for exact seeking and length; built in the background unless saved */
+    ADTSIndexer indexer;
+    const ADTSIndex * index = nullptr;
+    int64_t skip = 0;
+    int skip_out = -1;
+
+    if (file.fsize () >= 0)
+        indexer.start (filename);
+
     if ((decoder = NeAACDecOpen ()) == nullptr)
     {
         AUDERR ("Open Decoder Error\n");
@@ -412,12 +448,28 @@ bool AACDecoder::play (const char * filename, VFSFile & file)
     {
         /* == HANDLE SEEK REQUESTS == */
 
+        if (! index && (index = indexer.get ()))
+        {
+            if (tuple.get_int (Tuple::Length) != index->length_ms ())
+            {
+                tuple.set_int (Tuple::Length, index->length_ms ());
+                set_playback_tuple (tuple.ref ());
+            }
+        }
+
         int seek_value = check_seek ();
 
         if (seek_value >= 0)
         {
             int length = tuple.get_int (Tuple::Length);
-            if (length > 0)
+
+            if (index)
+            {
+                skip = aac_seek_indexed (file, decoder, * index, seek_value,
+                 buf, sizeof buf, & buflen);
+                skip_out = -1;
+            }
+            else if (length > 0)
                 aac_seek (file, decoder, seek_value, length, buf, sizeof buf, & buflen);
         }
 
@@ -460,6 +512,22 @@ bool AACDecoder::play (const char * filename, VFSFile & file)
 
         /* == PLAY THE SOUND == */
 
+        if (audio && info.samples && skip > 0 && info.channels)
+        {
+            /* the output rate differs from the ADTS rate with SBR */
+            if (skip_out < 0)
+                skip_out = skip * info.samplerate / index->rate;
+
+            int drop = aud::min (skip_out, (int) (info.samples / info.channels));
+
+            audio = (float *) audio + drop * info.channels;
+            info.samples -= drop * info.channels;
+            skip_out -= drop;
+
+            if (! skip_out)
+                skip = 0;
+        }
+
         if (audio && info.samples)
             write_audio (audio, sizeof (float) * info.samples);
     }
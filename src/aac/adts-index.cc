@@ -0,0 +1,346 @@
+/*
+ * ADTS frame index for the AAC (Raw) decoder
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/runtime.h>
+#include <libaudcore/vfs.h>
+
+#include "adts-index.h"
+
+#define SCAN_BUFFER 65536
+
+/* only indexes of files at least this long are written to disk */
+#define SAVE_MIN_LENGTH (10 * 60 * 1000)
+
+static const char cache_magic[8] = {'A', 'U', 'D', 'A', 'D', 'T', 'S', '1'};
+
+int adts_parse_header (const unsigned char * buf, int * rate, int * blocks)
+{
+    static const int rates[] =
+     {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000,
+      11025, 8000};
+
+    /* 12-bit sync word, layer 0 */
+    if (buf[0] != 0xff || (buf[1] & 0xf6) != 0xf0)
+        return 0;
+
+    int sr = (buf[2] >> 2) & 0x0f;
+    if (sr >= (int) aud::n_elems (rates))
+        return 0;
+
+    int size = ((buf[3] & 0x03) << 11) | (buf[4] << 3) | (buf[5] >> 5);
+    if (size < 7)
+        return 0;
+
+    * rate = rates[sr];
+    * blocks = (buf[6] & 0x03) + 1;
+
+    return size;
+}
+
+const ADTSIndex::Point & ADTSIndex::find (int64_t sample) const
+{
+    int lo = 0, hi = points.len () - 1;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+
+        if (points[mid].sample <= sample)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return points[lo];
+}
+
+bool ADTSIndex::build (const char * filename, bool (* cancelled) (void * user),
+ void * user)
+{
+    VFSFile file (filename, "r");
+    if (! file)
+        return false;
+
+    Index<unsigned char> buf;
+    buf.resize (SCAN_BUFFER);
+
+    int64_t buf_offset = 0;  /* file offset of buf[0] */
+    int filled = file.fread (buf.begin (), 1, SCAN_BUFFER);
+    int pos = 0;
+
+    /* skip an ID3v2 tag */
+    if (filled >= 10 && ! memcmp (buf.begin (), "ID3", 3))
+        pos = 10 + (buf[6] << 21) + (buf[7] << 14) + (buf[8] << 7) + buf[9];
+
+    int64_t frames = 0;
+
+    rate = 0;
+    total_samples = 0;
+    points.clear ();
+
+    while (true)
+    {
+        /* keep at least one header in the buffer */
+        if (filled - pos < 7)
+        {
+            if (pos > filled)
+            {
+                /* the last frame reached past the end of the buffer */
+                if (file.fseek (buf_offset + pos, VFS_SEEK_SET) < 0)
+                    break;
+
+                buf_offset += pos;
+                filled = 0;
+            }
+            else
+            {
+                memmove (buf.begin (), & buf[pos], filled - pos);
+                buf_offset += pos;
+                filled -= pos;
+            }
+
+            pos = 0;
+
+            int64_t got = file.fread (& buf[filled], 1, SCAN_BUFFER - filled);
+            if (got > 0)
+                filled += got;
+
+            if (filled < 7)
+                break;
+
+            if (cancelled && cancelled (user))
+                return false;
+        }
+
+        int frame_rate, blocks;
+        int size = adts_parse_header (& buf[pos], & frame_rate, & blocks);
+
+        /* skip garbage between frames */
+        if (! size || (rate && frame_rate != rate))
+        {
+            pos ++;
+            continue;
+        }
+
+        rate = frame_rate;
+
+        if (frames % SEEK_INTERVAL == 0)
+            points.append (Point {buf_offset + pos, total_samples});
+
+        total_samples += 1024 * blocks;
+        frames ++;
+        pos += size;
+    }
+
+    AUDDBG ("Indexed %s: %ld frames, %d ms.\n", filename, (long) frames,
+     valid () ? length_ms () : -1);
+
+    return valid ();
+}
+
+/* The cache key is the file name together with its size and modification
+ * time, so that an edited file is indexed again. */
+static bool cache_key (const char * filename, int64_t & size, int64_t & mtime)
+{
+    StringBuf path = uri_to_filename (filename);
+    if (! path)
+        return false;
+
+    GStatBuf st;
+    if (g_stat (path, & st) < 0)
+        return false;
+
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+static StringBuf cache_path (const char * filename)
+{
+    StringBuf dir = filename_build ({g_get_user_cache_dir (), "audacious", "aac-index"});
+    return filename_build ({dir, str_printf ("%08x.adts", str_calc_hash (filename))});
+}
+
+/*
+ * Cache file layout (native byte order):
+ *   char magic[8], int64 size, int64 mtime, int32 name length, char name[],
+ *   int32 rate, int64 total samples, int32 point count,
+ *   then for each point: int64 offset, int64 sample
+ */
+
+bool ADTSIndex::load (const char * filename)
+{
+    int64_t size, mtime;
+    if (! cache_key (filename, size, mtime))
+        return false;
+
+    VFSFile file (filename_to_uri (cache_path (filename)), "r");
+    if (! file)
+        return false;
+
+    Index<char> data = file.read_all ();
+    const char * p = data.begin ();
+    const char * end = data.end ();
+
+    auto get = [&] (void * dest, int64_t len) {
+        if (end - p < len)
+            return false;
+        memcpy (dest, p, len);
+        p += len;
+        return true;
+    };
+
+    char magic[8];
+    int64_t cached_size, cached_mtime;
+    int32_t name_len, cached_rate, n_points;
+    int64_t cached_total;
+
+    if (! get (magic, 8) || memcmp (magic, cache_magic, 8) ||
+        ! get (& cached_size, 8) || ! get (& cached_mtime, 8) ||
+        cached_size != size || cached_mtime != mtime ||
+        ! get (& name_len, 4) || name_len != (int32_t) strlen (filename) ||
+        end - p < name_len || memcmp (p, filename, name_len))
+        return false;
+
+    p += name_len;
+
+    if (! get (& cached_rate, 4) || ! get (& cached_total, 8) ||
+        ! get (& n_points, 4) || n_points <= 0 ||
+        end - p != (int64_t) n_points * (int64_t) sizeof (Point))
+        return false;
+
+    rate = cached_rate;
+    total_samples = cached_total;
+    points.clear ();
+    points.insert (0, n_points);
+    memcpy (points.begin (), p, n_points * sizeof (Point));
+
+    AUDDBG ("Loaded ADTS index for %s.\n", filename);
+    return valid ();
+}
+
+void ADTSIndex::save (const char * filename) const
+{
+    int64_t size, mtime;
+    if (! valid () || length_ms () < SAVE_MIN_LENGTH || ! cache_key (filename, size, mtime))
+        return;
+
+    StringBuf path = cache_path (filename);
+    StringBuf dir = filename_get_parent (path);
+
+    if (g_mkdir_with_parents (dir, 0755) < 0)
+    {
+        AUDERR ("Failed to create %s: %s\n", (const char *) dir, strerror (errno));
+        return;
+    }
+
+    int32_t name_len = strlen (filename);
+    int32_t rate32 = rate;
+    int32_t n_points = points.len ();
+
+    Index<char> data;
+    data.insert (cache_magic, -1, 8);
+    data.insert ((const char *) & size, -1, 8);
+    data.insert ((const char *) & mtime, -1, 8);
+    data.insert ((const char *) & name_len, -1, 4);
+    data.insert (filename, -1, name_len);
+    data.insert ((const char *) & rate32, -1, 4);
+    data.insert ((const char *) & total_samples, -1, 8);
+    data.insert ((const char *) & n_points, -1, 4);
+    data.insert ((const char *) points.begin (), -1, n_points * sizeof (Point));
+
+    VFSFile file (filename_to_uri (path), "w");
+    if (! file || file.fwrite (data.begin (), 1, data.len ()) != data.len ())
+        AUDERR ("Failed to write %s.\n", (const char *) path);
+}
+
+void ADTSIndexer::start (const char * filename)
+{
+    stop ();
+
+    m_filename = String (filename);
+    m_cancel = false;
+    m_done = m_index.load (filename);
+
+    /* only local files are scanned; a stream would have to be downloaded */
+    if (! m_done && ! strncmp (filename, "file://", 7))
+        m_running = ! pthread_create (& m_thread, nullptr, run, this);
+}
+
+void ADTSIndexer::stop ()
+{
+    if (m_running)
+    {
+        pthread_mutex_lock (& m_mutex);
+        m_cancel = true;
+        pthread_mutex_unlock (& m_mutex);
+
+        pthread_join (m_thread, nullptr);
+        m_running = false;
+    }
+
+    m_done = false;
+    m_index = ADTSIndex ();
+}
+
+const ADTSIndex * ADTSIndexer::get ()
+{
+    pthread_mutex_lock (& m_mutex);
+    bool done = m_done;
+    pthread_mutex_unlock (& m_mutex);
+
+    return done ? & m_index : nullptr;
+}
+
+bool ADTSIndexer::cancelled (void * data)
+{
+    auto self = (ADTSIndexer *) data;
+
+    pthread_mutex_lock (& self->m_mutex);
+    bool cancel = self->m_cancel;
+    pthread_mutex_unlock (& self->m_mutex);
+
+    return cancel;
+}
+
+void * ADTSIndexer::run (void * data)
+{
+    auto self = (ADTSIndexer *) data;
+
+    ADTSIndex index;
+    if (! index.build (self->m_filename, cancelled, self))
+        return nullptr;
+
+    index.save (self->m_filename);
+
+    pthread_mutex_lock (& self->m_mutex);
+    self->m_index = std::move (index);
+    self->m_done = true;
+    pthread_mutex_unlock (& self->m_mutex);
+
+    return nullptr;
+}
@@ -0,0 +1,94 @@
+/*
+ * ADTS frame index for the AAC (Raw) decoder
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef AAC_ADTS_INDEX_H
+#define AAC_ADTS_INDEX_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <libaudcore/index.h>
+#include <libaudcore/objects.h>
+
+/* Parses the ADTS header at <buf> (at least 7 bytes).  Returns the size of
+ * the frame in bytes, or 0 if there is no valid header.  <rate> is set to the
+ * sample rate and <blocks> to the number of raw data blocks (of 1024 samples
+ * each) in the frame. */
+int adts_parse_header (const unsigned char * buf, int * rate, int * blocks);
+
+/* Position of every SEEK_INTERVAL-th ADTS frame in a file.  Sample numbers
+ * count at the rate given in the ADTS headers; with SBR the decoder outputs
+ * twice as many samples, but the times are the same. */
+struct ADTSIndex
+{
+    static constexpr int SEEK_INTERVAL = 32;
+
+    struct Point {
+        int64_t offset, sample;
+    };
+
+    int rate = 0;
+    int64_t total_samples = 0;
+    Index<Point> points;
+
+    bool valid () const
+        { return rate > 0 && total_samples > 0 && points.len () > 0; }
+    int length_ms () const
+        { return total_samples * 1000 / rate; }
+
+    /* the last point at or before <sample> */
+    const Point & find (int64_t sample) const;
+
+    /* scans the frame headers of a file without decoding anything; stops
+     * early (returning false) if <cancelled> returns true */
+    bool build (const char * filename, bool (* cancelled) (void * user) = nullptr,
+     void * user = nullptr);
+
+    /* persistent copy, kept for long files only */
+    bool load (const char * filename);
+    void save (const char * filename) const;
+};
+
+/* Builds an index on a background thread while the file is playing. */
+class ADTSIndexer
+{
+public:
+    ~ADTSIndexer () { stop (); }
+
+    void start (const char * filename);
+    void stop ();
+
+    /* returns the finished index, or nullptr if it is not ready (yet) */
+    const ADTSIndex * get ();
+
+private:
+    static void * run (void * data);
+    static bool cancelled (void * data);
+
+    pthread_mutex_t m_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_t m_thread;
+    bool m_running = false;
+    bool m_cancel = false;
+    bool m_done = false;
+
+    String m_filename;
+    ADTSIndex m_index;
+};
+
+#endif // AAC_ADTS_INDEX_H
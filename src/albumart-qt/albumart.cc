@@ -17,18 +17,29 @@
  * the use of this software.
  */
 
+#include <pthread.h>
+#include <string.h>
+
 #include <QApplication>
+#include <QBuffer>
+#include <QImageReader>
 #include <QLabel>
 #include <QPixmap>
 
 #include <libaudcore/drct.h>
 #include <libaudcore/i18n.h>
+#include <libaudcore/mainloop.h>
+#include <libaudcore/playlist.h>
 #include <libaudcore/plugin.h>
+#include <libaudcore/probe.h>
 #include <libaudcore/hook.h>
+#include <libaudcore/runtime.h>
 #include <libaudcore/templates.h>
 
 #include <libaudqt/libaudqt.h>
 
+#include "../decoder-common/playlist-next.h"
+
 class AlbumArtQt : public GeneralPlugin {
 public:
     static constexpr PluginInfo info = {
@@ -40,9 +51,226 @@ public:
     };
 
     constexpr AlbumArtQt () : GeneralPlugin (info, false) {}
+    void cleanup ();
     void * get_qt_widget ();
 };
 
+/* decoded art is kept at the smallest of these sizes that covers the widget */
+static const int art_buckets[] = {256, 512, 1024, 2048};
+static constexpr int ART_CACHE_SIZE = 8;
+static constexpr int MAX_PENDING_JOBS = 4;
+
+static int bucket_for (int size)
+{
+    for (int bucket : art_buckets)
+    {
+        if (bucket >= size)
+            return bucket;
+    }
+
+    return art_buckets[aud::n_elems (art_buckets) - 1];
+}
+
+/* identifies art by a sampled hash and the length of the data */
+struct ArtKey {
+    unsigned hash;
+    int len;
+
+    bool operator== (const ArtKey & b) const
+        { return hash == b.hash && len == b.len; }
+};
+
+/* samples the data rather than hashing all of it, since embedded art can be
+ * several megabytes; tracks from one album usually share identical art */
+static ArtKey art_key (const Index<char> & data)
+{
+    unsigned hash = 0;
+    int step = aud::max (data.len () / 4096, 1);
+
+    for (int i = 0; i < data.len (); i += step)
+        hash = hash * 31 + (unsigned char) data[i];
+
+    return {hash, data.len ()};
+}
+
+static QImage decode_art (QByteArray & data, int bucket)
+{
+    QBuffer buffer (& data);
+    QImageReader reader (& buffer);
+
+    QSize size = reader.size ();
+    if (size.isValid () && (size.width () > bucket || size.height () > bucket))
+        reader.setScaledSize (size.scaled (bucket, bucket, Qt::KeepAspectRatio));
+
+    QImage image = reader.read ();
+
+    /* in case the reader could not tell the size in advance */
+    if (image.width () > bucket || image.height () > bucket)
+        image = image.scaled (bucket, bucket, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    return image;
+}
+
+struct DecodedArt {
+    ArtKey key;
+    int bucket;
+    QImage image;  /* null if the art could not be decoded */
+};
+
+struct DecodeJob {
+    ArtKey key;
+    int bucket;
+    QByteArray data;
+};
+
+/* decodes and downscales art on a worker thread and keeps the most recently
+ * used results */
+class ArtDecoder {
+public:
+    void request (const ArtKey & key, int bucket, const Index<char> & data);
+    const DecodedArt * lookup (const ArtKey & key, int bucket);
+    const QImage * lookup_any (const ArtKey & key);
+    void stop ();
+
+private:
+    static void * worker (void * me)
+        { ((ArtDecoder *) me)->run (); return nullptr; }
+    static void deliver_cb (void * me)
+        { ((ArtDecoder *) me)->deliver (); }
+
+    void run ();
+    void deliver ();
+
+    pthread_mutex_t m_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t m_cond = PTHREAD_COND_INITIALIZER;
+    pthread_t m_thread;
+    bool m_running = false, m_quit = false;
+
+    Index<DecodeJob> m_jobs;   // guarded by m_mutex
+    Index<DecodedArt> m_done;  // guarded by m_mutex
+    Index<DecodedArt> m_cache; // main thread only, most recently used last
+    QueuedFunc m_deliver;
+};
+
+static ArtDecoder decoder;
+
+void ArtDecoder::request (const ArtKey & key, int bucket, const Index<char> & data)
+{
+    if (lookup (key, bucket))
+        return;
+
+    pthread_mutex_lock (& m_mutex);
+
+    for (auto & job : m_jobs)
+    {
+        if (job.key == key && job.bucket == bucket)
+        {
+            pthread_mutex_unlock (& m_mutex);
+            return;
+        }
+    }
+
+    /* stale requests (e.g. from a quick series of resizes) are dropped */
+    if (m_jobs.len () >= MAX_PENDING_JOBS)
+        m_jobs.remove (0, 1);
+
+    m_jobs.append (DecodeJob {key, bucket, QByteArray (data.begin (), data.len ())});
+
+    if (! m_running)
+    {
+        m_quit = false;
+        m_running = ! pthread_create (& m_thread, nullptr, worker, this);
+    }
+
+    pthread_cond_signal (& m_cond);
+    pthread_mutex_unlock (& m_mutex);
+}
+
+/* a failed decode matches any size, since a larger one would fail too */
+const DecodedArt * ArtDecoder::lookup (const ArtKey & key, int bucket)
+{
+    for (int i = 0; i < m_cache.len (); i ++)
+    {
+        if (m_cache[i].key == key && (m_cache[i].bucket == bucket || m_cache[i].image.isNull ()))
+        {
+            /* move to the most recently used end */
+            if (i < m_cache.len () - 1)
+            {
+                DecodedArt art = std::move (m_cache[i]);
+                m_cache.remove (i, 1);
+                m_cache.append (std::move (art));
+            }
+
+            return & m_cache[m_cache.len () - 1];
+        }
+    }
+
+    return nullptr;
+}
+
+/* returns the largest cached size of the given art, as a placeholder */
+const QImage * ArtDecoder::lookup_any (const ArtKey & key)
+{
+    const QImage * best = nullptr;
+
+    for (auto & art : m_cache)
+    {
+        if (art.key == key && ! art.image.isNull () && (! best || art.image.width () > best->width ()))
+            best = & art.image;
+    }
+
+    return best;
+}
+
+void ArtDecoder::run ()
+{
+    pthread_mutex_lock (& m_mutex);
+
+    while (! m_quit)
+    {
+        if (! m_jobs.len ())
+        {
+            pthread_cond_wait (& m_cond, & m_mutex);
+            continue;
+        }
+
+        /* the newest request is the one most likely to be shown */
+        DecodeJob job = std::move (m_jobs[m_jobs.len () - 1]);
+        m_jobs.remove (m_jobs.len () - 1, 1);
+
+        pthread_mutex_unlock (& m_mutex);
+        QImage image = decode_art (job.data, job.bucket);
+        pthread_mutex_lock (& m_mutex);
+
+        /* failures are delivered too, so that the fallback image is shown */
+        if (image.isNull ())
+            AUDWARN ("Failed to decode album art.\n");
+
+        m_done.append (DecodedArt {job.key, job.bucket, std::move (image)});
+        m_deliver.queue (deliver_cb, this);
+    }
+
+    pthread_mutex_unlock (& m_mutex);
+}
+
+void ArtDecoder::stop ()
+{
+    pthread_mutex_lock (& m_mutex);
+    m_quit = true;
+    pthread_cond_signal (& m_cond);
+    pthread_mutex_unlock (& m_mutex);
+
+    if (m_running)
+        pthread_join (m_thread, nullptr);
+
+    m_running = false;
+    m_deliver.stop ();
+
+    m_jobs.clear ();
+    m_done.clear ();
+    m_cache.clear ();
+}
+
 class ArtLabel : public QLabel {
 public:
 #if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
@@ -63,19 +291,49 @@ public:
         init ();
     }
 
+    ~ArtLabel ()
+    {
+        if (s_instance == this)
+            s_instance = nullptr;
+    }
+
+    static ArtLabel * instance () { return s_instance; }
+
     void update_art ()
     {
-        origPixmap = QPixmap (audqt::art_request_current (0, 0));
-        qreal r = qApp->devicePixelRatio ();
-        origPixmap.setDevicePixelRatio (r);
-        origSize = origPixmap.size ();
-        drawArt ();
+        m_file = aud_drct_get_filename ();
+        m_art = m_file ? aud_art_request (m_file, AUD_ART_DATA) : AudArtPtr ();
+
+        if (m_art && aud_art_data (m_art.get ()))
+        {
+            m_key = art_key (* aud_art_data (m_art.get ()));
+            m_bucket = 0;
+            show_decoded ();
+        }
+        else
+        {
+            /* no art (or not loaded yet) */
+            m_art = AudArtPtr ();
+            show_fallback ();
+        }
+
+        prefetch_next ();
+    }
+
+    void art_decoded ()
+    {
+        if (m_art)
+            show_decoded ();
     }
 
     void clear ()
     {
         QLabel::clear ();
         origPixmap = QPixmap ();
+        m_file = String ();
+        m_art = AudArtPtr ();
+        m_next_file = String ();
+        m_next_art = AudArtPtr ();
     }
 
 protected:
@@ -83,6 +341,13 @@ protected:
     {
         QLabel::resizeEvent (event);
 
+        /* a bigger widget may need art from a larger size bucket */
+        if (m_art && target_bucket () != m_bucket)
+        {
+            show_decoded ();
+            return;
+        }
+
 #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
         QPixmap pm = pixmap (Qt::ReturnByValue);
         if (! origPixmap.isNull () && ! pm.isNull () &&
@@ -105,15 +370,26 @@ protected:
 private:
     static constexpr int MARGIN = 4;
 
+    static ArtLabel * s_instance;
+
     const HookReceiver<ArtLabel>
         update_hook{"playback ready", this, &ArtLabel::update_art},
         clear_hook{"playback stop", this, &ArtLabel::clear};
+    const HookReceiver<ArtLabel, const char *>
+        art_hook{"art ready", this, &ArtLabel::art_ready};
 
     QPixmap origPixmap;
     QSize origSize;
 
+    String m_file, m_next_file;
+    AudArtPtr m_art, m_next_art;
+    ArtKey m_key = ArtKey ();
+    int m_bucket = 0;
+
     void init ()
     {
+        s_instance = this;
+
         clear ();
         setMinimumSize (MARGIN + 1, MARGIN + 1);
         setAlignment (Qt::AlignCenter);
@@ -122,6 +398,86 @@ private:
             update_art();
     }
 
+    void show_fallback ()
+    {
+        origPixmap = QPixmap (audqt::art_request_current (0, 0));
+        qreal r = qApp->devicePixelRatio ();
+        origPixmap.setDevicePixelRatio (r);
+        origSize = origPixmap.size ();
+        drawArt ();
+    }
+
+    int target_bucket ()
+    {
+        qreal r = qApp->devicePixelRatio ();
+        return bucket_for (r * aud::max (size ().width (), size ().height ()));
+    }
+
+    /* shows the current art from the cache, requesting it at the needed size
+     * if necessary; a cached smaller size stands in until then.  Art that
+     * could not be decoded is replaced by the fallback image. */
+    void show_decoded ()
+    {
+        m_bucket = target_bucket ();
+
+        const DecodedArt * art = decoder.lookup (m_key, m_bucket);
+        const QImage * image;
+
+        if (art)
+            image = & art->image;
+        else
+        {
+            decoder.request (m_key, m_bucket, * aud_art_data (m_art.get ()));
+            image = decoder.lookup_any (m_key);
+        }
+
+        if (art && image->isNull ())
+        {
+            show_fallback ();
+            return;
+        }
+
+        if (! image)
+            return;
+
+        origPixmap = QPixmap::fromImage (* image);
+        qreal r = qApp->devicePixelRatio ();
+        origPixmap.setDevicePixelRatio (r);
+        origSize = origPixmap.size ();
+        drawArt ();
+    }
+
+    /* decodes the art of the track expected to play next, so that the
+     * switch is instant */
+    void prefetch_next ()
+    {
+        String next = playlist_next_filename ();
+
+        if (next != m_next_file)
+        {
+            m_next_file = next;
+            m_next_art = AudArtPtr ();
+        }
+
+        if (! m_next_file || m_next_file == m_file)
+            return;
+
+        if (! m_next_art)
+            m_next_art = aud_art_request (m_next_file, AUD_ART_DATA);
+
+        auto data = m_next_art ? aud_art_data (m_next_art.get ()) : nullptr;
+        if (data)
+            decoder.request (art_key (* data), target_bucket (), * data);
+    }
+
+    void art_ready (const char * file)
+    {
+        if (m_file && ! m_art && ! strcmp (file, m_file))
+            update_art ();
+        else if (m_next_file && ! strcmp (file, m_next_file))
+            prefetch_next ();
+    }
+
     void drawArt ()
     {
         qreal r = qApp->devicePixelRatio();
@@ -149,6 +505,41 @@ private:
     }
 };
 
+ArtLabel * ArtLabel::s_instance = nullptr;
+
+void ArtDecoder::deliver ()
+{
+    pthread_mutex_lock (& m_mutex);
+
+    for (auto & art : m_done)
+    {
+        for (int i = 0; i < m_cache.len (); i ++)
+        {
+            if (m_cache[i].key == art.key && m_cache[i].bucket == art.bucket)
+            {
+                m_cache.remove (i, 1);
+                break;
+            }
+        }
+
+        m_cache.append (std::move (art));
+    }
+
+    m_done.clear ();
+    pthread_mutex_unlock (& m_mutex);
+
+    if (m_cache.len () > ART_CACHE_SIZE)
+        m_cache.remove (0, m_cache.len () - ART_CACHE_SIZE);
+
+    if (ArtLabel::instance ())
+        ArtLabel::instance ()->art_decoded ();
+}
+
+void AlbumArtQt::cleanup ()
+{
+    decoder.stop ();
+}
+
 void * AlbumArtQt::get_qt_widget ()
 {
     return new ArtLabel;
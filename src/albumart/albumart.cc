@@ -17,13 +17,22 @@
  * the use of this software.
  */
 
+#include <pthread.h>
+#include <string.h>
+
 #include <libaudcore/drct.h>
 #include <libaudcore/i18n.h>
+#include <libaudcore/mainloop.h>
+#include <libaudcore/playlist.h>
 #include <libaudcore/plugin.h>
+#include <libaudcore/probe.h>
 #include <libaudcore/hook.h>
+#include <libaudcore/runtime.h>
 #include <libaudgui/libaudgui.h>
 #include <libaudgui/libaudgui-gtk.h>
 
+#include "../decoder-common/playlist-next.h"
+
 class AlbumArtPlugin : public GeneralPlugin
 {
 public:
@@ -37,44 +46,387 @@ public:
 
     constexpr AlbumArtPlugin () : GeneralPlugin (info, false) {}
 
+    void cleanup ();
     void * get_gtk_widget ();
 };
 
 EXPORT AlbumArtPlugin aud_plugin_instance;
 
+/* decoded art is kept at the smallest of these sizes that covers the widget */
+static const int art_buckets[] = {256, 512, 1024, 2048};
+static constexpr int ART_CACHE_SIZE = 8;
+static constexpr int MAX_PENDING_JOBS = 4;
+
+/* identifies art by a sampled hash and the length of the data */
+struct ArtKey {
+    unsigned hash;
+    int len;
+
+    bool operator== (const ArtKey & b) const
+        { return hash == b.hash && len == b.len; }
+};
+
+struct DecodedArt {
+    ArtKey key;
+    int bucket;
+    AudguiPixbuf pixbuf;  /* null if the art could not be decoded */
+};
+
+struct DecodeJob {
+    ArtKey key;
+    int bucket;
+    Index<char> data;
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static pthread_t decode_thread;
+static bool decode_running, decode_quit;
+
+static Index<DecodeJob> decode_jobs;  /* guarded by mutex */
+static Index<DecodedArt> decode_done; /* guarded by mutex */
+static Index<DecodedArt> art_cache;   /* main thread only, most recently used last */
+static QueuedFunc deliver_func;
+
+static GtkWidget * art_widget;
+static String current_file, next_file;
+static AudArtPtr current_art, next_art;
+static ArtKey current_key;
+static int current_bucket;
+
+static void show_decoded ();
+static void deliver_decoded (void *) { show_decoded (); }
+
+static int bucket_for (int size)
+{
+    for (int bucket : art_buckets)
+    {
+        if (bucket >= size)
+            return bucket;
+    }
+
+    return art_buckets[aud::n_elems (art_buckets) - 1];
+}
+
+static int target_bucket ()
+{
+    GtkAllocation alloc;
+    gtk_widget_get_allocation (art_widget, & alloc);
+
+    int size = aud::max (alloc.width, alloc.height);
+#ifdef USE_GTK3
+    size *= gtk_widget_get_scale_factor (art_widget);
+#endif
+
+    return bucket_for (size);
+}
+
+/* samples the data rather than hashing all of it, since embedded art can be
+ * several megabytes; tracks from one album usually share identical art */
+static ArtKey art_key (const Index<char> & data)
+{
+    unsigned hash = 0;
+    int step = aud::max (data.len () / 4096, 1);
+
+    for (int i = 0; i < data.len (); i += step)
+        hash = hash * 31 + (unsigned char) data[i];
+
+    return {hash, data.len ()};
+}
+
+static void size_prepared (GdkPixbufLoader * loader, int width, int height, void * user)
+{
+    int bucket = aud::from_ptr<int> (user);
+
+    if (width > bucket || height > bucket)
+    {
+        float scale = aud::min ((float) bucket / width, (float) bucket / height);
+        gdk_pixbuf_loader_set_size (loader, aud::max ((int) (width * scale), 1),
+         aud::max ((int) (height * scale), 1));
+    }
+}
+
+/* the loader downscales while decoding where the format allows it */
+static AudguiPixbuf decode_art (const Index<char> & data, int bucket)
+{
+    GdkPixbufLoader * loader = gdk_pixbuf_loader_new ();
+    g_signal_connect (loader, "size-prepared", (GCallback) size_prepared, aud::to_ptr (bucket));
+
+    bool ok = gdk_pixbuf_loader_write (loader, (const unsigned char *) data.begin (),
+     data.len (), nullptr);
+    ok = gdk_pixbuf_loader_close (loader, nullptr) && ok;
+
+    AudguiPixbuf pixbuf;
+    if (ok && gdk_pixbuf_loader_get_pixbuf (loader))
+        pixbuf.capture ((GdkPixbuf *) g_object_ref (gdk_pixbuf_loader_get_pixbuf (loader)));
+
+    g_object_unref (loader);
+    return pixbuf;
+}
+
+static void * decode_worker (void *)
+{
+    pthread_mutex_lock (& mutex);
+
+    while (! decode_quit)
+    {
+        if (! decode_jobs.len ())
+        {
+            pthread_cond_wait (& cond, & mutex);
+            continue;
+        }
+
+        /* the newest request is the one most likely to be shown */
+        DecodeJob job = std::move (decode_jobs[decode_jobs.len () - 1]);
+        decode_jobs.remove (decode_jobs.len () - 1, 1);
+
+        pthread_mutex_unlock (& mutex);
+        AudguiPixbuf pixbuf = decode_art (job.data, job.bucket);
+        pthread_mutex_lock (& mutex);
+
+        /* failures are delivered too, so that the fallback image is shown */
+        if (! pixbuf)
+            AUDWARN ("Failed to decode album art.\n");
+
+        decode_done.append (DecodedArt {job.key, job.bucket, std::move (pixbuf)});
+        deliver_func.queue (deliver_decoded, nullptr);
+    }
+
+    pthread_mutex_unlock (& mutex);
+    return nullptr;
+}
+
+/* a failed decode matches any size, since a larger one would fail too */
+static DecodedArt * cache_lookup (const ArtKey & key, int bucket)
+{
+    for (int i = 0; i < art_cache.len (); i ++)
+    {
+        if (art_cache[i].key == key && (art_cache[i].bucket == bucket || ! art_cache[i].pixbuf))
+        {
+            /* move to the most recently used end */
+            if (i < art_cache.len () - 1)
+            {
+                DecodedArt art = std::move (art_cache[i]);
+                art_cache.remove (i, 1);
+                art_cache.append (std::move (art));
+            }
+
+            return & art_cache[art_cache.len () - 1];
+        }
+    }
+
+    return nullptr;
+}
+
+/* returns the largest cached size of the given art, as a placeholder */
+static GdkPixbuf * cache_lookup_any (const ArtKey & key)
+{
+    GdkPixbuf * best = nullptr;
+
+    for (auto & art : art_cache)
+    {
+        if (art.key == key && art.pixbuf && (! best ||
+         gdk_pixbuf_get_width (art.pixbuf.get ()) > gdk_pixbuf_get_width (best)))
+            best = art.pixbuf.get ();
+    }
+
+    return best;
+}
+
+static void request_decode (const ArtKey & key, int bucket, const Index<char> & data)
+{
+    if (cache_lookup (key, bucket))
+        return;
+
+    pthread_mutex_lock (& mutex);
+
+    for (auto & job : decode_jobs)
+    {
+        if (job.key == key && job.bucket == bucket)
+        {
+            pthread_mutex_unlock (& mutex);
+            return;
+        }
+    }
+
+    /* stale requests (e.g. from a quick series of resizes) are dropped */
+    if (decode_jobs.len () >= MAX_PENDING_JOBS)
+        decode_jobs.remove (0, 1);
+
+    Index<char> copy;
+    copy.insert (data.begin (), 0, data.len ());
+    decode_jobs.append (DecodeJob {key, bucket, std::move (copy)});
+
+    if (! decode_running)
+    {
+        decode_quit = false;
+        decode_running = ! pthread_create (& decode_thread, nullptr, decode_worker, nullptr);
+    }
+
+    pthread_cond_signal (& cond);
+    pthread_mutex_unlock (& mutex);
+}
+
+/* shows the current art from the cache, requesting it at the needed size if
+ * necessary; a cached smaller size stands in until then.  Art that could not
+ * be decoded is replaced by the fallback image. */
+static void show_decoded ()
+{
+    pthread_mutex_lock (& mutex);
+
+    for (auto & art : decode_done)
+    {
+        for (int i = 0; i < art_cache.len (); i ++)
+        {
+            if (art_cache[i].key == art.key && art_cache[i].bucket == art.bucket)
+            {
+                art_cache.remove (i, 1);
+                break;
+            }
+        }
+
+        art_cache.append (std::move (art));
+    }
+
+    decode_done.clear ();
+    pthread_mutex_unlock (& mutex);
+
+    if (art_cache.len () > ART_CACHE_SIZE)
+        art_cache.remove (0, art_cache.len () - ART_CACHE_SIZE);
+
+    if (! art_widget || ! current_art)
+        return;
+
+    current_bucket = target_bucket ();
+
+    DecodedArt * art = cache_lookup (current_key, current_bucket);
+    GdkPixbuf * pixbuf;
+
+    if (art)
+        pixbuf = art->pixbuf.get ();
+    else
+    {
+        request_decode (current_key, current_bucket, * aud_art_data (current_art.get ()));
+        pixbuf = cache_lookup_any (current_key);
+    }
+
+    if (pixbuf)
+        audgui_scaled_image_set (art_widget, pixbuf);
+    else if (art)
+        audgui_scaled_image_set (art_widget, audgui_pixbuf_fallback ().get ());
+}
+
+/* decodes the art of the track expected to play next, so that the switch is
+ * instant */
+static void prefetch_next ()
+{
+    String next = playlist_next_filename ();
+
+    if (next != next_file)
+    {
+        next_file = next;
+        next_art = AudArtPtr ();
+    }
+
+    if (! next_file || next_file == current_file)
+        return;
+
+    if (! next_art)
+        next_art = aud_art_request (next_file, AUD_ART_DATA);
+
+    auto data = next_art ? aud_art_data (next_art.get ()) : nullptr;
+    if (data)
+        request_decode (art_key (* data), target_bucket (), * data);
+}
+
 static void album_update (void *, GtkWidget * widget)
 {
-    AudguiPixbuf pixbuf = audgui_pixbuf_request_current ();
+    current_file = aud_drct_get_filename ();
+    current_art = current_file ? aud_art_request (current_file, AUD_ART_DATA) : AudArtPtr ();
 
-    if (! pixbuf)
-        pixbuf = audgui_pixbuf_fallback ();
+    if (current_art && aud_art_data (current_art.get ()))
+    {
+        current_key = art_key (* aud_art_data (current_art.get ()));
+        show_decoded ();
+    }
+    else
+    {
+        /* no art (or not loaded yet); show the fallback image */
+        current_art = AudArtPtr ();
+        audgui_scaled_image_set (widget, audgui_pixbuf_fallback ().get ());
+    }
 
-    audgui_scaled_image_set (widget, pixbuf.get ());
+    prefetch_next ();
 }
 
 static void album_clear (void *, GtkWidget * widget)
 {
+    current_file = String ();
+    current_art = AudArtPtr ();
+    next_file = String ();
+    next_art = AudArtPtr ();
+
     audgui_scaled_image_set (widget, nullptr);
 }
 
+static void album_art_ready (const char * file, GtkWidget * widget)
+{
+    if (current_file && ! current_art && ! strcmp (file, current_file))
+        album_update (nullptr, widget);
+    else if (next_file && ! strcmp (file, next_file))
+        prefetch_next ();
+}
+
+/* a bigger widget may need art from a larger size bucket */
+static void album_size_allocate (GtkWidget * widget)
+{
+    if (current_art && target_bucket () != current_bucket)
+        show_decoded ();
+}
+
 static void album_cleanup (GtkWidget * widget)
 {
     hook_dissociate ("playback ready", (HookFunction) album_update, widget);
     hook_dissociate ("playback stop", (HookFunction) album_clear, widget);
+    hook_dissociate ("art ready", (HookFunction) album_art_ready, widget);
+
+    album_clear (nullptr, widget);
+    art_widget = nullptr;
 
     audgui_cleanup ();
 }
 
+void AlbumArtPlugin::cleanup ()
+{
+    pthread_mutex_lock (& mutex);
+    decode_quit = true;
+    pthread_cond_signal (& cond);
+    pthread_mutex_unlock (& mutex);
+
+    if (decode_running)
+        pthread_join (decode_thread, nullptr);
+
+    decode_running = false;
+    deliver_func.stop ();
+
+    decode_jobs.clear ();
+    decode_done.clear ();
+    art_cache.clear ();
+}
+
 void * AlbumArtPlugin::get_gtk_widget ()
 {
     audgui_init ();
 
     GtkWidget * widget = audgui_scaled_image_new (nullptr);
+    art_widget = widget;
 
     g_signal_connect (widget, "destroy", (GCallback) album_cleanup, nullptr);
+    g_signal_connect (widget, "size-allocate", (GCallback) album_size_allocate, nullptr);
 
     hook_associate ("playback ready", (HookFunction) album_update, widget);
     hook_associate ("playback stop", (HookFunction) album_clear, widget);
+    hook_associate ("art ready", (HookFunction) album_art_ready, widget);
 
     if (aud_drct_get_ready ())
         album_update (nullptr, widget);
@@ -18,7 +18,6 @@
 *
 */
 
-#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -65,12 +64,15 @@ protected:
     bool m_backend_initialized = false;
 
     static bool audio_init ();
+    static void audio_render (int frames);
     static void audio_generate (double seconds);
+    static void audio_flush ();
+    static void audio_discard ();
     static void audio_cleanup ();
 
     static void generate_ticks (midifile_t & midifile, int num_ticks);
     static void play_loop (midifile_t & midifile);
-    static int skip_to (midifile_t & midifile, int seektime);
+    static int skip_to (midifile_t & midifile, int seektime, int & tick);
 };
 
 EXPORT AMIDIPlug aud_plugin_instance;
@@ -98,13 +100,20 @@ bool AMIDIPlug::init ()
         "fsyn_synth_polyphony", "-1",
         "fsyn_synth_reverb", "-1",
         "fsyn_synth_chorus", "-1",
+        "fsyn_synth_cpu_cores", "1",
         "skip_leading", "FALSE",
         "skip_trailing", "FALSE",
+        "fsyn_dynamic_loading", "TRUE",
         nullptr
     };
 
     aud_config_set_defaults ("amidiplug", defaults);
 
+    /* start loading the soundfonts now, so that they are (mostly)
+       resident by the time the first MIDI file is played */
+    backend_init ();
+    m_backend_initialized = true;
+
     return true;
 }
 
@@ -162,9 +171,19 @@ bool AMIDIPlug::read_tag (const char * filename, VFSFile & file, Tuple & tuple,
 }
 
 
+/* the synth is always run for RENDER_FRAMES frames at a time; events are
+   applied at the start of the next render block, i.e. quantised to at most
+   RENDER_FRAMES frames (1.5 ms at 44.1 kHz), which is also FluidSynth's
+   internal block size.  The audio is passed on to the output in blocks of
+   AUDIO_BLOCK_FRAMES frames. */
+#define RENDER_FRAMES 64
+#define AUDIO_BLOCK_FRAMES 2048
+
 static int s_samplerate, s_channels;
-static int s_bufsize;
-static int16_t * s_buf;
+static Index<float> s_buf;  /* reused across songs */
+static int s_buffered;      /* frames in s_buf */
+static int64_t s_pending;   /* frames due but not yet rendered */
+static double s_fraction;   /* part of a frame not yet due */
 
 bool AMIDIPlug::audio_init ()
 {
@@ -172,35 +191,79 @@ bool AMIDIPlug::audio_init ()
 
     backend_audio_info (& s_channels, & bitdepth, & s_samplerate);
 
-    if (bitdepth != 16)
+    if (bitdepth != 32)
         return false;
 
-    open_audio (FMT_S16_NE, s_samplerate, s_channels);
+    open_audio (FMT_FLOAT, s_samplerate, s_channels);
+
+    int size = s_channels * AUDIO_BLOCK_FRAMES;
+    if (s_buf.len () != size)
+    {
+        s_buf.clear ();
+        s_buf.insert (0, size);
+    }
 
-    s_bufsize = 2 * s_channels * (s_samplerate / 4);
-    s_buf = new int16_t[s_bufsize / 2];
+    s_buffered = 0;
+    s_pending = 0;
+    s_fraction = 0;
 
     return true;
 }
 
-void AMIDIPlug::audio_generate (double seconds)
+void AMIDIPlug::audio_render (int frames)
 {
-    int total = 2 * s_channels * (int) round (seconds * s_samplerate);
+    backend_generate_audio (& s_buf[s_buffered * s_channels],
+     frames * s_channels * sizeof (float));
 
-    while (total)
+    s_buffered += frames;
+
+    if (s_buffered == AUDIO_BLOCK_FRAMES)
     {
-        int chunk = (total < s_bufsize) ? total : s_bufsize;
+        write_audio (s_buf.begin (), s_buffered * s_channels * sizeof (float));
+        s_buffered = 0;
+    }
+}
+
+void AMIDIPlug::audio_generate (double seconds)
+{
+    double exact = seconds * s_samplerate + s_fraction;
+    int64_t total = (int64_t) exact;
+    s_fraction = exact - total;
 
-        backend_generate_audio (s_buf, chunk);
-        write_audio (s_buf, chunk);
+    s_pending += total;
 
-        total -= chunk;
+    /* whatever is left over is rendered after the next events */
+    while (s_pending >= RENDER_FRAMES)
+    {
+        audio_render (RENDER_FRAMES);
+        s_pending -= RENDER_FRAMES;
     }
 }
 
+void AMIDIPlug::audio_flush ()
+{
+    /* end of song; render the remainder */
+    if (s_pending)
+        audio_render (s_pending);
+
+    if (s_buffered)
+        write_audio (s_buf.begin (), s_buffered * s_channels * sizeof (float));
+
+    s_buffered = 0;
+    s_pending = 0;
+}
+
+void AMIDIPlug::audio_discard ()
+{
+    s_buffered = 0;
+    s_pending = 0;
+    s_fraction = 0;
+}
+
 void AMIDIPlug::audio_cleanup ()
 {
-    delete[] s_buf;
+    s_buffered = 0;
+    s_pending = 0;
 }
 
 bool AMIDIPlug::play (const char * filename, VFSFile & file)
@@ -208,9 +271,8 @@ bool AMIDIPlug::play (const char * filename, VFSFile & file)
     if (__sync_bool_compare_and_swap (& backend_settings_changed, true, false)
      && m_backend_initialized)
     {
-        AUDDBG ("Settings changed, reinitializing backend\n");
-        backend_cleanup ();
-        m_backend_initialized = false;
+        AUDDBG ("Settings changed, reconfiguring backend\n");
+        backend_reconfigure ();
     }
 
     if (! m_backend_initialized)
@@ -219,6 +281,9 @@ bool AMIDIPlug::play (const char * filename, VFSFile & file)
         m_backend_initialized = true;
     }
 
+    /* wait for the soundfonts, which are loaded in the background */
+    backend_wait_ready ();
+
     if (! audio_init ())
         return false;
 
@@ -248,40 +313,25 @@ void AMIDIPlug::generate_ticks (midifile_t & midifile, int num_ticks)
 void AMIDIPlug::play_loop (midifile_t & midifile)
 {
     int tick = midifile.start_tick;
+    int position = 0;
     bool stopped = false;
 
-    /* initialize current position in each track */
-    for (midifile_track_t & track : midifile.tracks)
-        track.current_event = track.events.head ();
-
     while (! (stopped = check_stop ()))
     {
         int seektime = check_seek ();
         if (seektime >= 0)
-            tick = skip_to (midifile, seektime);
-
-        midievent_t * event = nullptr;
-        midifile_track_t * event_track = nullptr;
-        int min_tick = midifile.max_tick + 1;
-
-        /* search next event */
-        for (midifile_track_t & track : midifile.tracks)
         {
-            midievent_t * e2 = track.current_event;
-
-            if ((e2) && (e2->tick < min_tick))
-            {
-                min_tick = e2->tick;
-                event = e2;
-                event_track = & track;
-            }
+            audio_discard ();
+            position = skip_to (midifile, seektime, tick);
         }
 
-        if (!event)
+        if (position >= midifile.events.len ())
             break; /* end of song reached */
 
-        /* advance pointer to next event */
-        event_track->current_event = event_track->events.next (event);
+        midievent_t * event = midifile.events[position ++];
+
+        if (event->tick > midifile.max_tick)
+            break; /* only meta-events remain */
 
         if (event->tick > tick)
         {
@@ -345,62 +395,114 @@ void AMIDIPlug::play_loop (midifile_t & midifile)
     }
 
     if (! stopped)
+    {
         generate_ticks (midifile, midifile.max_tick - tick);
+        audio_flush ();
+    }
 
     backend_reset ();
 }
 
 
-/* amidigplug_skipto: re-do all events that influence the playing of our
-   midi file; re-do them using a time-tick of 0, so they are processed
-   istantaneously and proceed this way until the playing_tick is reached */
-int AMIDIPlug::skip_to (midifile_t & midifile, int seektime)
+static void send_controller (int channel, int num, int value)
 {
-    backend_reset ();
-
-    int tick = midifile.start_tick;
-    if (midifile.avg_microsec_per_tick > 0)
-        tick += (int64_t) seektime * 1000 / midifile.avg_microsec_per_tick;
+    midievent_t event;
+    event.type = SND_SEQ_EVENT_CONTROLLER;
+    event.d[0] = channel;
+    event.d[1] = num;
+    event.d[2] = value;
+    seq_event_controller (& event);
+}
 
-    /* initialize current position in each track */
-    for (midifile_track_t & track : midifile.tracks)
-        track.current_event = track.events.head ();
 
-    for (;;)
+/* restore_snapshot: bring the backend into the channel state recorded in
+   the snapshot; bank selects are sent before program changes and registered
+   parameters are re-entered before the final parameter selection */
+static void restore_snapshot (const midifile_snapshot_t & snapshot)
+{
+    for (int channel = 0; channel < 16; channel ++)
     {
-        midievent_t * event = nullptr;
-        midifile_track_t * event_track = nullptr;
-        int min_tick = midifile.max_tick + 1;
+        const midichannel_state_t & state = snapshot.channels[channel];
 
-        /* search next event */
-        for (midifile_track_t & track : midifile.tracks)
+        for (int rpn = 0; rpn < 3; rpn ++)
         {
-            midievent_t * e2 = track.current_event;
+            if (state.rpn_data[rpn][0] < 0 && state.rpn_data[rpn][1] < 0)
+                continue;
 
-            if ((e2) && (e2->tick < min_tick))
-            {
-                min_tick = e2->tick;
-                event = e2;
-                event_track = & track;
-            }
+            send_controller (channel, 101, 0);
+            send_controller (channel, 100, rpn);
+
+            if (state.rpn_data[rpn][0] >= 0)
+                send_controller (channel, 6, state.rpn_data[rpn][0]);
+            if (state.rpn_data[rpn][1] >= 0)
+                send_controller (channel, 38, state.rpn_data[rpn][1]);
         }
 
-        /* unlikely here... unless very strange MIDI files are played :) */
-        if (!event)
+        for (int num = 0; num < 128; num ++)
         {
-            AUDDBG ("SKIPTO request, reached the last event but not the requested tick (!)\n");
-            break; /* end of song reached */
+            if (state.cc[num] >= 0 && num != 6 && num != 38 && (num < 98 || num > 101))
+                send_controller (channel, num, state.cc[num]);
         }
 
-        /* reached the requested tick, job done */
-        if (event->tick >= tick)
+        static const int rpn_selects[] = {99, 98, 101, 100};
+        static const int nrpn_selects[] = {101, 100, 99, 98};
+
+        const int * selects = state.nrpn_selected ? nrpn_selects : rpn_selects;
+
+        for (int i = 0; i < 4; i ++)
         {
-            AUDDBG ("SKIPTO request, reached the requested tick, exiting from skipto loop\n");
-            break;
+            if (state.cc[selects[i]] >= 0)
+                send_controller (channel, selects[i], state.cc[selects[i]]);
         }
 
-        /* advance pointer to next event */
-        event_track->current_event = event_track->events.next (event);
+        if (state.program >= 0)
+        {
+            midievent_t event;
+            event.type = SND_SEQ_EVENT_PGMCHANGE;
+            event.d[0] = channel;
+            event.d[1] = state.program;
+            seq_event_pgmchange (& event);
+        }
+
+        if (state.pitchbend >= 0)
+        {
+            midievent_t event;
+            event.type = SND_SEQ_EVENT_PITCHBEND;
+            event.d[0] = channel;
+            event.d[1] = state.pitchbend & 0x7f;
+            event.d[2] = state.pitchbend >> 7;
+            seq_event_pitchbend (& event);
+        }
+    }
+}
+
+
+/* amidigplug_skipto: restore the channel state from the nearest snapshot
+   before the requested time, then re-do the remaining events that influence
+   the playing of our midi file; re-do them using a time-tick of 0, so they
+   are processed istantaneously until the playing_tick is reached; returns
+   the position in the timeline to continue playing from */
+int AMIDIPlug::skip_to (midifile_t & midifile, int seektime, int & tick)
+{
+    backend_reset ();
+
+    tick = midifile.tick_at_time ((int64_t) seektime * 1000);
+    int target = midifile.event_at_tick (tick);
+    int position = 0;
+
+    const midifile_snapshot_t * snapshot = midifile.snapshot_before (target);
+    if (snapshot)
+    {
+        restore_snapshot (* snapshot);
+        position = snapshot->event_index;
+    }
+
+    AUDDBG ("SKIPTO request, replaying %d events to reach tick %d\n",
+     target - position, tick);
+
+    for (; position < target; position ++)
+    {
+        midievent_t * event = midifile.events[position];
 
         switch (event->type)
         {
@@ -433,12 +535,13 @@ int AMIDIPlug::skip_to (midifile_t & midifile, int seektime)
 
         case SND_SEQ_EVENT_TEMPO:
             seq_event_tempo (event);
-            midifile.current_tempo = event->tempo;
             break;
         }
     }
 
-    return tick;
+    midifile.current_tempo = midifile.tempo_at_tick (tick);
+
+    return position;
 }
 
 const char AMIDIPlug::about[] =
@@ -18,12 +18,19 @@
 *
 */
 
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <fluidsynth.h>
 
+#include <glib.h>
+
 #include <libaudcore/audstrings.h>
+#include <libaudcore/hook.h>
 #include <libaudcore/i18n.h>
 #include <libaudcore/index.h>
 #include <libaudcore/runtime.h>
@@ -32,54 +39,87 @@
 #include "../i_configure.h"
 #include "../i_midievent.h"
 
+#if FLUIDSYNTH_VERSION_MAJOR > 2 || \
+ (FLUIDSYNTH_VERSION_MAJOR == 2 && FLUIDSYNTH_VERSION_MINOR >= 2)
+#define HAVE_FX_GROUPS
+#endif
+
+/* synth defaults, also shown in the configuration dialog */
+#define DEFAULT_GAIN 0.2
+#define DEFAULT_POLYPHONY 256
+
 typedef struct
 {
     fluid_settings_t * settings;
     fluid_synth_t * synth;
 
     Index<int> soundfont_ids;
+
+    /* settings the synth was created with; if these change, the synth
+       (and its soundfonts) have to be recreated */
+    String soundfont_file;
+    int samplerate;
+    int cpu_cores;
+    bool dynamic_loading;
 }
 sequencer_client_t;
 
 /* sequencer instance */
 static sequencer_client_t sc;
-/* options */
 
-static void i_soundfont_load ();
+/* soundfont loader thread; sc.synth must not be used by anyone else
+   while sf_loading is set */
+static pthread_mutex_t sf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sf_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t sf_thread;
+static bool sf_thread_running = false;
+static bool sf_loading = false;
 
-void backend_init ()
-{
-    sc.settings = new_fluid_settings();
+/* statistics of the last soundfont load, shown in the settings */
+static int sf_loaded_count = 0;
+static int64_t sf_load_time = 0;      /* milliseconds */
+static int64_t sf_disk_size = 0;      /* bytes */
+static int64_t sf_resident_size = -1; /* bytes, -1 if unknown */
 
-    fluid_settings_setnum (sc.settings, "synth.sample-rate",
-     aud_get_int ("amidiplug", "fsyn_synth_samplerate"));
+static void i_soundfont_load_start ();
+static void i_soundfont_load_wait ();
+static void i_synth_apply_settings ();
 
-    int gain = aud_get_int ("amidiplug", "fsyn_synth_gain");
-    int polyphony = aud_get_int ("amidiplug", "fsyn_synth_polyphony");
-    int reverb = aud_get_int ("amidiplug", "fsyn_synth_reverb");
-    int chorus = aud_get_int ("amidiplug", "fsyn_synth_chorus");
+void backend_init ()
+{
+    sc.soundfont_file = aud_get_str ("amidiplug", "fsyn_soundfont_file");
+    sc.samplerate = aud_get_int ("amidiplug", "fsyn_synth_samplerate");
+    sc.cpu_cores = aud_get_int ("amidiplug", "fsyn_synth_cpu_cores");
+    sc.dynamic_loading = aud_get_bool ("amidiplug", "fsyn_dynamic_loading");
 
-    if (gain != -1)
-        fluid_settings_setnum (sc.settings, "synth.gain", gain / 10.0);
+    sc.settings = new_fluid_settings();
 
-    if (polyphony != -1)
-        fluid_settings_setint (sc.settings, "synth.polyphony", polyphony);
+    fluid_settings_setnum (sc.settings, "synth.sample-rate", sc.samplerate);
 
-    if (reverb != -1)
-        fluid_settings_setint (sc.settings, "synth.reverb.active", reverb);
+    /* render voices on additional threads if requested */
+    if (sc.cpu_cores > 1)
+        fluid_settings_setint (sc.settings, "synth.cpu-cores", sc.cpu_cores);
 
-    if (chorus != -1)
-        fluid_settings_setint (sc.settings, "synth.chorus.active", chorus);
+    /* only load the samples of presets that are actually selected; this
+       setting is unknown to FluidSynth versions before 2.0.7, in which
+       case the whole soundfont is loaded as before */
+    if (sc.dynamic_loading)
+        fluid_settings_setint (sc.settings, "synth.dynamic-sample-loading", 1);
 
     sc.synth = new_fluid_synth (sc.settings);
 
-    /* load soundfonts */
-    i_soundfont_load();
+    i_synth_apply_settings ();
+
+    /* load soundfonts in the background */
+    i_soundfont_load_start ();
 }
 
 
 void backend_cleanup ()
 {
+    i_soundfont_load_wait ();
+    event_queue_cancel (SOUNDFONT_STATUS_HOOK);
+
     /* unload soundfonts */
     for (int id : sc.soundfont_ids)
         fluid_synth_sfunload (sc.synth, id, 0);
@@ -87,6 +127,36 @@ void backend_cleanup ()
     sc.soundfont_ids.clear ();
     delete_fluid_synth (sc.synth);
     delete_fluid_settings (sc.settings);
+
+    sc.soundfont_file = String ();
+}
+
+
+/* applies changed settings; the loaded soundfonts are kept unless the
+   change requires a new synth instance */
+void backend_reconfigure ()
+{
+    if (strcmp (sc.soundfont_file, aud_get_str ("amidiplug", "fsyn_soundfont_file")) ||
+        sc.samplerate != aud_get_int ("amidiplug", "fsyn_synth_samplerate") ||
+        sc.cpu_cores != aud_get_int ("amidiplug", "fsyn_synth_cpu_cores") ||
+        sc.dynamic_loading != aud_get_bool ("amidiplug", "fsyn_dynamic_loading"))
+    {
+        AUDDBG ("Synth settings changed, reinitializing backend\n");
+        backend_cleanup ();
+        backend_init ();
+    }
+    else
+    {
+        i_soundfont_load_wait ();
+        i_synth_apply_settings ();
+    }
+}
+
+
+/* blocks until the soundfonts have been loaded */
+void backend_wait_ready ()
+{
+    i_soundfont_load_wait ();
 }
 
 
@@ -184,14 +254,15 @@ void seq_event_allnoteoff (int unused)
 
 void backend_generate_audio (void * buf, int bufsize)
 {
-    fluid_synth_write_s16 (sc.synth, bufsize / 4, buf, 0, 2, buf, 1, 2);
+    int frames = bufsize / (2 * sizeof (float));
+    fluid_synth_write_float (sc.synth, frames, buf, 0, 2, buf, 1, 2);
 }
 
 
 void backend_audio_info (int * channels, int * bitdepth, int * samplerate)
 {
     *channels = 2;
-    *bitdepth = 16; /* always 16 bit, we use fluid_synth_write_s16() */
+    *bitdepth = 32; /* always float, we use fluid_synth_write_float() */
     *samplerate = aud_get_int ("amidiplug", "fsyn_synth_samplerate");
 }
 
@@ -200,30 +271,164 @@ void backend_audio_info (int * channels, int * bitdepth, int * samplerate)
    *** INTERNALS ****************************************************
    ****************************************************************** */
 
-static void i_soundfont_load ()
+static void i_synth_apply_settings ()
+{
+    int gain = aud_get_int ("amidiplug", "fsyn_synth_gain");
+    int polyphony = aud_get_int ("amidiplug", "fsyn_synth_polyphony");
+    int reverb = aud_get_int ("amidiplug", "fsyn_synth_reverb");
+    int chorus = aud_get_int ("amidiplug", "fsyn_synth_chorus");
+
+    fluid_synth_set_gain (sc.synth, (gain != -1) ? gain / 10.0 : DEFAULT_GAIN);
+    fluid_synth_set_polyphony (sc.synth, (polyphony != -1) ? polyphony : DEFAULT_POLYPHONY);
+
+#ifdef HAVE_FX_GROUPS
+    fluid_synth_reverb_on (sc.synth, -1, reverb != 0);
+    fluid_synth_chorus_on (sc.synth, -1, chorus != 0);
+#else
+    fluid_synth_set_reverb_on (sc.synth, reverb != 0);
+    fluid_synth_set_chorus_on (sc.synth, chorus != 0);
+#endif
+}
+
+
+static int64_t i_resident_size ()
+{
+#ifdef __linux__
+    FILE * file = fopen ("/proc/self/statm", "r");
+    long pages, resident;
+    bool valid = false;
+
+    if (file)
+    {
+        valid = (fscanf (file, "%ld %ld", & pages, & resident) == 2);
+        fclose (file);
+    }
+
+    if (valid)
+        return (int64_t) resident * sysconf (_SC_PAGESIZE);
+#endif
+
+    return -1;
+}
+
+
+static void * i_soundfont_load_thread (void *)
 {
-    String soundfont_file = aud_get_str ("amidiplug", "fsyn_soundfont_file");
+    Index<String> sffiles = str_list_to_index (sc.soundfont_file, ";");
+    Index<int> ids;
+    int64_t disk_size = 0;
 
-    if (soundfont_file[0])
+    int64_t start_time = g_get_monotonic_time ();
+    int64_t start_rss = i_resident_size ();
+
+    for (const char * sffile : sffiles)
     {
-        Index<String> sffiles = str_list_to_index (soundfont_file, ";");
+        AUDDBG ("loading soundfont %s\n", sffile);
+        int sf_id = fluid_synth_sfload (sc.synth, sffile, 0);
 
-        for (const char * sffile : sffiles)
+        if (sf_id == -1)
+            AUDWARN ("unable to load SoundFont file %s\n", sffile);
+        else
         {
-            AUDDBG ("loading soundfont %s\n", sffile);
-            int sf_id = fluid_synth_sfload (sc.synth, sffile, 0);
-
-            if (sf_id == -1)
-                AUDWARN ("unable to load SoundFont file %s\n", sffile);
-            else
-            {
-                AUDDBG ("soundfont %s successfully loaded\n", sffile);
-                sc.soundfont_ids.append (sf_id);
-            }
+            AUDDBG ("soundfont %s successfully loaded\n", sffile);
+            ids.append (sf_id);
+
+            struct stat info;
+            if (stat (sffile, & info) == 0)
+                disk_size += info.st_size;
         }
+    }
+
+    fluid_synth_system_reset (sc.synth);
+
+    int64_t end_rss = i_resident_size ();
+
+    pthread_mutex_lock (& sf_mutex);
+
+    sc.soundfont_ids = std::move (ids);
+
+    sf_loaded_count = sc.soundfont_ids.len ();
+    sf_load_time = (g_get_monotonic_time () - start_time) / 1000;
+    sf_disk_size = disk_size;
+    sf_resident_size = (start_rss >= 0 && end_rss >= 0) ?
+     aud::max (end_rss - start_rss, (int64_t) 0) : -1;
+
+    AUDDBG ("%d soundfonts loaded in %d ms\n", sf_loaded_count, (int) sf_load_time);
 
-        fluid_synth_system_reset (sc.synth);
+    sf_loading = false;
+    pthread_cond_broadcast (& sf_cond);
+    pthread_mutex_unlock (& sf_mutex);
+
+    event_queue (SOUNDFONT_STATUS_HOOK, nullptr);
+    return nullptr;
+}
+
+
+static void i_soundfont_load_start ()
+{
+    pthread_mutex_lock (& sf_mutex);
+    sf_loaded_count = 0;
+    sf_loading = (sc.soundfont_file[0] != 0);
+    pthread_mutex_unlock (& sf_mutex);
+
+    event_queue (SOUNDFONT_STATUS_HOOK, nullptr);
+
+    if (! sf_loading)
+    {
+        AUDWARN ("FluidSynth backend was selected, but no SoundFont has been specified\n");
+        return;
     }
+
+    if (pthread_create (& sf_thread, nullptr, i_soundfont_load_thread, nullptr) == 0)
+        sf_thread_running = true;
     else
-        AUDWARN ("FluidSynth backend was selected, but no SoundFont has been specified\n");
+        i_soundfont_load_thread (nullptr);
+}
+
+
+static void i_soundfont_load_wait ()
+{
+    pthread_mutex_lock (& sf_mutex);
+
+    while (sf_loading)
+        pthread_cond_wait (& sf_cond, & sf_mutex);
+
+    pthread_mutex_unlock (& sf_mutex);
+
+    if (sf_thread_running)
+    {
+        pthread_join (sf_thread, nullptr);
+        sf_thread_running = false;
+    }
+}
+
+
+String backend_soundfont_status ()
+{
+    String status;
+
+    pthread_mutex_lock (& sf_mutex);
+
+    if (sf_loading)
+        status = String (_("Loading SoundFonts ..."));
+    else if (! sf_loaded_count)
+        status = String (_("No SoundFont loaded."));
+    else
+    {
+        StringBuf buf = str_printf (dngettext (PACKAGE, "%d SoundFont loaded in %.1f s",
+         "%d SoundFonts loaded in %.1f s", sf_loaded_count), sf_loaded_count,
+         sf_load_time / 1000.0);
+
+        str_append_printf (buf, _(", %.1f MB on disk"), sf_disk_size / 1048576.0);
+
+        if (sf_resident_size >= 0)
+            str_append_printf (buf, _(", %.1f MB resident"),
+             sf_resident_size / 1048576.0);
+
+        status = String (buf);
+    }
+
+    pthread_mutex_unlock (& sf_mutex);
+
+    return status;
 }
@@ -21,12 +21,22 @@
 #ifndef _I_BACKEND_H
 #define _I_BACKEND_H 1
 
+#include <libaudcore/objects.h>
+
 struct midievent_t;
 
 void backend_init ();
 void backend_cleanup ();
+void backend_reconfigure ();
+void backend_wait_ready ();
 void backend_reset ();
 
+/* the "amidiplug soundfont status" hook is called (from the main loop)
+   whenever loading starts or finishes */
+#define SOUNDFONT_STATUS_HOOK "amidiplug soundfont status"
+
+String backend_soundfont_status ();
+
 void backend_audio_info (int *, int *, int *);
 void backend_generate_audio (void * buf, int bufsize);
 
@@ -25,12 +25,14 @@
 #include <sys/stat.h>
 
 #include <libaudcore/audstrings.h>
+#include <libaudcore/hook.h>
 #include <libaudcore/i18n.h>
 #include <libaudcore/runtime.h>
 #include <libaudcore/index.h>
 
 #include <glib/gstdio.h>
 
+#include "i_backend.h"
 #include "i_configure.h"
 
 #ifdef USE_GTK
@@ -182,6 +184,18 @@ void i_configure_ev_sflist_commit (void * sfont_lv)
 }
 
 
+static void soundfont_status_update (void *, void * label)
+{
+    gtk_label_set_text (GTK_LABEL (label), backend_soundfont_status ());
+}
+
+
+static void soundfont_status_destroy (GtkWidget * label)
+{
+    hook_dissociate (SOUNDFONT_STATUS_HOOK, soundfont_status_update, label);
+}
+
+
 void * create_soundfont_list ()
 {
         GtkListStore * soundfont_file_store;
@@ -191,6 +205,7 @@ void * create_soundfont_list ()
         GtkTreeSelection * soundfont_file_lv_sel;
         GtkWidget * soundfont_file_bbox_vbox, *soundfont_file_bbox_addbt, *soundfont_file_bbox_rembt;
         GtkWidget * soundfont_file_bbox_mvupbt, *soundfont_file_bbox_mvdownbt;
+        GtkWidget * soundfont_file_vbox, *soundfont_status_label;
 
         /* soundfont settings - soundfont files - listview */
         soundfont_file_store = gtk_list_store_new (LISTSFONT_N_COLUMNS, G_TYPE_STRING, G_TYPE_INT);
@@ -279,7 +294,23 @@ void * create_soundfont_list ()
         gtk_box_pack_start (GTK_BOX (soundfont_file_hbox), soundfont_file_lv_sw, true, true, 0);
         gtk_box_pack_start (GTK_BOX (soundfont_file_hbox), soundfont_file_bbox_vbox, false, false, 0);
 
-        return soundfont_file_hbox;
+        /* soundfont settings - load statistics */
+        soundfont_file_vbox = audgui_vbox_new (6);
+        soundfont_status_label = gtk_label_new (backend_soundfont_status ());
+#ifdef USE_GTK3
+        gtk_widget_set_halign (soundfont_status_label, GTK_ALIGN_START);
+#else
+        gtk_misc_set_alignment (GTK_MISC (soundfont_status_label), 0, 0.5);
+#endif
+        gtk_box_pack_start (GTK_BOX (soundfont_file_vbox), soundfont_file_hbox, true, true, 0);
+        gtk_box_pack_start (GTK_BOX (soundfont_file_vbox), soundfont_status_label, false, false, 0);
+
+        /* soundfonts are loaded in the background; follow the progress */
+        hook_associate (SOUNDFONT_STATUS_HOOK, soundfont_status_update, soundfont_status_label);
+        g_signal_connect (soundfont_status_label, "destroy",
+                          G_CALLBACK (soundfont_status_destroy), nullptr);
+
+        return soundfont_file_vbox;
 }
 
 #endif // USE_GTK
@@ -288,6 +319,7 @@ void * create_soundfont_list ()
 
 #include <QHBoxLayout>
 #include <QHeaderView>
+#include <QLabel>
 #include <QVBoxLayout>
 #include <QAbstractListModel>
 #include <QTreeView>
@@ -483,6 +515,14 @@ private:
     QPushButton * m_button_sf_del;
     QPushButton * m_button_sf_up;
     QPushButton * m_button_sf_down;
+    QLabel * m_status;
+
+    /* soundfonts are loaded in the background; follow the progress */
+    void update_status ()
+        { m_status->setText ((const char *) backend_soundfont_status ()); }
+
+    const HookReceiver<SoundFontWidget>
+        m_status_hook {SOUNDFONT_STATUS_HOOK, this, & SoundFontWidget::update_status};
 };
 
 SoundFontWidget::SoundFontWidget (QWidget * parent) :
@@ -495,7 +535,8 @@ SoundFontWidget::SoundFontWidget (QWidget * parent) :
     m_button_sf_add (new QPushButton (m_bbox)),
     m_button_sf_del (new QPushButton (m_bbox)),
     m_button_sf_up (new QPushButton (m_bbox)),
-    m_button_sf_down (new QPushButton (m_bbox))
+    m_button_sf_down (new QPushButton (m_bbox)),
+    m_status (new QLabel ((const char *) backend_soundfont_status (), this))
 {
     m_button_sf_add->setIcon (QIcon::fromTheme ("list-add"));
     m_button_sf_del->setIcon (QIcon::fromTheme ("list-remove"));
@@ -520,6 +561,7 @@ SoundFontWidget::SoundFontWidget (QWidget * parent) :
 
     m_vbox_layout->addWidget (m_view);
     m_vbox_layout->addWidget (m_bbox);
+    m_vbox_layout->addWidget (m_status);
 
     setLayout (m_vbox_layout);
 
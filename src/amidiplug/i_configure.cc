@@ -145,6 +145,8 @@ static const PreferencesWidget amidiplug_widgets[] = {
 #ifdef USE_QT
     WidgetCustomQt (create_soundfont_list_qt),
 #endif
+    WidgetCheck (N_("Load samples on demand"),
+        WidgetBool ("amidiplug", "fsyn_dynamic_loading", backend_change)),
     WidgetLabel (N_("<b>Synthesizer</b>")),
     WidgetBox ({{gain_widgets}, true}),
     WidgetBox ({{polyphony_widgets}, true}),
@@ -152,7 +154,10 @@ static const PreferencesWidget amidiplug_widgets[] = {
     WidgetBox ({{chorus_widgets}, true}),
     WidgetSpin (N_("Sample rate:"),
         WidgetInt ("amidiplug", "fsyn_synth_samplerate", backend_change),
-        {22050, 96000, 1, N_("Hz")})
+        {22050, 96000, 1, N_("Hz")}),
+    WidgetSpin (N_("Rendering threads:"),
+        WidgetInt ("amidiplug", "fsyn_synth_cpu_cores", backend_change),
+        {1, 64, 1})
 };
 
 const PluginPreferences amidiplug_prefs = {
@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include <libaudcore/audstrings.h>
 #include <libaudcore/runtime.h>
 #include <libaudcore/vfs.h>
@@ -34,6 +36,9 @@
 
 #define MAKE_ID(c1, c2, c3, c4) ((c1) | ((c2) << 8) | ((c3) << 16) | ((c4) << 24))
 
+/* number of events between two channel state snapshots */
+#define SNAPSHOT_INTERVAL 8192
+
 #define WARNANDBREAK(...) { AUDERR (__VA_ARGS__); break; }
 
 #define ERRMSG_MIDITRACK() { AUDERR ("%s: invalid MIDI data (offset %#x)", \
@@ -587,8 +592,26 @@ bool midifile_t::setget_tempo ()
 }
 
 
-/* this will set the midi length in microseconds
-   COMMENT: this will also reset current position in each track! */
+/* merges the events of all tracks into a single timeline; events on the
+   same tick keep the order of their tracks */
+void midifile_t::build_timeline ()
+{
+    events.clear ();
+
+    for (midifile_track_t & track : tracks)
+    {
+        for (midievent_t * event = track.events.head (); event;
+         event = track.events.next (event))
+            events.append (event);
+    }
+
+    std::stable_sort (events.begin (), events.end (),
+     [] (const midievent_t * a, const midievent_t * b)
+        { return a->tick < b->tick; });
+}
+
+
+/* this will set the midi length in microseconds */
 void midifile_t::setget_length ()
 {
     int64_t length_microsec = 0;
@@ -596,43 +619,12 @@ void midifile_t::setget_length ()
     /* get the first microsec_per_tick ratio */
     int microsec_per_tick = (int) (current_tempo / ppq);
 
-    /* initialize current position in each track */
-    for (midifile_track_t & track : tracks)
-        track.current_event = track.events.head ();
-
-    /* search for tempo events in each track; in fact, since the program
-       currently supports type 0 and type 1 MIDI files, we should find
-       tempo events only in one track */
     AUDDBG ("LENGTH calc: starting calc loop\n");
 
-    for (;;)
+    for (midievent_t * event : events)
     {
-        midievent_t * event = nullptr;
-        midifile_track_t * event_track = nullptr;
-        int min_tick = max_tick + 1;
-
-        /* search next event */
-        for (midifile_track_t & track : tracks)
-        {
-            midievent_t * e2 = track.current_event;
-
-            if (e2 && e2->tick < min_tick)
-            {
-                min_tick = e2->tick;
-                event = e2;
-                event_track = & track;
-            }
-        }
-
-        if (!event)
-        {
-            /* calculate the remaining length */
-            length_microsec += (microsec_per_tick * (max_tick - last_tick));
-            break; /* end of song reached */
-        }
-
-        /* advance pointer to next event */
-        event_track->current_event = event_track->events.next (event);
+        if (event->tick > max_tick)
+            break;
 
         /* check if this is a tempo event */
         if (event->type == SND_SEQ_EVENT_TEMPO)
@@ -648,6 +640,9 @@ void midifile_t::setget_length ()
         }
     }
 
+    /* calculate the remaining length */
+    length_microsec += (microsec_per_tick * (max_tick - last_tick));
+
     /* IMPORTANT
        this couple of important values is set by midifile_t::set_length */
     length = length_microsec;
@@ -661,56 +656,234 @@ void midifile_t::setget_length ()
 }
 
 
-/* this will get the weighted average bpm of the midi file;
-   if the file has a variable bpm, 'bpm' is set to -1;
-   COMMENT: this will also reset current position in each track! */
-void midifile_t::get_bpm (int * bpm, int * wavg_bpm)
+/* builds the tempo map used to convert between time and ticks; unlike
+   setget_length (), this uses the same exact arithmetic as playback */
+void midifile_t::build_tempo_map ()
 {
-    int last_tick = start_tick;
-    unsigned weighted_avg_tempo = 0;
-    bool is_monotempo = true;
-    int last_tempo = current_tempo;
+    tempo_map.clear ();
+    tempo_map.append (midifile_tempo_t {start_tick, current_tempo, 0});
 
-    /* initialize current position in each track */
-    for (midifile_track_t & track : tracks)
-        track.current_event = track.events.head ();
+    for (midievent_t * event : events)
+    {
+        if (event->tick > max_tick)
+            break;
 
-    /* search for tempo events in each track; in fact, since the program
-       currently supports type 0 and type 1 MIDI files, we should find
-       tempo events only in one track */
-    AUDDBG ("BPM calc: starting calc loop\n");
+        if (event->type != SND_SEQ_EVENT_TEMPO)
+            continue;
 
-    for (;;)
+        midifile_tempo_t & last = tempo_map[tempo_map.len () - 1];
+        int tick = aud::max (event->tick, start_tick);
+
+        if (tick == last.tick)
+            last.tempo = event->tempo;
+        else
+            tempo_map.append (midifile_tempo_t {tick, event->tempo, last.microsec +
+             (int64_t) (tick - last.tick) * last.tempo / ppq});
+    }
+}
+
+
+/* records the channel state every SNAPSHOT_INTERVAL events, so that seeking
+   only needs to replay the events following the nearest snapshot */
+void midifile_t::build_snapshots ()
+{
+    midichannel_state_t channels[16];
+
+    for (midichannel_state_t & channel : channels)
+        channel.reset ();
+
+    snapshots.clear ();
+
+    for (int i = 0; i < events.len (); i ++)
     {
-        midievent_t * event = nullptr;
-        midifile_track_t * event_track = nullptr;
-        int min_tick = max_tick + 1;
+        if (i > 0 && i % SNAPSHOT_INTERVAL == 0)
+        {
+            midifile_snapshot_t & snapshot = snapshots.append ();
+            snapshot.event_index = i;
+            memcpy (snapshot.channels, channels, sizeof channels);
+        }
+
+        midievent_t * event = events[i];
 
-        /* search next event */
-        for (midifile_track_t & track : tracks)
+        switch (event->type)
         {
-            midievent_t * e2 = track.current_event;
+        case SND_SEQ_EVENT_CONTROLLER:
+        case SND_SEQ_EVENT_PGMCHANGE:
+        case SND_SEQ_EVENT_PITCHBEND:
+            channels[event->d[0] & 0x0f].update (event);
+            break;
+        }
+    }
+
+    AUDDBG ("TIMELINE: %d events, %d tempo changes, %d snapshots\n",
+     events.len (), tempo_map.len (), snapshots.len ());
+}
+
+
+/* returns the tick that is played at the given time */
+int midifile_t::tick_at_time (int64_t microsec) const
+{
+    if (! tempo_map.len ())
+        return start_tick;
+
+    /* find the last tempo change at or before the given time */
+    int lo = 0, hi = tempo_map.len () - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (tempo_map[mid].microsec <= microsec)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    const midifile_tempo_t & seg = tempo_map[lo];
+    int64_t tick = seg.tick;
+
+    if (microsec > seg.microsec && seg.tempo > 0)
+        tick += (microsec - seg.microsec) * ppq / seg.tempo;
+
+    return aud::min (tick, (int64_t) max_tick);
+}
+
+
+/* returns the tempo in effect at the given tick */
+int midifile_t::tempo_at_tick (int tick) const
+{
+    if (! tempo_map.len ())
+        return current_tempo;
 
-            if (e2 && e2->tick < min_tick)
+    int lo = 0, hi = tempo_map.len () - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (tempo_map[mid].tick <= tick)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return tempo_map[lo].tempo;
+}
+
+
+/* returns the index of the first event at or after the given tick */
+int midifile_t::event_at_tick (int tick) const
+{
+    int lo = 0, hi = events.len ();
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (events[mid]->tick < tick)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+/* returns the last snapshot taken at or before the given event, if any */
+const midifile_snapshot_t * midifile_t::snapshot_before (int event_index) const
+{
+    int count = aud::min (event_index / SNAPSHOT_INTERVAL, snapshots.len ());
+    return count ? & snapshots[count - 1] : nullptr;
+}
+
+
+void midichannel_state_t::reset ()
+{
+    memset (cc, -1, sizeof cc);
+    program = -1;
+    memset (rpn_data, -1, sizeof rpn_data);
+    nrpn_selected = false;
+    pitchbend = -1;
+}
+
+
+void midichannel_state_t::update (const midievent_t * event)
+{
+    switch (event->type)
+    {
+    case SND_SEQ_EVENT_PGMCHANGE:
+        program = event->d[1];
+        break;
+
+    case SND_SEQ_EVENT_PITCHBEND:
+        pitchbend = (event->d[2] << 7) | event->d[1];
+        break;
+
+    case SND_SEQ_EVENT_CONTROLLER:
+    {
+        int num = event->d[1], value = event->d[2];
+
+        switch (num)
+        {
+        case 6:  /* data entry MSB */
+        case 38: /* data entry LSB */
+            /* only the registered parameters understood by common synths
+               are tracked; NRPNs are device specific */
+            if (! nrpn_selected && cc[101] == 0 && cc[100] >= 0 && cc[100] < 3)
+                rpn_data[(int) cc[100]][(num == 6) ? 0 : 1] = value;
+            break;
+
+        case 98:
+        case 99:
+            nrpn_selected = true;
+            cc[num] = value;
+            break;
+
+        case 100:
+        case 101:
+            nrpn_selected = false;
+            cc[num] = value;
+            break;
+
+        case 121: /* reset all controllers, see MIDI RP-015 */
+            for (int i = 0; i < 128; i ++)
             {
-                min_tick = e2->tick;
-                event = e2;
-                event_track = & track;
+                if (i != 0 && i != 32 && i != 7 && i != 10 && (i < 91 || i > 95))
+                    cc[i] = -1;
             }
-        }
 
-        if (!event)
-        {
-            /* calculate the remaining length */
-            if (max_tick > start_tick)
-                weighted_avg_tempo += (unsigned) (last_tempo *
-                 ((float) (max_tick - last_tick) / (float) (max_tick - start_tick)));
+            nrpn_selected = false;
+            pitchbend = -1;
+            break;
 
-            break; /* end of song reached */
+        case 120: /* channel mode messages have no lasting state */
+        case 123:
+        case 124:
+        case 125:
+        case 126:
+        case 127:
+            break;
+
+        default:
+            cc[num] = value;
+            break;
         }
+        break;
+    }
+    }
+}
 
-        /* advance pointer to next event */
-        event_track->current_event = event_track->events.next (event);
+
+/* this will get the weighted average bpm of the midi file;
+   if the file has a variable bpm, 'bpm' is set to -1 */
+void midifile_t::get_bpm (int * bpm, int * wavg_bpm)
+{
+    int last_tick = start_tick;
+    unsigned weighted_avg_tempo = 0;
+    bool is_monotempo = true;
+    int last_tempo = current_tempo;
+
+    AUDDBG ("BPM calc: starting calc loop\n");
+
+    for (midievent_t * event : events)
+    {
+        if (event->tick > max_tick)
+            break;
 
         /* check if this is a tempo event */
         if (event->type == SND_SEQ_EVENT_TEMPO)
@@ -734,6 +907,11 @@ void midifile_t::get_bpm (int * bpm, int * wavg_bpm)
         }
     }
 
+    /* calculate the remaining length */
+    if (max_tick > start_tick)
+        weighted_avg_tempo += (unsigned) (last_tempo *
+         ((float) (max_tick - last_tick) / (float) (max_tick - start_tick)));
+
     AUDDBG ("BPM calc: weighted average tempo: %i\n", weighted_avg_tempo);
 
     if (weighted_avg_tempo > 0)
@@ -783,9 +961,16 @@ bool midifile_t::parse_from_file (const char * filename, VFSFile & file)
         if (!setget_tempo ())
             WARNANDBREAK ("%s: invalid values while setting ppq and tempo\n", filename);
 
+        /* merge all tracks into one timeline */
+        build_timeline ();
+
         /* fill length, keeping in count tempo-changes */
         setget_length ();
 
+        /* index the timeline for seeking */
+        build_tempo_map ();
+        build_snapshots ();
+
         /* ok, mf has been filled with information; successfully return */
         success = true;
         break;
@@ -232,7 +232,6 @@ struct midifile_track_t
     List<midievent_t> events;           /* list of all events in this track */
     int start_tick;                     /* start of this track */
     int end_tick;			/* length of this track */
-    midievent_t * current_event;	/* used while loading and playing */
 
     midievent_t * add_event ()
     {
@@ -246,10 +245,48 @@ struct midifile_track_t
 };
 
 
+/* a point of the tempo map: from tick on, each quarter note lasts tempo
+   microseconds; microsec is the playing time elapsed up to tick */
+struct midifile_tempo_t
+{
+    int tick;
+    int tempo;
+    int64_t microsec;
+};
+
+
+/* controller state of a single MIDI channel; -1 means the value has not
+   been set since the last reset, so the synth default applies */
+struct midichannel_state_t
+{
+    signed char cc[128];
+    signed char program;
+    signed char rpn_data[3][2];         /* bend range, fine and coarse tuning */
+    bool nrpn_selected;
+    short pitchbend;
+
+    void reset ();
+    void update (const midievent_t * event);
+};
+
+
+/* state of all channels after the first event_index events of the timeline */
+struct midifile_snapshot_t
+{
+    int event_index;
+    midichannel_state_t channels[16];
+};
+
+
 struct midifile_t
 {
     Index<midifile_track_t> tracks;
 
+    /* events of all tracks merged into one tick-sorted timeline */
+    Index<midievent_t *> events;
+    Index<midifile_tempo_t> tempo_map;
+    Index<midifile_snapshot_t> snapshots;
+
     unsigned short format = 0;
     int start_tick = 0;
     int max_tick = 0;
@@ -265,6 +302,11 @@ struct midifile_t
     void get_bpm (int *, int *);
     bool parse_from_file (const char *, VFSFile & file);
 
+    int tick_at_time (int64_t microsec) const;
+    int tempo_at_tick (int tick) const;
+    int event_at_tick (int tick) const;
+    const midifile_snapshot_t * snapshot_before (int event_index) const;
+
 private:
     String file_name;
     Index<char> file_data;
@@ -282,6 +324,9 @@ private:
     bool parse_riff ();
     bool setget_tempo ();
     void setget_length ();
+    void build_timeline ();
+    void build_tempo_map ();
+    void build_snapshots ();
 };
 
 #endif /* !_I_MIDI_H */
@@ -34,6 +34,8 @@
 #include <libaudcore/preferences.h>
 #include <libaudgui/gtk-compat.h>
 
+#include "../ui-common/vis-governor.h"
+
 static void /* GtkWidget */ * bscope_get_color_chooser ();
 
 static const PreferencesWidget bscope_widgets[] = {
@@ -48,6 +50,7 @@ static const char * const bscope_defaults[] = {
  nullptr};
 
 static int bscope_color;
+static VisGovernor governor ("Blur Scope");
 
 class BlurScope : public VisPlugin
 {
@@ -73,7 +76,7 @@ public:
 private:
     void resize (int w, int h);
     void draw_to_cairo (cairo_t * cr);
-    void draw ();
+    bool visible ();
 
     void blur ();
     void draw_vert_line (int x, int y1, int y2);
@@ -88,6 +91,9 @@ private:
     GtkWidget * area = nullptr;
     int width = 0, height = 0, stride = 0, image_size = 0;
     uint32_t * image = nullptr, * corner = nullptr;
+
+    /* rows that may hold non-black pixels; the rest need no blurring */
+    int lit_top = 0, lit_bottom = -1;
 };
 
 EXPORT BlurScope aud_plugin_instance;
@@ -117,37 +123,31 @@ void BlurScope::resize (int w, int h)
     image = (uint32_t *) g_realloc (image, image_size);
     memset (image, 0, image_size);
     corner = image + stride + 1;
+    lit_top = 0;
+    lit_bottom = -1;
 }
 
 void BlurScope::draw_to_cairo (cairo_t * cr)
 {
+    VisGovernor::Cost cost (governor);
+
     cairo_surface_t * surf = cairo_image_surface_create_for_data
      ((unsigned char *) image, CAIRO_FORMAT_RGB24, width, height, stride << 2);
     cairo_set_source_surface (cr, surf, 0, 0);
     cairo_paint (cr);
     cairo_surface_destroy (surf);
+
+    governor.frame_painted ();
 }
 
-void BlurScope::draw ()
+/* false while the widget or its window is hidden or minimized */
+bool BlurScope::visible ()
 {
-    if (! area || ! gtk_widget_get_window (area))
-        return;
+    if (! area || ! gtk_widget_get_mapped (area))
+        return false;
 
-#ifdef USE_GTK3
-    GdkWindow * window = gtk_widget_get_window (area);
-    cairo_region_t * cr_region = cairo_region_create ();
-
-    GdkDrawingContext * drawing_context = gdk_window_begin_draw_frame (window, cr_region);
-    cairo_t * cr = gdk_drawing_context_get_cairo_context (drawing_context);
-    draw_to_cairo (cr);
-    gdk_window_end_draw_frame (window, drawing_context);
-
-    cairo_region_destroy (cr_region);
-#else
-    cairo_t * cr = gdk_cairo_create (gtk_widget_get_window (area));
-    draw_to_cairo (cr);
-    cairo_destroy (cr);
-#endif
+    GdkWindow * window = gtk_widget_get_window (gtk_widget_get_toplevel (area));
+    return window && ! (gdk_window_get_state (window) & GDK_WINDOW_STATE_ICONIFIED);
 }
 
 gboolean BlurScope::configure_event (GtkWidget * widget, GdkEventConfigure * event, void * user)
@@ -165,7 +165,9 @@ gboolean BlurScope::draw_event (GtkWidget * widget, cairo_t * cr, void * user)
 #else
 gboolean BlurScope::draw_event (GtkWidget * widget, GdkEventExpose * event, void * user)
 {
-    ((BlurScope *) user)->draw ();
+    cairo_t * cr = gdk_cairo_create (gtk_widget_get_window (widget));
+    ((BlurScope *) user)->draw_to_cairo (cr);
+    cairo_destroy (cr);
     return true;
 }
 #endif
@@ -187,25 +189,46 @@ void * BlurScope::get_gtk_widget ()
 void BlurScope::clear ()
 {
     memset (image, 0, image_size);
-    draw ();
+    lit_top = 0;
+    lit_bottom = -1;
+
+    if (area)
+        gtk_widget_queue_draw (area);
 }
 
 void BlurScope::blur ()
 {
-    for (int y = 0; y < height; y ++)
+    /* black rows stay black unless next to a lit one */
+    int top = aud::max (lit_top - 1, 0);
+    int bottom = aud::min (lit_bottom + 1, height - 1);
+
+    lit_top = height;
+    lit_bottom = -1;
+
+    for (int y = top; y <= bottom; y ++)
     {
         uint32_t * p = corner + stride * y;
         uint32_t * end = p + width;
         uint32_t * plast = p - stride;
         uint32_t * pnext = p + stride;
+        uint32_t lit = 0;
 
         /* We do a quick and dirty average of four color values, first masking
          * off the lowest two bits.  Over a large area, this masking has the net
          * effect of subtracting 1.5 from each value, which by a happy chance
          * is just right for a gradual fade effect. */
         for (; p < end; p ++)
+        {
             * p = ((* plast ++ & 0xFCFCFC) + (p[-1] & 0xFCFCFC) + (p[1] &
              0xFCFCFC) + (* pnext ++ & 0xFCFCFC)) >> 2;
+            lit |= * p;
+        }
+
+        if (lit)
+        {
+            lit_top = aud::min (lit_top, y);
+            lit_bottom = y;
+        }
     }
 }
 
@@ -225,6 +248,15 @@ void BlurScope::draw_vert_line (int x, int y1, int y2)
 
 void BlurScope::render_mono_pcm (const float * pcm)
 {
+    if (! width || ! governor.accept_frame (visible ()))
+        return;
+
+    VisGovernor::Cost cost (governor);
+
+    /* only the rows that were lit before or are drawn now need repainting */
+    int top = aud::max (lit_top - 1, 0);
+    int bottom = aud::min (lit_bottom + 1, height - 1);
+
     blur ();
 
     int prev_y = (0.5 + pcm[0]) * height;
@@ -235,10 +267,17 @@ void BlurScope::render_mono_pcm (const float * pcm)
         int y = (0.5 + pcm[i * 512 / width]) * height;
         y = aud::clamp (y, 0, height - 1);
         draw_vert_line (i, prev_y, y);
+
+        lit_top = aud::min (lit_top, aud::min (prev_y, y));
+        lit_bottom = aud::max (lit_bottom, aud::max (prev_y, y));
         prev_y = y;
     }
 
-    draw ();
+    top = aud::min (top, lit_top);
+    bottom = aud::max (bottom, lit_bottom);
+
+    if (top <= bottom)
+        gtk_widget_queue_draw_area (area, 0, top, width, bottom + 1 - top);
 }
 
 static void color_set_cb (GtkWidget * chooser)
@@ -31,6 +31,8 @@
 #include <libaudgui/libaudgui.h>
 #include <libaudgui/libaudgui-gtk.h>
 
+#include "../ui-common/vis-governor.h"
+
 #define MAX_BANDS   (256)
 #define VIS_DELAY 2 /* delay before falloff in frames */
 #define VIS_FALLOFF 2 /* falloff in pixels per frame */
@@ -62,11 +64,25 @@ static int width, height, bands;
 static int bars[MAX_BANDS + 1];
 static int delay[MAX_BANDS + 1];
 
+static VisGovernor governor ("Spectrum Analyzer");
+
+/* false while the widget or its window is hidden or minimized */
+static bool spect_visible ()
+{
+    if (! spect_widget || ! gtk_widget_get_mapped (spect_widget))
+        return false;
+
+    GdkWindow * window = gtk_widget_get_window (gtk_widget_get_toplevel (spect_widget));
+    return window && ! (gdk_window_get_state (window) & GDK_WINDOW_STATE_ICONIFIED);
+}
+
 void CairoSpectrum::render_freq (const float * freq)
 {
-    if (! bands)
+    if (! bands || ! governor.accept_frame (spect_visible ()))
         return;
 
+    VisGovernor::Cost cost (governor);
+
     for (int i = 0; i < bands; i ++)
     {
         /* 40 dB range */
@@ -142,20 +158,25 @@ static gboolean configure_event (GtkWidget * widget, GdkEventConfigure * event)
 #ifdef USE_GTK3
 static gboolean draw_event (GtkWidget * widget, cairo_t * cr, GtkWidget * area)
 {
+    VisGovernor::Cost cost (governor);
+
     draw_background (widget, cr);
     draw_visualizer (widget, cr);
 
+    governor.frame_painted ();
     return true;
 }
 #else
 static gboolean draw_event (GtkWidget * widget)
 {
+    VisGovernor::Cost cost (governor);
     cairo_t * cr = gdk_cairo_create (gtk_widget_get_window (widget));
 
     draw_background (widget, cr);
     draw_visualizer (widget, cr);
 
     cairo_destroy (cr);
+    governor.frame_painted ();
     return true;
 }
 #endif
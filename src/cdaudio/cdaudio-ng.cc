@@ -22,6 +22,9 @@
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include <chrono>
 
 /* prevent libcdio from redefining PACKAGE, VERSION, etc. */
 #define EXTERNAL_LIBCDIO_CONFIG_H
@@ -51,12 +54,23 @@
 #include <libaudcore/preferences.h>
 #include <libaudcore/runtime.h>
 
+#include "cddb-cache.h"
+
 #define MIN_DISC_SPEED 2
 #define MAX_DISC_SPEED 24
 
 #define MAX_RETRIES 10
 #define MAX_SKIPS 10
 
+/* sectors per read; about 60 KiB */
+#define READ_SECTORS 26
+/* sectors held in the read-ahead ring; 10 seconds of audio */
+#define RING_SECTORS (10 * 75)
+
+/* network timeout for background CDDB refreshes, in seconds; plugin cleanup
+ * waits for a refresh in progress */
+#define REFRESH_TIMEOUT 5
+
 static const char * const cdaudio_schemes[] = {"cdda", nullptr};
 
 class CDAudio : public InputPlugin
@@ -113,6 +127,7 @@ static bool refresh_trackinfo (bool warning);
 static void reset_trackinfo ();
 static int calculate_track_length (int startlsn, int endlsn);
 static int find_trackno_from_filename (const char * filename);
+static void stop_cddb_refresh ();
 
 const char CDAudio::about[] =
  N_("Copyright (C) 2007-2012 Calin Crisan <ccrisan@gmail.com> and others.\n\n"
@@ -156,6 +171,10 @@ const PreferencesWidget CDAudio::widgets[] = {
     WidgetSpin (N_("Port:"),
         WidgetInt ("CDDA", "cddbport"),
         {0, 65535, 1},
+        WIDGET_CHILD),
+    WidgetFileEntry (N_("Local freedb dump:"),
+        WidgetString ("CDDA", "cddb_dump"),
+        {FileSelectMode::Folder},
         WIDGET_CHILD)
 };
 
@@ -171,6 +190,335 @@ static void cdaudio_error (const char * message_format, ...)
     aud_ui_show_error (msg);
 }
 
+/*
+ * Read-ahead.  A reader thread fills a ring of sectors ahead of the playback
+ * position, so that the drive is read at a steady rate and playback is not
+ * held up by slow or failed reads.  When a track is played to its end, the
+ * reader goes on into the following audio tracks until the ring is full, so
+ * that the next track can start without waiting for the drive.  The ring is
+ * kept after the thread exits and is reused if playback continues where it
+ * left off.
+ *
+ * Sectors that cannot be read are retried one at a time and finally replaced
+ * with silence.  Playback fails only after MAX_SKIPS seconds of consecutive
+ * unreadable sectors.
+ */
+
+static struct {
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+    pthread_t thread;
+    bool running = false;   /* thread has been created and not joined */
+    bool active = false;    /* thread has not decided to exit */
+    bool quit = false;
+    bool attached = false;  /* play() is consuming the ring */
+    bool failed = false;
+
+    CdIo_t * p_cdio = nullptr;
+    int generation = 0;
+
+    Index<unsigned char> ring;
+    int head = 0;    /* ring position of the first buffered sector */
+    int first = 0;   /* LSN of the first buffered sector */
+    int len = 0;     /* number of buffered sectors */
+    int endlsn = -1; /* last sector to read */
+    int lost_run = 0;
+
+    /* statistics, reported at the end of each track */
+    int sectors_read = 0;
+    int retries = 0;
+    int lost = 0;
+    std::chrono::steady_clock::duration read_time {};
+} ra;
+
+/* reader mutex must be locked */
+static void reader_reset_locked (int lsn)
+{
+    ra.generation ++;
+    ra.head = 0;
+    ra.first = lsn;
+    ra.len = 0;
+    ra.lost_run = 0;
+    ra.failed = false;
+
+    pthread_cond_broadcast (& ra.cond);
+}
+
+/* reader mutex must be locked */
+static void reader_drop_locked (int sectors)
+{
+    ra.head = (ra.head + sectors) % RING_SECTORS;
+    ra.first += sectors;
+    ra.len -= sectors;
+
+    pthread_cond_broadcast (& ra.cond);
+}
+
+/* reader thread only */
+static bool reader_cancelled (int generation)
+{
+    pthread_mutex_lock (& ra.mutex);
+    bool cancelled = (ra.quit || ra.generation != generation);
+    pthread_mutex_unlock (& ra.mutex);
+
+    return cancelled;
+}
+
+/* reader thread only; returns the number of sectors that could not be read
+ * (and were filled with silence), or -1 if the read was cancelled */
+static int reader_read (unsigned char * dest, int lsn, int sectors,
+ int generation, int & retries)
+{
+    if (cdio_read_audio_sectors (ra.p_cdio, dest, lsn, sectors) == DRIVER_OP_SUCCESS)
+        return 0;
+
+    int lost = 0;
+
+    /* read the sectors one at a time to find the bad ones */
+    for (int i = 0; i < sectors; i ++)
+    {
+        unsigned char * sector = dest + CDIO_CD_FRAMESIZE_RAW * i;
+        bool success = false;
+
+        for (int retry = 0; retry <= MAX_RETRIES && ! success; retry ++)
+        {
+            if (reader_cancelled (generation))
+                return -1;
+
+            if (retry)
+                retries ++;
+
+            success = (cdio_read_audio_sectors (ra.p_cdio, sector, lsn + i, 1)
+             == DRIVER_OP_SUCCESS);
+        }
+
+        if (! success)
+        {
+            AUDDBG ("Could not read sector %d.\n", lsn + i);
+            memset (sector, 0, CDIO_CD_FRAMESIZE_RAW);
+            lost ++;
+        }
+    }
+
+    return lost;
+}
+
+static void * reader_thread (void *)
+{
+    pthread_mutex_lock (& ra.mutex);
+
+    while (! ra.quit)
+    {
+        int next = ra.first + ra.len;
+        int space = RING_SECTORS - ra.len;
+        int want = aud::min (READ_SECTORS, ra.endlsn + 1 - next);
+
+        if (ra.failed || want < 1 || space < want)
+        {
+            /* nobody is going to free any space; let the drive spin down */
+            if (! ra.attached)
+                break;
+
+            pthread_cond_wait (& ra.cond, & ra.mutex);
+            continue;
+        }
+
+        int tail = (ra.head + ra.len) % RING_SECTORS;
+        int sectors = aud::min (want, RING_SECTORS - tail);
+        int generation = ra.generation;
+        int retries = 0;
+
+        /* the sectors past the end of the buffered data are written by this
+         * thread only, so they can be filled without the lock */
+        pthread_mutex_unlock (& ra.mutex);
+
+        auto start = std::chrono::steady_clock::now ();
+        int lost = reader_read (& ra.ring[CDIO_CD_FRAMESIZE_RAW * tail], next,
+         sectors, generation, retries);
+        auto elapsed = std::chrono::steady_clock::now () - start;
+
+        pthread_mutex_lock (& ra.mutex);
+
+        ra.retries += retries;
+
+        if (lost < 0 || ra.generation != generation)
+            continue;
+
+        ra.len += sectors;
+        ra.sectors_read += sectors;
+        ra.read_time += elapsed;
+        ra.lost += lost;
+        ra.lost_run = lost ? ra.lost_run + lost : 0;
+
+        if (ra.lost_run > MAX_SKIPS * 75)
+            ra.failed = true;
+
+        pthread_cond_broadcast (& ra.cond);
+    }
+
+    ra.active = false;
+    pthread_cond_broadcast (& ra.cond);
+    pthread_mutex_unlock (& ra.mutex);
+
+    return nullptr;
+}
+
+/* play thread only; reader mutex must be locked */
+static void reader_join_locked ()
+{
+    if (ra.running)
+    {
+        pthread_mutex_unlock (& ra.mutex);
+        pthread_join (ra.thread, nullptr);
+        pthread_mutex_lock (& ra.mutex);
+
+        ra.running = false;
+    }
+}
+
+/* play thread only; mutex must be locked
+ * starts reading at <startlsn>, keeping any data already buffered there */
+static void reader_attach (int startlsn, int endlsn)
+{
+    pthread_mutex_lock (& ra.mutex);
+
+    if (! ra.ring.len ())
+        ra.ring.insert (0, CDIO_CD_FRAMESIZE_RAW * RING_SECTORS);
+
+    ra.p_cdio = pcdrom_drive->p_cdio;
+
+    if (startlsn >= ra.first && startlsn < ra.first + ra.len)
+    {
+        AUDDBG ("%d sectors already buffered.\n", ra.first + ra.len - startlsn);
+        reader_drop_locked (startlsn - ra.first);
+    }
+    else
+        reader_reset_locked (startlsn);
+
+    ra.attached = true;
+    ra.endlsn = endlsn;
+
+    ra.sectors_read = 0;
+    ra.retries = 0;
+    ra.lost = 0;
+    ra.read_time = {};
+
+    if (! ra.active)
+    {
+        /* the thread may have just exited */
+        reader_join_locked ();
+
+        ra.quit = false;
+        ra.active = ! pthread_create (& ra.thread, nullptr, reader_thread, nullptr);
+        ra.running = ra.active;
+    }
+
+    pthread_cond_broadcast (& ra.cond);
+    pthread_mutex_unlock (& ra.mutex);
+}
+
+/* play thread only */
+static void reader_seek (int lsn)
+{
+    pthread_mutex_lock (& ra.mutex);
+
+    if (lsn >= ra.first && lsn < ra.first + ra.len)
+        reader_drop_locked (lsn - ra.first);
+    else
+        reader_reset_locked (lsn);
+
+    pthread_mutex_unlock (& ra.mutex);
+}
+
+/* play thread only; waits up to 100 ms for data at the playback position.
+ * Returns the number of contiguous sectors available (at most <max>), 0 if
+ * none are available yet, or -1 if reading has failed. */
+static int reader_wait (int max, const unsigned char * * data)
+{
+    pthread_mutex_lock (& ra.mutex);
+
+    if (! ra.len && ! ra.failed && ra.active)
+    {
+        timespec ts {};
+        clock_gettime (CLOCK_REALTIME, & ts);
+
+        ts.tv_nsec += 100000000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec ++;
+            ts.tv_nsec -= 1000000000;
+        }
+
+        pthread_cond_timedwait (& ra.cond, & ra.mutex, & ts);
+    }
+
+    int sectors = aud::min (aud::min (ra.len, RING_SECTORS - ra.head), max);
+
+    if (! sectors && (ra.failed || ! ra.active))
+        sectors = -1;
+
+    * data = & ra.ring[CDIO_CD_FRAMESIZE_RAW * ra.head];
+
+    pthread_mutex_unlock (& ra.mutex);
+    return sectors;
+}
+
+/* play thread only */
+static void reader_consume (int sectors)
+{
+    pthread_mutex_lock (& ra.mutex);
+    reader_drop_locked (sectors);
+    pthread_mutex_unlock (& ra.mutex);
+}
+
+/* mutex must be locked */
+static void reader_stop ()
+{
+    pthread_mutex_lock (& ra.mutex);
+
+    ra.quit = true;
+    pthread_cond_broadcast (& ra.cond);
+    reader_join_locked ();
+
+    ra.quit = false;
+    ra.attached = false;
+    reader_reset_locked (0);
+    ra.ring.clear ();
+
+    pthread_mutex_unlock (& ra.mutex);
+}
+
+/* play thread only; mutex must be locked
+ * if <keep_reading> is set, the reader goes on until the ring is full */
+static void reader_detach (bool keep_reading)
+{
+    pthread_mutex_lock (& ra.mutex);
+
+    double seconds = std::chrono::duration<double> (ra.read_time).count ();
+    AUDDBG ("Read %d sectors at %.1fx speed, %d retries, %d sectors lost.\n",
+     ra.sectors_read, seconds > 0 ? ra.sectors_read / 75.0 / seconds : 0.0,
+     ra.retries, ra.lost);
+
+    ra.attached = false;
+    pthread_cond_broadcast (& ra.cond);
+
+    pthread_mutex_unlock (& ra.mutex);
+
+    if (! keep_reading)
+        reader_stop ();
+}
+
+/* thread safe */
+static bool reader_busy ()
+{
+    pthread_mutex_lock (& ra.mutex);
+    bool busy = ra.active;
+    pthread_mutex_unlock (& ra.mutex);
+
+    return busy;
+}
+
 /* main thread only */
 static void purge_playlist (Playlist playlist)
 {
@@ -203,8 +551,8 @@ static void monitor (void *)
 {
     pthread_mutex_lock (& mutex);
 
-    /* make sure not to close drive handle while playing */
-    if (! playing)
+    /* make sure not to close drive handle while playing or reading ahead */
+    if (! playing && ! reader_busy ())
         refresh_trackinfo (false);
 
     pthread_mutex_unlock (& mutex);
@@ -267,72 +615,59 @@ bool CDAudio::play (const char * name, VFSFile & file)
     int startlsn = trackinfo[trackno].startlsn;
     int endlsn = trackinfo[trackno].endlsn;
 
+    /* read ahead into the following audio tracks */
+    int lasttrack = trackno;
+    while (lasttrack < lasttrackno && cdda_track_audiop (pcdrom_drive, lasttrack + 1))
+        lasttrack ++;
+
     playing = true;
+    reader_attach (startlsn, trackinfo[lasttrack].endlsn);
 
-    int buffer_size = aud_get_int ("output_buffer_size");
-    int speed = aud_get_int ("CDDA", "disc_speed");
-    speed = aud::clamp (speed, MIN_DISC_SPEED, MAX_DISC_SPEED);
-    int sectors = aud::clamp (buffer_size / 2, 50, 250) * speed * 75 / 1000;
-    int currlsn = startlsn;
-    int retry_count = 0, skip_count = 0;
+    /* unlock mutex here to avoid blocking
+     * other threads must be careful not to close drive handle */
+    pthread_mutex_unlock (& mutex);
 
-    Index<unsigned char> buffer;
-    buffer.insert (0, 2352 * sectors);
+    int currlsn = startlsn;
+    bool error = false;
 
     while (! check_stop ())
     {
         int seek_time = check_seek ();
         if (seek_time >= 0)
-            currlsn = startlsn + (seek_time * 75 / 1000);
+        {
+            currlsn = aud::min (startlsn + (seek_time * 75 / 1000), endlsn + 1);
+            reader_seek (currlsn);
+        }
 
-        sectors = aud::min (sectors, endlsn + 1 - currlsn);
-        if (sectors < 1)
+        if (currlsn > endlsn)
             break;
 
-        /* unlock mutex here to avoid blocking
-         * other threads must be careful not to close drive handle */
-        pthread_mutex_unlock (& mutex);
-
-        int ret = cdio_read_audio_sectors (pcdrom_drive->p_cdio,
-         buffer.begin (), currlsn, sectors);
+        const unsigned char * data;
+        int sectors = reader_wait (endlsn + 1 - currlsn, & data);
 
-        if (ret == DRIVER_OP_SUCCESS)
-            write_audio (buffer.begin (), 2352 * sectors);
-
-        pthread_mutex_lock (& mutex);
-
-        if (ret == DRIVER_OP_SUCCESS)
-        {
-            currlsn += sectors;
-            retry_count = 0;
-            skip_count = 0;
-        }
-        else if (sectors > 16)
-        {
-            /* maybe a smaller read size will help */
-            sectors /= 2;
-        }
-        else if (retry_count < MAX_RETRIES)
-        {
-            /* still failed; retry a few times */
-            retry_count ++;
-        }
-        else if (skip_count < MAX_SKIPS)
+        if (sectors < 0)
         {
-            /* maybe the disk is scratched; try skipping ahead */
-            currlsn = aud::min (currlsn + 75, endlsn + 1);
-            skip_count ++;
+            error = true;
+            break;
         }
-        else
+
+        if (sectors > 0)
         {
-            /* still failed; give it up */
-            cdaudio_error (_("Error reading audio CD."));
-            break;
+            write_audio (data, CDIO_CD_FRAMESIZE_RAW * sectors);
+            reader_consume (sectors);
+            currlsn += sectors;
         }
     }
 
+    pthread_mutex_lock (& mutex);
+
+    /* keep reading only if the next track is likely to be played */
+    reader_detach (! error && currlsn > endlsn);
     playing = false;
 
+    if (error)
+        cdaudio_error (_("Error reading audio CD."));
+
     pthread_mutex_unlock (& mutex);
     return true;
 }
@@ -344,6 +679,7 @@ void CDAudio::cleanup ()
 
     reset_trackinfo ();
     purge_func.stop ();
+    stop_cddb_refresh ();
 
     libcddb_shutdown ();
 
@@ -477,10 +813,203 @@ static bool check_disc_mode (bool warning)
     return true;
 }
 
+/* thread safe */
+static cddb_disc_t * create_cddb_disc (const CDDBToc & toc)
+{
+    cddb_disc_t * pcddb_disc = cddb_disc_new ();
+    cddb_disc_set_length (pcddb_disc, toc.length);
+
+    for (int offset : toc.offsets)
+    {
+        cddb_track_t * pcddb_track = cddb_track_new ();
+        cddb_track_set_frame_offset (pcddb_track, offset);
+        cddb_disc_add_track (pcddb_disc, pcddb_track);
+    }
+
+    cddb_disc_calc_discid (pcddb_disc);
+    return pcddb_disc;
+}
+
+/* thread safe */
+static unsigned calc_discid (const CDDBToc & toc)
+{
+    cddb_disc_t * pcddb_disc = create_cddb_disc (toc);
+    unsigned discid = cddb_disc_get_discid (pcddb_disc);
+    cddb_disc_destroy (pcddb_disc);
+
+    return discid;
+}
+
+/* thread safe; if <quiet> is set (background refresh), errors are only logged
+ * and a short network timeout is used */
+static bool query_cddb (const CDDBToc & toc, CDDBInfo & info, bool quiet)
+{
+    cddb_conn_t * pcddb_conn = cddb_new ();
+    if (pcddb_conn == nullptr)
+    {
+        cdaudio_error (_("Failed to create the CDDB connection."));
+        return false;
+    }
+
+    AUDDBG ("getting CDDB info\n");
+
+    /* results are kept in our own cache (see cddb-cache.cc) */
+    cddb_cache_disable (pcddb_conn);
+
+    if (quiet)
+        cddb_set_timeout (pcddb_conn, REFRESH_TIMEOUT);
+
+    String server = aud_get_str ("CDDA", "cddbserver");
+    String path = aud_get_str ("CDDA", "cddbpath");
+    int port = aud_get_int ("CDDA", "cddbport");
+
+    if (aud_get_bool ("use_proxy"))
+    {
+        String prhost = aud_get_str ("proxy_host");
+        int prport = aud_get_int ("proxy_port");
+        String pruser = aud_get_str ("proxy_user");
+        String prpass = aud_get_str ("proxy_pass");
+
+        cddb_http_proxy_enable (pcddb_conn);
+        cddb_set_http_proxy_server_name (pcddb_conn, prhost);
+        cddb_set_http_proxy_server_port (pcddb_conn, prport);
+        cddb_set_http_proxy_username (pcddb_conn, pruser);
+        cddb_set_http_proxy_password (pcddb_conn, prpass);
+
+        cddb_set_server_name (pcddb_conn, server);
+        cddb_set_server_port (pcddb_conn, port);
+    }
+    else if (aud_get_bool ("CDDA", "cddbhttp"))
+    {
+        cddb_http_enable (pcddb_conn);
+        cddb_set_server_name (pcddb_conn, server);
+        cddb_set_server_port (pcddb_conn, port);
+        cddb_set_http_path_query (pcddb_conn, path);
+    }
+    else
+    {
+        cddb_set_server_name (pcddb_conn, server);
+        cddb_set_server_port (pcddb_conn, port);
+    }
+
+    cddb_disc_t * pcddb_disc = create_cddb_disc (toc);
+    String error;
+    bool found = false;
+
+    int matches = cddb_query (pcddb_conn, pcddb_disc);
+
+    if (matches == -1)
+    {
+        if (cddb_errno (pcddb_conn) == CDDB_ERR_OK)
+            error = String (_("Failed to query the CDDB server"));
+        else
+            error = String (str_printf (_("Failed to query the CDDB server: %s"),
+             cddb_error_str (cddb_errno (pcddb_conn))));
+    }
+    else if (matches == 0)
+        AUDDBG ("no CDDB info available for this disc\n");
+    else
+    {
+        AUDDBG ("CDDB disc category = \"%s\"\n",
+               cddb_disc_get_category_str (pcddb_disc));
+
+        cddb_read (pcddb_conn, pcddb_disc);
+
+        if (cddb_errno (pcddb_conn) != CDDB_ERR_OK)
+            error = String (str_printf (_("Failed to read the CDDB info: %s"),
+             cddb_error_str (cddb_errno (pcddb_conn))));
+        else
+        {
+            info.artist = String (cddb_disc_get_artist (pcddb_disc));
+            info.title = String (cddb_disc_get_title (pcddb_disc));
+            info.genre = String (cddb_disc_get_genre (pcddb_disc));
+
+            info.tracks.clear ();
+            info.tracks.insert (0, toc.offsets.len ());
+
+            for (int i = 0; i < toc.offsets.len (); i++)
+            {
+                cddb_track_t * pcddb_track = cddb_disc_get_track (pcddb_disc, i);
+
+                if (pcddb_track != nullptr)
+                {
+                    info.tracks[i].artist = String (cddb_track_get_artist (pcddb_track));
+                    info.tracks[i].title = String (cddb_track_get_title (pcddb_track));
+                }
+            }
+
+            found = true;
+        }
+    }
+
+    if (error && quiet)
+        AUDERR ("%s\n", (const char *) error);
+    else if (error)
+        cdaudio_error ("%s", (const char *) error);
+
+    cddb_disc_destroy (pcddb_disc);
+    cddb_destroy (pcddb_conn);
+
+    return found;
+}
+
+/* A stale cache entry is used as is and fetched again in the background; the
+ * new data is used the next time the disc is scanned. */
+static pthread_mutex_t refresh_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t refresh_thread;
+static bool refresh_done;
+
+/* lock mutex to read / set these variables */
+static bool refresh_running;
+static CDDBToc refresh_toc;
+
+/* refresh thread only */
+static void * refresh_cddb (void *)
+{
+    CDDBInfo info;
+    if (query_cddb (refresh_toc, info, true))
+        cddb_cache_store (refresh_toc, info);
+
+    pthread_mutex_lock (& refresh_mutex);
+    refresh_done = true;
+    pthread_mutex_unlock (& refresh_mutex);
+
+    return nullptr;
+}
+
+/* mutex must be locked */
+static void stop_cddb_refresh ()
+{
+    if (refresh_running)
+    {
+        pthread_join (refresh_thread, nullptr);
+        refresh_running = false;
+        refresh_done = false;
+    }
+}
+
+/* mutex must be locked */
+static void start_cddb_refresh (CDDBToc && toc)
+{
+    pthread_mutex_lock (& refresh_mutex);
+    bool busy = refresh_running && ! refresh_done;
+    pthread_mutex_unlock (& refresh_mutex);
+
+    /* one refresh at a time is enough */
+    if (busy)
+        return;
+
+    stop_cddb_refresh ();
+
+    refresh_toc = std::move (toc);
+    refresh_running = ! pthread_create (& refresh_thread, nullptr, refresh_cddb, nullptr);
+}
+
 /* mutex must be locked */
 static bool scan_cd ()
 {
     AUDDBG ("Scanning CD drive.\n");
+    reader_stop ();
     trackinfo.clear ();
 
     /* general track initialization */
@@ -596,145 +1125,42 @@ static bool scan_cd ()
         }
     }
 
-    if (!cdtext_was_available)
+    if (!cdtext_was_available && aud_get_bool ("CDDA", "use_cddb"))
     {
-        /* initialize de cddb subsystem */
-        cddb_conn_t *pcddb_conn = nullptr;
-        cddb_disc_t *pcddb_disc = nullptr;
-        cddb_track_t *pcddb_track = nullptr;
-        lba_t lba;              /* Logical Block Address */
+        CDDBToc toc;
+        toc.length = FRAMES_TO_SECONDS (cdio_get_track_lba (pcdrom_drive->p_cdio,
+         CDIO_CDROM_LEADOUT_TRACK));
 
-        if (aud_get_bool ("CDDA", "use_cddb"))
-        {
-            pcddb_conn = cddb_new ();
-            if (pcddb_conn == nullptr)
-                cdaudio_error (_("Failed to create the CDDB connection."));
-            else
-            {
-                AUDDBG ("getting CDDB info\n");
-
-                cddb_cache_enable (pcddb_conn);
-                // cddb_cache_set_dir(pcddb_conn, "~/.cddbslave");
-
-                String server = aud_get_str ("CDDA", "cddbserver");
-                String path = aud_get_str ("CDDA", "cddbpath");
-                int port = aud_get_int ("CDDA", "cddbport");
-
-                if (aud_get_bool ("use_proxy"))
-                {
-                    String prhost = aud_get_str ("proxy_host");
-                    int prport = aud_get_int ("proxy_port");
-                    String pruser = aud_get_str ("proxy_user");
-                    String prpass = aud_get_str ("proxy_pass");
-
-                    cddb_http_proxy_enable (pcddb_conn);
-                    cddb_set_http_proxy_server_name (pcddb_conn, prhost);
-                    cddb_set_http_proxy_server_port (pcddb_conn, prport);
-                    cddb_set_http_proxy_username (pcddb_conn, pruser);
-                    cddb_set_http_proxy_password (pcddb_conn, prpass);
-
-                    cddb_set_server_name (pcddb_conn, server);
-                    cddb_set_server_port (pcddb_conn, port);
-                }
-                else if (aud_get_bool ("CDDA", "cddbhttp"))
-                {
-                    cddb_http_enable (pcddb_conn);
-                    cddb_set_server_name (pcddb_conn, server);
-                    cddb_set_server_port (pcddb_conn, port);
-                    cddb_set_http_path_query (pcddb_conn, path);
-                }
-                else
-                {
-                    cddb_set_server_name (pcddb_conn, server);
-                    cddb_set_server_port (pcddb_conn, port);
-                }
+        for (int trackno = firsttrackno; trackno <= lasttrackno; trackno++)
+            toc.offsets.append (cdio_get_track_lba (pcdrom_drive->p_cdio, trackno));
 
-                pcddb_disc = cddb_disc_new ();
+        toc.discid = calc_discid (toc);
+        AUDDBG ("CDDB disc id = %x\n", toc.discid);
 
-                lba = cdio_get_track_lba (pcdrom_drive->p_cdio,
-                                          CDIO_CDROM_LEADOUT_TRACK);
-                cddb_disc_set_length (pcddb_disc, FRAMES_TO_SECONDS (lba));
+        CDDBInfo info;
+        bool stale = false;
+        bool found = cddb_cache_lookup (toc, info, stale);
 
-                for (int trackno = firsttrackno; trackno <= lasttrackno; trackno++)
-                {
-                    pcddb_track = cddb_track_new ();
-                    cddb_track_set_frame_offset (pcddb_track,
-                                                 cdio_get_track_lba (
-                                                     pcdrom_drive->p_cdio,
-                                                     trackno));
-                    cddb_disc_add_track (pcddb_disc, pcddb_track);
-                }
+        if (found && stale)
+            start_cddb_refresh (std::move (toc));
+        else if (! found && (found = query_cddb (toc, info, false)))
+            cddb_cache_store (toc, info);
 
-                cddb_disc_calc_discid (pcddb_disc);
+        if (found)
+        {
+            trackinfo[0].performer = info.artist;
+            trackinfo[0].name = info.title;
+            trackinfo[0].genre = info.genre;
 
-                unsigned discid = cddb_disc_get_discid (pcddb_disc);
-                AUDDBG ("CDDB disc id = %x\n", discid);
+            for (int trackno = firsttrackno; trackno <= lasttrackno; trackno++)
+            {
+                const CDDBTrack & track = info.tracks[trackno - firsttrackno];
 
-                int matches;
-                if ((matches = cddb_query (pcddb_conn, pcddb_disc)) == -1)
-                {
-                    if (cddb_errno (pcddb_conn) == CDDB_ERR_OK)
-                        cdaudio_error (_("Failed to query the CDDB server"));
-                    else
-                        cdaudio_error (_("Failed to query the CDDB server: %s"),
-                                       cddb_error_str (cddb_errno
-                                                       (pcddb_conn)));
-
-                    cddb_disc_destroy (pcddb_disc);
-                    pcddb_disc = nullptr;
-                }
-                else
-                {
-                    if (matches == 0)
-                    {
-                        AUDDBG ("no CDDB info available for this disc\n");
-
-                        cddb_disc_destroy (pcddb_disc);
-                        pcddb_disc = nullptr;
-                    }
-                    else
-                    {
-                        AUDDBG ("CDDB disc category = \"%s\"\n",
-                               cddb_disc_get_category_str (pcddb_disc));
-
-                        cddb_read (pcddb_conn, pcddb_disc);
-                        if (cddb_errno (pcddb_conn) != CDDB_ERR_OK)
-                        {
-                            cdaudio_error (_("Failed to read the CDDB info: %s"),
-                                           cddb_error_str (cddb_errno
-                                                           (pcddb_conn)));
-                            cddb_disc_destroy (pcddb_disc);
-                            pcddb_disc = nullptr;
-                        }
-                        else
-                        {
-                            trackinfo[0].performer = String (cddb_disc_get_artist (pcddb_disc));
-                            trackinfo[0].name = String (cddb_disc_get_title (pcddb_disc));
-                            trackinfo[0].genre = String (cddb_disc_get_genre (pcddb_disc));
-
-                            int trackno;
-                            for (trackno = firsttrackno; trackno <= lasttrackno;
-                                 trackno++)
-                            {
-                                cddb_track_t *pcddb_track =
-                                    cddb_disc_get_track (pcddb_disc,
-                                                         trackno - 1);
-
-                                trackinfo[trackno].performer = String (cddb_track_get_artist (pcddb_track));
-                                trackinfo[trackno].name = String (cddb_track_get_title (pcddb_track));
-                                trackinfo[trackno].genre = String (cddb_disc_get_genre (pcddb_disc));
-                            }
-                        }
-                    }
-                }
+                trackinfo[trackno].performer = track.artist;
+                trackinfo[trackno].name = track.title;
+                trackinfo[trackno].genre = info.genre;
             }
         }
-
-        if (pcddb_disc != nullptr)
-            cddb_disc_destroy (pcddb_disc);
-
-        if (pcddb_conn != nullptr)
-            cddb_destroy (pcddb_conn);
     }
 
     return true;
@@ -766,6 +1192,7 @@ fail:
 static void reset_trackinfo ()
 {
     timer_remove (TimerRate::Hz1, monitor);
+    reader_stop ();
 
     if (pcdrom_drive != nullptr)
     {
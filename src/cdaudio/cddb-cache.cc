@@ -0,0 +1,304 @@
+/*
+ * Local CDDB cache for the Audio CD plugin
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/runtime.h>
+#include <libaudcore/vfs.h>
+
+#include "cddb-cache.h"
+
+/* cached entries older than this are fetched again in the background */
+#define REFRESH_DAYS 30
+
+/* frames by which the track offsets in a freedb dump may differ from the
+ * disc; drives do not all report exactly the same table of contents */
+#define DUMP_TOLERANCE 75
+
+static unsigned toc_hash (const CDDBToc & toc)
+{
+    unsigned hash = toc.length;
+    for (int offset : toc.offsets)
+        hash = hash * 31 + offset;
+
+    return hash;
+}
+
+static StringBuf cache_path (const CDDBToc & toc)
+{
+    return filename_build ({aud_get_path (AudPath::UserDir), "cddb",
+     str_printf ("%08x-%08x", toc.discid, toc_hash (toc))});
+}
+
+static StringBuf unescape (const char * value)
+{
+    StringBuf buf (strlen (value));
+    char * out = buf;
+
+    for (const char * p = value; * p; p ++)
+    {
+        if (* p == '\\' && p[1])
+        {
+            p ++;
+            * out ++ = (* p == 'n') ? '\n' : (* p == 't') ? '\t' : * p;
+        }
+        else
+            * out ++ = * p;
+    }
+
+    buf.resize (out - buf);
+    return buf;
+}
+
+/* splits "Artist / Title"; without a separator, <artist> is left unset */
+static void split_title (const char * value, String & artist, String & title)
+{
+    const char * sep = strstr (value, " / ");
+
+    if (sep)
+    {
+        artist = String (str_copy (value, sep - value));
+        title = String (sep + 3);
+    }
+    else
+        title = String (value);
+}
+
+static bool parse_xmcd (const char * data, const CDDBToc & toc, int tolerance,
+ CDDBInfo & info)
+{
+    Index<int> offsets;
+    bool in_offsets = false;
+
+    String dtitle, dgenre;
+    Index<String> ttitles;
+    ttitles.insert (0, toc.offsets.len ());
+
+    for (const String & line : str_list_to_index (data, "\r\n"))
+    {
+        if (line[0] == '#')
+        {
+            const char * p = line + 1;
+            while (* p == ' ' || * p == '\t')
+                p ++;
+
+            if (strstr (p, "Track frame offsets"))
+                in_offsets = true;
+            else if (in_offsets && g_ascii_isdigit (* p))
+                offsets.append (atoi (p));
+            else
+                in_offsets = false;
+
+            continue;
+        }
+
+        const char * eq = strchr (line, '=');
+        if (! eq)
+            continue;
+
+        StringBuf key = str_copy (line, eq - line);
+        StringBuf value = unescape (eq + 1);
+        int n;
+
+        /* long values are continued on further lines with the same key */
+        if (! strcmp (key, "DTITLE"))
+            dtitle = String (str_concat ({dtitle ? (const char *) dtitle : "", value}));
+        else if (! strcmp (key, "DGENRE"))
+            dgenre = String (str_concat ({dgenre ? (const char *) dgenre : "", value}));
+        else if (sscanf (key, "TTITLE%d", & n) == 1 && n >= 0 && n < ttitles.len ())
+            ttitles[n] = String (str_concat ({ttitles[n] ? (const char *) ttitles[n] : "", value}));
+    }
+
+    if (offsets.len () != toc.offsets.len () || ! dtitle)
+        return false;
+
+    for (int i = 0; i < offsets.len (); i ++)
+    {
+        if (abs (offsets[i] - toc.offsets[i]) > tolerance)
+            return false;
+    }
+
+    info = CDDBInfo ();
+    split_title (dtitle, info.artist, info.title);
+
+    /* freedb gives the title alone for discs by the artist of the same name */
+    if (! info.artist)
+        info.artist = info.title;
+
+    if (dgenre && dgenre[0])
+        info.genre = dgenre;
+
+    info.tracks.insert (0, ttitles.len ());
+
+    for (int i = 0; i < ttitles.len (); i ++)
+    {
+        CDDBTrack & track = info.tracks[i];
+
+        if (ttitles[i])
+            split_title (ttitles[i], track.artist, track.title);
+        if (! track.artist)
+            track.artist = info.artist;
+    }
+
+    return true;
+}
+
+static bool read_xmcd (const char * path, const CDDBToc & toc, int tolerance,
+ CDDBInfo & info)
+{
+    VFSFile file (filename_to_uri (path), "r");
+    if (! file)
+        return false;
+
+    Index<char> data = file.read_all ();
+    data.append (0);
+
+    return parse_xmcd (data.begin (), toc, tolerance, info);
+}
+
+static bool lookup_dump (const CDDBToc & toc, CDDBInfo & info)
+{
+    String setting = aud_get_str ("CDDA", "cddb_dump");
+    if (! setting[0])
+        return false;
+
+    StringBuf dir = strstr (setting, "://") ? uri_to_filename (setting) : str_copy (setting);
+    if (! dir)
+        return false;
+
+    GDir * handle = g_dir_open (dir, 0, nullptr);
+    if (! handle)
+    {
+        AUDERR ("Cannot open freedb dump %s.\n", (const char *) dir);
+        return false;
+    }
+
+    bool found = false;
+    const char * category;
+
+    /* the disc ID may be listed in several categories */
+    while (! found && (category = g_dir_read_name (handle)))
+    {
+        StringBuf path = filename_build ({dir, category, str_printf ("%08x", toc.discid)});
+
+        if (g_file_test (path, G_FILE_TEST_IS_REGULAR) &&
+         read_xmcd (path, toc, DUMP_TOLERANCE, info))
+        {
+            AUDDBG ("Found disc %08x in freedb dump (%s).\n", toc.discid, category);
+            found = true;
+        }
+    }
+
+    g_dir_close (handle);
+    return found;
+}
+
+bool cddb_cache_lookup (const CDDBToc & toc, CDDBInfo & info, bool & stale)
+{
+    StringBuf path = cache_path (toc);
+
+    GStatBuf st;
+    if (g_stat (path, & st) == 0 && read_xmcd (path, toc, 0, info))
+    {
+        stale = (time (nullptr) - st.st_mtime > REFRESH_DAYS * 24 * 3600);
+        AUDDBG ("Found disc %08x in CDDB cache%s.\n", toc.discid, stale ? " (stale)" : "");
+        return true;
+    }
+
+    stale = false;
+    return lookup_dump (toc, info);
+}
+
+static void add_line (Index<char> & out, const char * key, const char * value)
+{
+    out.insert (key, -1, strlen (key));
+    out.append ('=');
+
+    for (const char * p = value; * p; p ++)
+    {
+        if (* p == '\n' || * p == '\t' || * p == '\\')
+        {
+            out.append ('\\');
+            out.append ((* p == '\n') ? 'n' : (* p == '\t') ? 't' : '\\');
+        }
+        else
+            out.append (* p);
+    }
+
+    out.append ('\n');
+}
+
+static void add_text (Index<char> & out, const char * text)
+{
+    out.insert (text, -1, strlen (text));
+}
+
+void cddb_cache_store (const CDDBToc & toc, const CDDBInfo & info)
+{
+    StringBuf path = cache_path (toc);
+    StringBuf dir = filename_get_parent (path);
+
+    if (g_mkdir_with_parents (dir, 0755) < 0)
+    {
+        AUDERR ("Failed to create %s: %s\n", (const char *) dir, strerror (errno));
+        return;
+    }
+
+    const char * artist = info.artist ? (const char *) info.artist : "";
+    const char * title = info.title ? (const char *) info.title : "";
+
+    Index<char> out;
+    add_text (out, "# xmcd\n#\n# Track frame offsets:\n");
+
+    for (int offset : toc.offsets)
+        add_text (out, str_printf ("#\t%d\n", offset));
+
+    add_text (out, str_printf ("#\n# Disc length: %d seconds\n#\n", toc.length));
+
+    add_line (out, "DISCID", str_printf ("%08x", toc.discid));
+    add_line (out, "DTITLE", str_concat ({artist, " / ", title}));
+    add_line (out, "DGENRE", info.genre ? (const char *) info.genre : "");
+
+    for (int i = 0; i < info.tracks.len (); i ++)
+    {
+        const CDDBTrack & track = info.tracks[i];
+        const char * track_title = track.title ? (const char *) track.title : "";
+
+        if (track.artist && strcmp (track.artist, artist))
+            add_line (out, str_printf ("TTITLE%d", i),
+             str_concat ({track.artist, " / ", track_title}));
+        else
+            add_line (out, str_printf ("TTITLE%d", i), track_title);
+    }
+
+    add_line (out, "PLAYORDER", "");
+
+    VFSFile file (filename_to_uri (path), "w");
+    if (! file || file.fwrite (out.begin (), 1, out.len ()) != out.len ())
+        AUDERR ("Failed to write %s.\n", (const char *) path);
+    else
+        AUDDBG ("Cached disc %08x.\n", toc.discid);
+}
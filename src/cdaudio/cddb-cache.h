@@ -0,0 +1,54 @@
+/*
+ * Local CDDB cache for the Audio CD plugin
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef CDAUDIO_CDDB_CACHE_H
+#define CDAUDIO_CDDB_CACHE_H
+
+#include <libaudcore/index.h>
+#include <libaudcore/objects.h>
+
+/* The table of contents of a disc, as used for CDDB lookups. */
+struct CDDBToc
+{
+    unsigned discid = 0;
+    int length = 0;         /* seconds */
+    Index<int> offsets;     /* start of each track, in frames */
+};
+
+struct CDDBTrack
+{
+    String artist, title;
+};
+
+struct CDDBInfo
+{
+    String artist, title, genre;
+    Index<CDDBTrack> tracks;    /* in the same order as CDDBToc::offsets */
+};
+
+/* Looks for the disc in the local cache, then in the freedb dump set in the
+ * preferences (a directory of <category>/<discid> files).  Entries are keyed
+ * on the disc ID and checked against the whole table of contents.  <stale> is
+ * set if a cached entry is old enough that it should be fetched again. */
+bool cddb_cache_lookup (const CDDBToc & toc, CDDBInfo & info, bool & stale);
+
+/* Writes an entry to the local cache (in xmcd format). */
+void cddb_cache_store (const CDDBToc & toc, const CDDBInfo & info);
+
+#endif // CDAUDIO_CDDB_CACHE_H
@@ -18,6 +18,8 @@
 #include "Music_Emu.h"
 #include "Gzip_Reader.h"
 
+#include "../decoder-common/mapped-file.h"
+
 static const int fade_threshold = 10 * 1000;
 static const int fade_length    = 8 * 1000;
 
@@ -37,7 +39,10 @@ static void log_warning(Music_Emu * emu)
 
 /* Handles URL parsing, file opening and identification, and file
  * loading. Keeps file header around when loading rest of file to
- * avoid seeking and re-reading.
+ * avoid seeking and re-reading.  Uncompressed local files are mapped
+ * and loaded from memory instead; several emulators (SPC, VGM, GYM,
+ * AY, SAP) play straight from the loaded data, so the mapping is kept
+ * for as long as the emulator.
  */
 class ConsoleFileHandler {
 public:
@@ -58,6 +63,7 @@ public:
 
 private:
     char m_header[4];
+    MappedFile m_map;
     Vfs_File_Reader vfs_in;
     Gzip_Reader gzip_in;
 };
@@ -74,15 +80,32 @@ ConsoleFileHandler::ConsoleFileHandler(const char *path, VFSFile &fd)
 
     m_track -= 1;
 
-    // open vfs
-    vfs_in.reset(fd);
+    // gzipped files (.vgz) still go through gzip_reader
+    if (m_map.open(m_path) && (m_map.size() < (int64_t)sizeof(m_header) ||
+     !memcmp(m_map.data(), "\x1f\x8b", 2)))
+        m_map.close();
 
-    // now open gzip_reader on top of vfs
-    if (log_err(gzip_in.open(&vfs_in)))
-        return;
+    bool have_header = false;
 
-    // read and identify header
-    if (!log_err(gzip_in.read(m_header, sizeof(m_header))))
+    if (m_map.mapped())
+    {
+        memcpy(m_header, m_map.data(), sizeof(m_header));
+        have_header = true;
+    }
+    else
+    {
+        // open vfs
+        vfs_in.reset(fd);
+
+        // now open gzip_reader on top of vfs
+        if (log_err(gzip_in.open(&vfs_in)))
+            return;
+
+        have_header = !log_err(gzip_in.read(m_header, sizeof(m_header)));
+    }
+
+    // identify header
+    if (have_header)
     {
         m_type = gme_identify_extension(gme_identify_header(m_header));
         if (!m_type)
@@ -111,10 +134,18 @@ int ConsoleFileHandler::load(int sample_rate)
         return 1;
     }
 
-    // combine header with remaining file data
-    Remaining_Reader reader(m_header, sizeof(m_header), &gzip_in);
-    if (log_err(m_emu->load(reader)))
-        return 1;
+    if (m_map.mapped())
+    {
+        if (log_err(m_emu->load_mem(m_map.data(), m_map.size())))
+            return 1;
+    }
+    else
+    {
+        // combine header with remaining file data
+        Remaining_Reader reader(m_header, sizeof(m_header), &gzip_in);
+        if (log_err(m_emu->load(reader)))
+            return 1;
+    }
 
     // files can be closed now
     gzip_in.close();
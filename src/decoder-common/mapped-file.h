@@ -0,0 +1,119 @@
+/*
+ * mapped-file.h
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef DECODER_COMMON_MAPPED_FILE_H
+#define DECODER_COMMON_MAPPED_FILE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/runtime.h>
+#include <libaudcore/templates.h>
+
+// Read-only memory mapping of a local file, for decoders whose libraries can
+// take their input from memory.  The data is read straight from the page
+// cache instead of being copied through VFSFile.  Only file:// URIs can be
+// mapped; callers fall back to VFSFile for anything else.
+//
+// Read errors are not reported: if the file is truncated while it is mapped,
+// touching a page past the new end raises SIGBUS.  Only map files that are
+// not expected to change while they are open.
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    void operator=(const MappedFile &) = delete;
+
+    bool open(const char * uri)
+    {
+        close();
+
+#ifdef _WIN32
+        return false;
+#else
+        if (strncmp(uri, "file://", 7))
+            return false;
+
+        StringBuf path = uri_to_filename(uri);
+        if (!path)
+            return false;
+
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        void * data = MAP_FAILED;
+
+        if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0)
+            data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        ::close(fd);
+
+        if (data == MAP_FAILED)
+            return false;
+
+        // decoders mostly read front to back.  Only the head of the file is
+        // fetched up front, since probing and tag reading may go no further;
+        // past that, the kernel's sequential read-ahead takes over.
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+        madvise(data, aud::min((int64_t)st.st_size, prefetch_size), MADV_WILLNEED);
+
+        AUDDBG("Mapped %s (%ld bytes).\n", (const char *)path, (long)st.st_size);
+
+        m_data = data;
+        m_size = st.st_size;
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#ifndef _WIN32
+        if (m_data)
+            munmap(m_data, m_size);
+#endif
+
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    bool mapped() const { return m_data != nullptr; }
+    const void * data() const { return m_data; }
+    int64_t size() const { return m_size; }
+
+private:
+    static constexpr int64_t prefetch_size = 256 * 1024;
+
+    void * m_data = nullptr;
+    int64_t m_size = 0;
+};
+
+#endif // DECODER_COMMON_MAPPED_FILE_H
@@ -0,0 +1,59 @@
+/*
+ * playlist-next.h
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef DECODER_COMMON_PLAYLIST_NEXT_H
+#define DECODER_COMMON_PLAYLIST_NEXT_H
+
+#include <libaudcore/playlist.h>
+#include <libaudcore/runtime.h>
+
+// Returns the file name of the entry expected to play after the current one:
+// the head of the queue, or else the following entry of the playing playlist
+// (wrapping around if repeat is on).  With shuffle on and nothing queued the
+// next entry cannot be predicted and an empty String is returned.  Used by
+// plugins that prepare the next track (or its art) ahead of time.
+static inline String playlist_next_filename()
+{
+    auto playlist = Playlist::playing_playlist();
+    if (playlist.index() < 0)
+        return String();
+
+    int next;
+
+    if (playlist.n_queued())
+        next = playlist.queue_get_entry(0);
+    else if (aud_get_bool("shuffle"))
+        return String();
+    else
+    {
+        next = playlist.get_position() + 1;
+
+        if (next >= playlist.n_entries())
+        {
+            if (!aud_get_bool("repeat"))
+                return String();
+
+            next = 0;
+        }
+    }
+
+    return playlist.entry_filename(next);
+}
+
+#endif // DECODER_COMMON_PLAYLIST_NEXT_H
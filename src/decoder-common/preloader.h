@@ -0,0 +1,170 @@
+/*
+ * preloader.h
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef DECODER_COMMON_PRELOADER_H
+#define DECODER_COMMON_PRELOADER_H
+
+#include <pthread.h>
+#include <string.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/index.h>
+#include <libaudcore/objects.h>
+#include <libaudcore/runtime.h>
+
+#include "playlist-next.h"
+
+// Loads the file expected to play next on a worker thread while the current
+// one plays, so that reading and parsing a large file does not cause a pause
+// at the track change.  The loader must not depend on global state that the
+// playback thread may change meanwhile.
+//
+// take() waits only for a preload of the requested file.  A preload of any
+// other file is abandoned: the worker runs to completion on its own and is
+// joined later, so skipping to an unrelated track never blocks.  Only used
+// from the playback thread (and from plugin cleanup).
+template<class T>
+class Preloader
+{
+public:
+    typedef T * (*LoadFunc)(const char * filename);
+
+    Preloader(LoadFunc load) : m_load(load) {}
+    ~Preloader() { shutdown(); }
+
+    Preloader(const Preloader &) = delete;
+    void operator=(const Preloader &) = delete;
+
+    // starts preloading the next entry if it has one of the given extensions
+    void start(const char * current, const char * const * exts)
+    {
+        clear();
+
+        String filename = playlist_next_filename();
+        if (!filename || !strcmp(filename, current))
+            return;
+
+        StringBuf ext = uri_get_extension(filename);
+        if (!ext)
+            return;
+
+        bool supported = false;
+        for (auto e = exts; *e && !supported; e++)
+            supported = !strcmp_nocase(ext, *e);
+
+        if (!supported)
+            return;
+
+        SmartPtr<Job> job(new Job);
+        job->filename = filename;
+        job->load = m_load;
+
+        if (!pthread_create(&job->thread, nullptr, run, job.get()))
+            m_job = std::move(job);
+    }
+
+    // returns the preloaded object for <filename>, or nullptr
+    SmartPtr<T> take(const char * filename)
+    {
+        SmartPtr<T> result;
+
+        if (m_job && !strcmp(m_job->filename, filename))
+        {
+            pthread_join(m_job->thread, nullptr);
+
+            if (m_job->result)
+            {
+                AUDDBG("Using preloaded %s\n", filename);
+                result = std::move(m_job->result);
+            }
+
+            m_job.clear();
+        }
+
+        clear();
+        return result;
+    }
+
+    // drops the current preload without waiting for it
+    void clear()
+    {
+        if (m_job)
+            m_abandoned.append(std::move(m_job));
+
+        reap(false);
+    }
+
+    // drops everything, waiting for all workers
+    void shutdown()
+    {
+        clear();
+        reap(true);
+    }
+
+private:
+    struct Job
+    {
+        String filename;
+        LoadFunc load;
+        pthread_t thread;
+        pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        bool done = false;
+        SmartPtr<T> result;
+    };
+
+    static void * run(void * data)
+    {
+        auto job = (Job *)data;
+        T * result = job->load(job->filename);
+
+        pthread_mutex_lock(&job->mutex);
+        job->result.capture(result);
+        job->done = true;
+        pthread_mutex_unlock(&job->mutex);
+
+        return nullptr;
+    }
+
+    // joins abandoned workers (only finished ones unless <wait> is set)
+    void reap(bool wait)
+    {
+        for (int i = 0; i < m_abandoned.len();)
+        {
+            Job * job = m_abandoned[i].get();
+
+            pthread_mutex_lock(&job->mutex);
+            bool done = job->done;
+            pthread_mutex_unlock(&job->mutex);
+
+            if (done || wait)
+            {
+                pthread_join(job->thread, nullptr);
+                m_abandoned.remove(i, 1);
+            }
+            else
+                i++;
+        }
+    }
+
+    LoadFunc m_load;
+    SmartPtr<Job> m_job;
+    Index<SmartPtr<Job>> m_abandoned;
+};
+
+#endif // DECODER_COMMON_PRELOADER_H
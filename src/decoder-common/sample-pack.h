@@ -0,0 +1,111 @@
+/*
+ * sample-pack.h
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef DECODER_COMMON_SAMPLE_PACK_H
+#define DECODER_COMMON_SAMPLE_PACK_H
+
+#include <stdint.h>
+
+// Output stage shared by the lossless decoders, which produce 32-bit integer
+// samples.  The samples are interleaved (if needed) and narrowed to the
+// output format (FMT_S8, FMT_S16_NE or 24/32 bits in FMT_S32_NE) in a single
+// pass, straight into the buffer that is passed to write_audio().  The loops
+// are kept simple, with the common channel counts split out, so that the
+// compiler can vectorize them.
+
+namespace sample_pack
+{
+
+// bytes per sample in the output format
+static inline int sample_size(int bits)
+{
+    return bits <= 8 ? 1 : bits <= 16 ? 2 : 4;
+}
+
+template<class T>
+static inline void planar(const int32_t * const * src, int offset,
+                          int channels, int frames, T * __restrict dst)
+{
+    if (channels == 1)
+    {
+        const int32_t * __restrict a = src[0] + offset;
+
+        for (int i = 0; i < frames; i++)
+            dst[i] = (T)a[i];
+    }
+    else if (channels == 2)
+    {
+        const int32_t * __restrict a = src[0] + offset;
+        const int32_t * __restrict b = src[1] + offset;
+
+        for (int i = 0; i < frames; i++)
+        {
+            dst[2 * i] = (T)a[i];
+            dst[2 * i + 1] = (T)b[i];
+        }
+    }
+    else
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            const int32_t * __restrict a = src[c] + offset;
+            T * __restrict d = dst + c;
+
+            for (int i = 0; i < frames; i++)
+                d[i * channels] = (T)a[i];
+        }
+    }
+}
+
+template<class T>
+static inline void interleaved(const int32_t * __restrict src, int samples,
+                               T * __restrict dst)
+{
+    for (int i = 0; i < samples; i++)
+        dst[i] = (T)src[i];
+}
+
+// Packs <frames> frames of planar samples, beginning at frame <offset> of
+// each channel buffer, into <dst> as interleaved samples.
+static inline void pack_planar(const int32_t * const * src, int offset,
+                               int channels, int frames, void * dst, int bits)
+{
+    if (bits <= 8)
+        planar(src, offset, channels, frames, (int8_t *)dst);
+    else if (bits <= 16)
+        planar(src, offset, channels, frames, (int16_t *)dst);
+    else
+        planar(src, offset, channels, frames, (int32_t *)dst);
+}
+
+// Narrows <samples> interleaved samples into <dst>.
+static inline void pack_interleaved(const int32_t * src, int samples,
+                                    void * dst, int bits)
+{
+    if (bits <= 8)
+        interleaved(src, samples, (int8_t *)dst);
+    else if (bits <= 16)
+        interleaved(src, samples, (int16_t *)dst);
+    else
+        interleaved(src, samples, (int32_t *)dst);
+}
+
+} // namespace sample_pack
+
+#endif // DECODER_COMMON_SAMPLE_PACK_H
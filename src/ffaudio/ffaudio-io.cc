@@ -19,31 +19,87 @@
 #define WANT_VFS_STDIO_COMPAT
 #include "ffaudio-stdinc.h"
 
+#include "../decoder-common/mapped-file.h"
+
 #define IOBUF 4096
 
-static int read_cb (void * file, unsigned char * buf, int size)
+/* Local files are read from a memory mapping, which saves a copy through
+ * VFSFile.  Anything else goes through VFSFile as before. */
+struct IOHandle
+{
+    VFSFile * file;
+    MappedFile map;
+    int64_t pos = 0;
+};
+
+static int read_cb (void * data, unsigned char * buf, int size)
 {
-    int ret = ((VFSFile *) file)->fread (buf, 1, size);
+    auto h = (IOHandle *) data;
+
+    if (h->map.mapped ())
+    {
+        int64_t avail = h->map.size () - h->pos;
+        int ret = aud::min ((int64_t) size, aud::max (avail, (int64_t) 0));
+
+        if (ret <= 0)
+            return AVERROR_EOF;
+
+        memcpy (buf, (const char *) h->map.data () + h->pos, ret);
+        h->pos += ret;
+        return ret;
+    }
+
+    int ret = h->file->fread (buf, 1, size);
     return (ret > 0) ? ret : AVERROR_EOF;
 }
 
-static int64_t seek_cb (void * file, int64_t offset, int whence)
+static int64_t seek_cb (void * data, int64_t offset, int whence)
 {
+    auto h = (IOHandle *) data;
+
+    if (h->map.mapped ())
+    {
+        int64_t pos;
+
+        switch (whence & ~(int) AVSEEK_FORCE)
+        {
+        case AVSEEK_SIZE: return h->map.size ();
+        case SEEK_SET: pos = offset; break;
+        case SEEK_CUR: pos = h->pos + offset; break;
+        case SEEK_END: pos = h->map.size () + offset; break;
+        default: return -1;
+        }
+
+        if (pos < 0)
+            return -1;
+
+        h->pos = pos;
+        return pos;
+    }
+
     if (whence == AVSEEK_SIZE)
-        return ((VFSFile *) file)->fsize ();
-    if (((VFSFile *) file)->fseek (offset, to_vfs_seek_type (whence & ~(int) AVSEEK_FORCE)))
+        return h->file->fsize ();
+    if (h->file->fseek (offset, to_vfs_seek_type (whence & ~(int) AVSEEK_FORCE)))
         return -1;
-    return ((VFSFile *) file)->ftell ();
+    return h->file->ftell ();
 }
 
 AVIOContext * io_context_new (VFSFile & file)
 {
+    auto h = new IOHandle;
+    h->file = & file;
+
+    /* start where the format probe left the file */
+    if (h->map.open (file.filename ()))
+        h->pos = aud::max (file.ftell (), (int64_t) 0);
+
     void * buf = av_malloc (IOBUF);
-    return avio_alloc_context ((unsigned char *) buf, IOBUF, 0, & file, read_cb, nullptr, seek_cb);
+    return avio_alloc_context ((unsigned char *) buf, IOBUF, 0, h, read_cb, nullptr, seek_cb);
 }
 
 void io_context_free (AVIOContext * io)
 {
+    delete (IOHandle *) io->opaque;
     av_free (io->buffer);
     av_free (io);
 }
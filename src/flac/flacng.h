@@ -24,6 +24,9 @@
 
 #include <libaudcore/i18n.h>
 #include <libaudcore/plugin.h>
+#include <libaudcore/preferences.h>
+
+struct callback_info;
 
 class FLACng : public InputPlugin
 {
@@ -31,11 +34,15 @@ public:
     static const char about[];
     static const char *const exts[];
     static const char *const mimes[];
+    static const char *const defaults[];
+    static const PreferencesWidget widgets[];
+    static const PluginPreferences prefs;
 
     static constexpr PluginInfo info = {
         N_("FLAC Decoder"),
         PACKAGE,
-        about
+        about,
+        &prefs
     };
 
     constexpr FLACng() : InputPlugin(info, InputInfo(FlagWritesTag)
@@ -50,6 +57,10 @@ public:
     bool read_tag(const char *filename, VFSFile &file, Tuple &tuple, Index<char> *image);
     bool write_tuple(const char *filename, VFSFile &file, const Tuple &tuple);
     bool play(const char *filename, VFSFile &file);
+
+private:
+    /* parallel.cc */
+    bool play_parallel(const char *filename, const callback_info &cinfo);
 };
 
 #define BUFFER_SIZE_SAMP (FLAC__MAX_BLOCK_SIZE * FLAC__MAX_CHANNELS)
@@ -64,25 +75,34 @@ struct callback_info
     unsigned sample_rate = 0;
     unsigned channels = 0;
     unsigned long total_samples = 0;
-    Index<int32_t> output_buffer;
-    int32_t *write_pointer = nullptr;
-    unsigned buffer_used = 0;
+    Index<char> output_buffer; /* in the output format */
+    unsigned buffer_used = 0;  /* in samples */
     VFSFile *fd = nullptr;
     int bitrate = 0;
 
     void alloc()
     {
-        output_buffer.resize(BUFFER_SIZE_SAMP);
+        output_buffer.resize(BUFFER_SIZE_BYTE);
         reset();
     }
 
     void reset()
     {
         buffer_used = 0;
-        write_pointer = output_buffer.begin();
     }
 };
 
+using StreamDecoderPtr = SmartPtr<FLAC__StreamDecoder, FLAC__stream_decoder_delete>;
+
+/* A decoder together with the state its callbacks work on.  Decoders are
+ * taken from a pool, so that several files can be decoded at once. */
+struct FLACDecoder
+{
+    StreamDecoderPtr decoder;
+    callback_info cinfo;
+    bool ogg = false;
+};
+
 /* metadata.c */
 bool flac_update_song_tuple(const char *filename, VFSFile &fd, const Tuple &tuple);
 Index<char> flac_get_image(const char *filename, VFSFile &fd);
@@ -102,4 +122,10 @@ void metadata_callback(const FLAC__StreamDecoder *decoder, const FLAC__StreamMet
 bool is_ogg_flac(VFSFile &file);
 bool read_metadata(FLAC__StreamDecoder* decoder, callback_info* info);
 
+FLACDecoder *flac_decoder_get(bool ogg);
+void flac_decoder_put(FLACDecoder *dec);
+void flac_decoder_pool_clear();
+
+using FLACDecoderPtr = SmartPtr<FLACDecoder, flac_decoder_put>;
+
 #endif
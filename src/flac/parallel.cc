@@ -0,0 +1,324 @@
+/*
+ *  A FLAC decoder plugin for the Audacious Media Player
+ *  Copyright (C) 2026 Audacious developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Bulk decoding mode.  FLAC frames can be decoded independently, so the
+ * stream is split into chunks of CHUNK_SAMPLES samples which are decoded by a
+ * pool of worker threads, each with its own decoder and file handle.  A worker
+ * positions its decoder with FLAC__stream_decoder_seek_absolute(), which finds
+ * the frame boundary using the seek table or by scanning for the frame sync
+ * code.  The decoded chunks are passed on to the output in order; at most
+ * 2 * workers chunks are held at once.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+
+#include <libaudcore/runtime.h>
+
+#include "flacng.h"
+
+static constexpr int CHUNK_SAMPLES = 1 << 17;
+static constexpr int MAX_WORKERS = 8;
+
+struct ParallelChunk
+{
+    enum State { Queued, Busy, Done, Failed };
+
+    int64_t start, end;
+    State state = Queued;
+    Index<char> data;
+};
+
+struct ParallelWorker
+{
+    VFSFile file;
+    FLACDecoderPtr dec;
+    pthread_t thread;
+    struct ParallelDecode * owner;
+};
+
+struct ParallelDecode
+{
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+    pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+    unsigned channels, bits_per_sample;
+    int64_t total_samples;
+
+    Index<SmartPtr<ParallelChunk>> window;
+    int max_window = 0;
+    int64_t next_start = 0;
+    int generation = 0;
+    int busy = 0;
+    bool quit = false;
+
+    Index<SmartPtr<ParallelWorker>> workers;
+
+    void refill ();
+    void restart (int64_t start);
+};
+
+/* called with the mutex locked */
+void ParallelDecode::refill ()
+{
+    while (window.len () < max_window && next_start < total_samples)
+    {
+        auto chunk = new ParallelChunk;
+        chunk->start = next_start;
+        chunk->end = aud::min (next_start + CHUNK_SAMPLES, total_samples);
+        window.append (SmartPtr<ParallelChunk> (chunk));
+
+        next_start = chunk->end;
+    }
+
+    pthread_cond_broadcast (& work_cond);
+}
+
+/* called with the mutex locked */
+void ParallelDecode::restart (int64_t start)
+{
+    generation ++;
+
+    /* chunks being decoded are still referenced by the workers */
+    while (busy)
+        pthread_cond_wait (& done_cond, & mutex);
+
+    window.clear ();
+    next_start = start;
+    refill ();
+}
+
+static bool decode_chunk (ParallelWorker * worker, ParallelChunk * chunk, int generation)
+{
+    ParallelDecode * pd = worker->owner;
+    FLAC__StreamDecoder * decoder = worker->dec->decoder.get ();
+    callback_info & cinfo = worker->dec->cinfo;
+
+    int sample_size = SAMPLE_SIZE (pd->bits_per_sample);
+    int64_t pos = chunk->start;
+
+    cinfo.reset ();
+
+    /* the frame containing the start position is delivered during the seek,
+     * trimmed so that it begins at exactly that position */
+    if (! FLAC__stream_decoder_seek_absolute (decoder, chunk->start))
+    {
+        AUDERR ("Could not seek to sample %ld!\n", (long) chunk->start);
+        FLAC__stream_decoder_flush (decoder);
+        return false;
+    }
+
+    while (true)
+    {
+        int64_t frames = aud::min ((int64_t) (cinfo.buffer_used / pd->channels),
+         chunk->end - pos);
+
+        if (frames > 0)
+        {
+            int samples = frames * pd->channels;
+            chunk->data.insert (cinfo.output_buffer.begin (), -1, samples * sample_size);
+
+            pos += frames;
+        }
+
+        cinfo.reset ();
+
+        if (pos >= chunk->end ||
+         FLAC__stream_decoder_get_state (decoder) == FLAC__STREAM_DECODER_END_OF_STREAM)
+            return true;
+
+        /* give up early if the chunk has been discarded by a seek */
+        pthread_mutex_lock (& pd->mutex);
+        bool discarded = (pd->generation != generation);
+        pthread_mutex_unlock (& pd->mutex);
+
+        if (discarded)
+            return false;
+
+        if (! FLAC__stream_decoder_process_single (decoder))
+        {
+            AUDERR ("Error while decoding!\n");
+            return false;
+        }
+    }
+}
+
+static void * worker_thread (void * data)
+{
+    auto worker = (ParallelWorker *) data;
+    ParallelDecode * pd = worker->owner;
+
+    pthread_mutex_lock (& pd->mutex);
+
+    while (! pd->quit)
+    {
+        ParallelChunk * chunk = nullptr;
+
+        for (auto & c : pd->window)
+        {
+            if (c->state == ParallelChunk::Queued)
+            {
+                chunk = c.get ();
+                break;
+            }
+        }
+
+        if (! chunk)
+        {
+            pthread_cond_wait (& pd->work_cond, & pd->mutex);
+            continue;
+        }
+
+        int generation = pd->generation;
+        chunk->state = ParallelChunk::Busy;
+        pd->busy ++;
+
+        pthread_mutex_unlock (& pd->mutex);
+        bool success = decode_chunk (worker, chunk, generation);
+        pthread_mutex_lock (& pd->mutex);
+
+        chunk->state = success ? ParallelChunk::Done : ParallelChunk::Failed;
+        pd->busy --;
+
+        pthread_cond_broadcast (& pd->done_cond);
+    }
+
+    pthread_mutex_unlock (& pd->mutex);
+    return nullptr;
+}
+
+static ParallelWorker * create_worker (const char * filename)
+{
+    SmartPtr<ParallelWorker> worker (new ParallelWorker);
+
+    worker->file = VFSFile (filename, "r");
+    if (! worker->file)
+        return nullptr;
+
+    worker->dec.capture (flac_decoder_get (false));
+    if (! worker->dec)
+        return nullptr;
+
+    /* the stream info is read again when the decoder is first positioned */
+    worker->dec->cinfo.fd = & worker->file;
+
+    if (! FLAC__stream_decoder_reset (worker->dec->decoder.get ()))
+        return nullptr;
+
+    return worker.release ();
+}
+
+bool FLACng::play_parallel (const char * filename, const callback_info & cinfo)
+{
+    int n_workers = aud::clamp ((int) std::thread::hardware_concurrency (), 1, MAX_WORKERS);
+
+    ParallelDecode pd;
+    pd.channels = cinfo.channels;
+    pd.bits_per_sample = cinfo.bits_per_sample;
+    pd.total_samples = cinfo.total_samples;
+    pd.max_window = 2 * n_workers;
+
+    for (int i = 0; i < n_workers; i ++)
+    {
+        ParallelWorker * worker = create_worker (filename);
+        if (! worker)
+        {
+            AUDERR ("Could not create a FLAC decoder for parallel decoding!\n");
+            return false;
+        }
+
+        worker->owner = & pd;
+        pd.workers.append (SmartPtr<ParallelWorker> (worker));
+    }
+
+    auto start_time = std::chrono::steady_clock::now ();
+    int64_t decoded = 0;
+    bool error = false;
+
+    pthread_mutex_lock (& pd.mutex);
+    pd.refill ();
+    pthread_mutex_unlock (& pd.mutex);
+
+    int started = 0;
+    for (auto & worker : pd.workers)
+    {
+        if (pthread_create (& worker->thread, nullptr, worker_thread, worker.get ()))
+            break;
+
+        started ++;
+    }
+
+    while (started && ! check_stop ())
+    {
+        int seek_value = check_seek ();
+
+        pthread_mutex_lock (& pd.mutex);
+
+        if (seek_value >= 0)
+            pd.restart (aud::min ((int64_t) seek_value * cinfo.sample_rate / 1000,
+             pd.total_samples));
+
+        if (! pd.window.len ())
+        {
+            pthread_mutex_unlock (& pd.mutex);
+            break;
+        }
+
+        while (pd.window[0]->state == ParallelChunk::Queued ||
+         pd.window[0]->state == ParallelChunk::Busy)
+            pthread_cond_wait (& pd.done_cond, & pd.mutex);
+
+        SmartPtr<ParallelChunk> chunk = std::move (pd.window[0]);
+        pd.window.remove (0, 1);
+        pd.refill ();
+
+        pthread_mutex_unlock (& pd.mutex);
+
+        if (chunk->state == ParallelChunk::Failed)
+        {
+            error = true;
+            break;
+        }
+
+        write_audio (chunk->data.begin (), chunk->data.len ());
+        decoded += chunk->end - chunk->start;
+    }
+
+    pthread_mutex_lock (& pd.mutex);
+    pd.quit = true;
+    pd.generation ++;
+    pthread_cond_broadcast (& pd.work_cond);
+    pthread_mutex_unlock (& pd.mutex);
+
+    for (int i = 0; i < started; i ++)
+        pthread_join (pd.workers[i]->thread, nullptr);
+
+    double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - start_time).count ();
+    double audio = (double) decoded / cinfo.sample_rate;
+
+    AUDDBG ("Parallel decode: %d workers, %.1f s of audio in %.2f s (%.1fx realtime).\n",
+     started, audio, elapsed, elapsed > 0 ? audio / elapsed : 0.0);
+
+    return started && ! error;
+}
@@ -26,63 +26,41 @@
 
 EXPORT FLACng aud_plugin_instance;
 
-using StreamDecoderPtr = SmartPtr<FLAC__StreamDecoder, FLAC__stream_decoder_delete>;
-static StreamDecoderPtr s_decoder, s_ogg_decoder;
-static callback_info s_cinfo;
+const char *const FLACng::defaults[] = {
+    "parallel_decode", "FALSE",
+    nullptr
+};
+
+const PreferencesWidget FLACng::widgets[] = {
+    WidgetLabel(N_("<b>Advanced</b>")),
+    WidgetCheck(N_("Decode on multiple threads (for conversion and analysis)"),
+        WidgetBool("flacng", "parallel_decode"))
+};
+
+const PluginPreferences FLACng::prefs = {{widgets}};
 
 bool FLACng::init()
 {
-    /* Callback structure and decoder for main decoding loop */
-    auto flac_decoder = StreamDecoderPtr(FLAC__stream_decoder_new());
-    if (!flac_decoder)
-    {
-        AUDERR("Could not create the main FLAC decoder instance!\n");
-        return false;
-    }
-
-    auto ret1 = FLAC__stream_decoder_init_stream(flac_decoder.get(),
-        read_callback, seek_callback, tell_callback, length_callback,
-        eof_callback, write_callback, metadata_callback, error_callback,
-        &s_cinfo);
+    aud_config_set_defaults("flacng", defaults);
 
-    if (ret1 != FLAC__STREAM_DECODER_INIT_STATUS_OK)
-    {
-        AUDERR("Could not initialize the main FLAC decoder!\n");
+    /* Make sure that decoders can be created, and keep them for later */
+    FLACDecoderPtr flac_decoder(flac_decoder_get(false));
+    if (!flac_decoder)
         return false;
-    }
 
     if (FLAC_API_SUPPORTS_OGG_FLAC)
     {
-        auto ogg_flac_decoder = StreamDecoderPtr(FLAC__stream_decoder_new());
+        FLACDecoderPtr ogg_flac_decoder(flac_decoder_get(true));
         if (!ogg_flac_decoder)
-        {
-            AUDERR("Could not create the Ogg FLAC decoder instance!\n");
-            return false;
-        }
-
-        auto ret2 = FLAC__stream_decoder_init_ogg_stream(ogg_flac_decoder.get(),
-            read_callback, seek_callback, tell_callback, length_callback,
-            eof_callback, write_callback, metadata_callback, error_callback,
-            &s_cinfo);
-
-        if (ret2 != FLAC__STREAM_DECODER_INIT_STATUS_OK)
-        {
-            AUDERR("Could not initialize the Ogg FLAC decoder!\n");
             return false;
-        }
-
-        s_ogg_decoder = std::move(ogg_flac_decoder);
     }
 
-    s_decoder = std::move(flac_decoder);
-
     return true;
 }
 
 void FLACng::cleanup()
 {
-    s_decoder.clear();
-    s_ogg_decoder.clear();
+    flac_decoder_pool_clear();
 }
 
 bool FLACng::is_our_file(const char *filename, VFSFile &file)
@@ -96,45 +74,18 @@ bool FLACng::is_our_file(const char *filename, VFSFile &file)
     return ! strncmp (buf, "fLaC", sizeof buf);
 }
 
-static void squeeze_audio(int32_t* src, void* dst, unsigned count, unsigned res)
-{
-    int32_t* rp = src;
-    int8_t*  wp = (int8_t*) dst;
-    int16_t* wp2 = (int16_t*) dst;
-    int32_t* wp4 = (int32_t*) dst;
-
-    switch (res)
-    {
-        case 8:
-            for (unsigned i = 0; i < count; i++, wp++, rp++)
-                *wp = *rp & 0xff;
-            break;
-
-        case 16:
-            for (unsigned i = 0; i < count; i++, wp2++, rp++)
-                *wp2 = *rp & 0xffff;
-            break;
-
-        case 24:
-        case 32:
-            for (unsigned i = 0; i < count; i++, wp4++, rp++)
-                *wp4 = *rp;
-            break;
-
-        default:
-            AUDERR("Can not convert to %u bps\n", res);
-    }
-}
-
 bool FLACng::play(const char *filename, VFSFile &file)
 {
-    Index<char> play_buffer;
     bool error = false;
     bool stream = (file.fsize() < 0);
     bool _is_ogg_flac = is_ogg_flac(file);
     auto tuple = stream ? get_playback_tuple() : Tuple();
-    auto decoder = _is_ogg_flac && FLAC_API_SUPPORTS_OGG_FLAC
-                       ? s_ogg_decoder.get() : s_decoder.get();
+    FLACDecoderPtr dec(flac_decoder_get(_is_ogg_flac && FLAC_API_SUPPORTS_OGG_FLAC));
+    if (!dec)
+        return false;
+
+    auto decoder = dec->decoder.get();
+    callback_info &cinfo = dec->cinfo;
 
     if (_is_ogg_flac && !FLAC_API_SUPPORTS_OGG_FLAC)
     {
@@ -142,22 +93,28 @@ bool FLACng::play(const char *filename, VFSFile &file)
                 "this format. Falling back to the main FLAC decoder.\n");
     }
 
-    s_cinfo.fd = &file;
+    cinfo.fd = &file;
 
-    if (read_metadata(decoder, &s_cinfo) == false)
+    if (read_metadata(decoder, &cinfo) == false)
     {
         AUDERR("Could not prepare file for playing!\n");
         error = true;
         goto ERR;
     }
 
-    play_buffer.resize(BUFFER_SIZE_BYTE);
-
     if (stream && tuple.fetch_stream_info(file))
         set_playback_tuple(tuple.ref());
 
-    set_stream_bitrate(s_cinfo.bitrate);
-    open_audio(SAMPLE_FMT(s_cinfo.bits_per_sample), s_cinfo.sample_rate, s_cinfo.channels);
+    set_stream_bitrate(cinfo.bitrate);
+    open_audio(SAMPLE_FMT(cinfo.bits_per_sample), cinfo.sample_rate, cinfo.channels);
+
+    /* Bulk decoding needs a seekable file of known length */
+    if (!stream && !_is_ogg_flac && cinfo.total_samples &&
+        aud_get_bool("flacng", "parallel_decode"))
+    {
+        error = !play_parallel(filename, cinfo);
+        goto ERR;
+    }
 
     while (FLAC__stream_decoder_get_state(decoder) != FLAC__STREAM_DECODER_END_OF_STREAM)
     {
@@ -167,7 +124,7 @@ bool FLACng::play(const char *filename, VFSFile &file)
         int seek_value = check_seek ();
         if (seek_value >= 0)
             FLAC__stream_decoder_seek_absolute (decoder, (int64_t)
-             seek_value * s_cinfo.sample_rate / 1000);
+             seek_value * cinfo.sample_rate / 1000);
 
         /* Try to decode a single frame of audio */
         if (FLAC__stream_decoder_process_single(decoder) == false)
@@ -180,21 +137,14 @@ bool FLACng::play(const char *filename, VFSFile &file)
         if (stream && tuple.fetch_stream_info(file))
             set_playback_tuple(tuple.ref());
 
-        squeeze_audio(s_cinfo.output_buffer.begin(), play_buffer.begin(),
-         s_cinfo.buffer_used, s_cinfo.bits_per_sample);
-        write_audio(play_buffer.begin(), s_cinfo.buffer_used *
-         SAMPLE_SIZE(s_cinfo.bits_per_sample));
+        write_audio(cinfo.output_buffer.begin(), cinfo.buffer_used *
+         SAMPLE_SIZE(cinfo.bits_per_sample));
 
-        s_cinfo.reset();
+        cinfo.reset();
     }
 
 ERR:
-    s_cinfo.reset();
-
-    if (FLAC__stream_decoder_flush(decoder) == false)
-        AUDERR("Could not flush decoder state!\n");
-
-    s_cinfo = callback_info();
+    /* the decoder is flushed and returned to the pool */
     return ! error;
 }
 
@@ -24,6 +24,7 @@
 #include <libaudcore/runtime.h>
 
 #include "flacng.h"
+#include "../decoder-common/sample-pack.h"
 
 FLAC__StreamDecoderReadStatus read_callback(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client_data)
 {
@@ -125,14 +126,18 @@ FLAC__StreamDecoderWriteStatus write_callback(const FLAC__StreamDecoder *decoder
     if (!info->output_buffer.len())
         info->alloc();
 
-    for (unsigned sample = 0; sample < frame->header.blocksize; sample++)
-    {
-        for (unsigned channel = 0; channel < frame->header.channels; channel++)
-        {
-            *(info->write_pointer++) = buffer[channel][sample];
-            info->buffer_used += 1;
-        }
-    }
+    int sample_size = SAMPLE_SIZE(info->bits_per_sample);
+    int offset = info->buffer_used * sample_size;
+    int size = frame->header.blocksize * frame->header.channels * sample_size;
+
+    /* a seek can leave one frame in the buffer when the next one arrives */
+    if (offset + size > info->output_buffer.len())
+        info->output_buffer.insert(-1, offset + size - info->output_buffer.len());
+
+    sample_pack::pack_planar(buffer, 0, frame->header.channels,
+     frame->header.blocksize, &info->output_buffer[offset], sample_size * 8);
+
+    info->buffer_used += frame->header.blocksize * frame->header.channels;
 
     return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
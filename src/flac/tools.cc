@@ -19,12 +19,97 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <pthread.h>
 #include <string.h>
 
 #include <libaudcore/runtime.h>
 
 #include "flacng.h"
 
+/* idle decoders beyond this number are deleted */
+static constexpr int MAX_POOLED = 16;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static Index<FLACDecoder *> pool;
+
+static FLACDecoder * create_decoder(bool ogg)
+{
+    SmartPtr<FLACDecoder> dec(new FLACDecoder);
+
+    dec->decoder.capture(FLAC__stream_decoder_new());
+    if (!dec->decoder)
+    {
+        AUDERR("Could not create a FLAC decoder instance!\n");
+        return nullptr;
+    }
+
+    auto init = ogg ? FLAC__stream_decoder_init_ogg_stream : FLAC__stream_decoder_init_stream;
+
+    if (init(dec->decoder.get(), read_callback, seek_callback, tell_callback,
+        length_callback, eof_callback, write_callback, metadata_callback,
+        error_callback, &dec->cinfo) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+    {
+        AUDERR("Could not initialize the %s decoder!\n", ogg ? "Ogg FLAC" : "FLAC");
+        return nullptr;
+    }
+
+    dec->ogg = ogg;
+    return dec.release();
+}
+
+FLACDecoder * flac_decoder_get(bool ogg)
+{
+    pthread_mutex_lock(&pool_mutex);
+
+    for (int i = pool.len(); i--;)
+    {
+        if (pool[i]->ogg == ogg)
+        {
+            FLACDecoder * dec = pool[i];
+            pool.remove(i, 1);
+            pthread_mutex_unlock(&pool_mutex);
+            return dec;
+        }
+    }
+
+    pthread_mutex_unlock(&pool_mutex);
+
+    return create_decoder(ogg);
+}
+
+void flac_decoder_put(FLACDecoder *dec)
+{
+    if (FLAC__stream_decoder_flush(dec->decoder.get()) == false)
+        AUDERR("Could not flush decoder state!\n");
+
+    /* the client data pointer stays valid; the output buffer is freed */
+    dec->cinfo = callback_info();
+
+    pthread_mutex_lock(&pool_mutex);
+
+    if (pool.len() < MAX_POOLED)
+    {
+        pool.append(dec);
+        dec = nullptr;
+    }
+
+    pthread_mutex_unlock(&pool_mutex);
+
+    delete dec;
+}
+
+void flac_decoder_pool_clear()
+{
+    pthread_mutex_lock(&pool_mutex);
+
+    for (FLACDecoder * dec : pool)
+        delete dec;
+
+    pool.clear();
+
+    pthread_mutex_unlock(&pool_mutex);
+}
+
 bool is_ogg_flac(VFSFile &file)
 {
     /* TODO: detect Ogg FLAC by content too (not just MIME type) */
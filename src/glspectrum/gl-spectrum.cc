@@ -33,6 +33,8 @@
 
 #include <GL/gl.h>
 
+#include "../ui-common/vis-governor.h"
+
 #ifdef GDK_WINDOWING_X11
 #include <GL/glx.h>
 #include <gdk/gdkx.h>
@@ -95,15 +97,83 @@ static HGLRC s_glrc;
 #endif
 
 static GtkWidget * s_widget = nullptr;
+static VisGovernor governor ("OpenGL Spectrum Analyzer");
 
 static int s_pos = 0;
 static float s_angle = 25, s_anglespeed = 0.05f;
 static float s_bars[NUM_BANDS][NUM_BANDS];
 
+/* Each row of the history keeps its bars as a persistent vertex array, so
+ * only the newest row is rebuilt per frame.  The vertex colors hold just the
+ * brightness; the color gradient comes from a small texture indexed by the
+ * row's on-screen position, which changes as the history scrolls. */
+struct BarVertex {
+    float pos[3];
+    float shade[3];
+    float tex[2];
+};
+
+static constexpr int VERTS_PER_BAR = 16;
+
+static BarVertex s_rows[NUM_BANDS][NUM_BANDS * VERTS_PER_BAR];
+static GLuint s_texture;
+
+/* false while the widget or its window is hidden or minimized */
+static bool widget_visible ()
+{
+    if (! s_widget || ! gtk_widget_get_mapped (s_widget))
+        return false;
+
+    GdkWindow * window = gtk_widget_get_window (gtk_widget_get_toplevel (s_widget));
+    return window && ! (gdk_window_get_state (window) & GDK_WINDOW_STATE_ICONIFIED);
+}
+
+static BarVertex * add_quad (BarVertex * v, const float (* corners)[3],
+ float shade, float s)
+{
+    for (int n = 0; n < 4; n ++, v ++)
+    {
+        for (int c = 0; c < 3; c ++)
+        {
+            v->pos[c] = corners[n][c];
+            v->shade[c] = shade;
+        }
+
+        v->tex[0] = s;
+        v->tex[1] = 0;
+    }
+
+    return v;
+}
+
+/* rebuilds the vertex array for one row of the history, at z = 0 */
+static void build_row (int row)
+{
+    BarVertex * v = s_rows[row];
+
+    for (int j = 0; j < NUM_BANDS; j ++)
+    {
+        float h = s_bars[row][j] * 1.6f;
+        float x1 = 1.6f - BAR_SPACING * j, x2 = x1 + BAR_WIDTH;
+        float z1 = 0, z2 = BAR_WIDTH;
+        float bright = 0.2f + 0.8f * h;
+        float s = (j + 0.5f) / NUM_BANDS;
+
+        const float top[4][3] = {{x1, h, z1}, {x2, h, z1}, {x2, h, z2}, {x1, h, z2}};
+        const float left[4][3] = {{x1, 0, z1}, {x1, h, z1}, {x1, h, z2}, {x1, 0, z2}};
+        const float right[4][3] = {{x2, h, z1}, {x2, 0, z1}, {x2, 0, z2}, {x2, h, z2}};
+        const float front[4][3] = {{x1, 0, z1}, {x2, 0, z1}, {x2, h, z1}, {x1, h, z1}};
+
+        v = add_quad (v, top, bright, s);
+        v = add_quad (v, left, 0.65f * bright, s);
+        v = add_quad (v, right, 0.65f * bright, s);
+        v = add_quad (v, front, 0.8f * bright, s);
+    }
+}
+
 bool GLSpectrum::init ()
 {
-    for (int i = 0; i <= NUM_BANDS; i ++)
-        logscale[i] = powf (256, (float) i / NUM_BANDS) - 0.5f;
+    compute_log_xscale (logscale, NUM_BANDS);
 
     for (int y = 0; y < NUM_BANDS; y ++)
     {
@@ -119,50 +189,28 @@ bool GLSpectrum::init ()
         }
     }
 
+    for (int i = 0; i < NUM_BANDS; i ++)
+        build_row (i);
+
     return true;
 }
 
-/* stolen from the skins plugin */
-/* convert linear frequency graph to logarithmic one */
-static void make_log_graph (const float * freq, float * graph)
+void GLSpectrum::render_freq (const float * freq)
 {
-    for (int i = 0; i < NUM_BANDS; i ++)
-    {
-        /* sum up values in freq array between logscale[i] and logscale[i + 1],
-           including fractional parts */
-        int a = ceilf (logscale[i]);
-        int b = floorf (logscale[i + 1]);
-        float sum = 0;
-
-        if (b < a)
-            sum += freq[b] * (logscale[i + 1] - logscale[i]);
-        else
-        {
-            if (a > 0)
-                sum += freq[a - 1] * (a - logscale[i]);
-            for (; a < b; a ++)
-                sum += freq[a];
-            if (b < 256)
-                sum += freq[b] * (logscale[i + 1] - b);
-        }
-
-        /* fudge factor to make the graph have the same overall height as a
-           12-band one no matter how many bands there are */
-        sum *= (float) NUM_BANDS / 12;
+    if (! governor.accept_frame (widget_visible ()))
+        return;
 
-        /* convert to dB */
-        float val = 20 * log10f (sum);
+    VisGovernor::Cost cost (governor);
+    float * graph = s_bars[s_pos];
 
+    for (int i = 0; i < NUM_BANDS; i ++)
+    {
         /* scale (-DB_RANGE, 0.0) to (0.0, 1.0) */
-        val = 1 + val / DB_RANGE;
-
+        float val = 1 + compute_freq_band (freq, logscale, i, NUM_BANDS) / DB_RANGE;
         graph[i] = aud::clamp (val, 0.0f, 1.0f);
     }
-}
 
-void GLSpectrum::render_freq (const float * freq)
-{
-    make_log_graph (freq, s_bars[s_pos]);
+    build_row (s_pos);
     s_pos = (s_pos + 1) % NUM_BANDS;
 
     s_angle += s_anglespeed;
@@ -177,52 +225,23 @@ void GLSpectrum::clear ()
 {
     memset (s_bars, 0, sizeof s_bars);
 
+    for (int i = 0; i < NUM_BANDS; i ++)
+        build_row (i);
+
     if (s_widget)
         gtk_widget_queue_draw (s_widget);
 }
 
-static void draw_rectangle (float x1, float y1, float z1, float x2, float y2,
- float z2, float r, float g, float b)
-{
-    glColor3f (r, g, b);
-
-    glBegin (GL_POLYGON);
-    glVertex3f (x1, y2, z1);
-    glVertex3f (x2, y2, z1);
-    glVertex3f (x2, y2, z2);
-    glVertex3f (x1, y2, z2);
-    glEnd ();
-
-    glColor3f (0.65f * r, 0.65f * g, 0.65f * b);
-
-    glBegin (GL_POLYGON);
-    glVertex3f (x1, y1, z1);
-    glVertex3f (x1, y2, z1);
-    glVertex3f (x1, y2, z2);
-    glVertex3f (x1, y1, z2);
-    glEnd ();
-
-    glBegin (GL_POLYGON);
-    glVertex3f (x2, y2, z1);
-    glVertex3f (x2, y1, z1);
-    glVertex3f (x2, y1, z2);
-    glVertex3f (x2, y2, z2);
-    glEnd ();
-
-    glColor3f (0.8f * r, 0.8f * g, 0.8f * b);
-
-    glBegin (GL_POLYGON);
-    glVertex3f (x1, y1, z1);
-    glVertex3f (x2, y1, z1);
-    glVertex3f (x2, y2, z1);
-    glVertex3f (x1, y2, z1);
-    glEnd ();
-}
-
-static void draw_bar (float x, float z, float h, float r, float g, float b)
+static void create_texture ()
 {
-    draw_rectangle (x, 0, z, x + BAR_WIDTH, h, z + BAR_WIDTH,
-     r * (0.2f + 0.8f * h), g * (0.2f + 0.8f * h), b * (0.2f + 0.8f * h));
+    glGenTextures (1, & s_texture);
+    glBindTexture (GL_TEXTURE_2D, s_texture);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    /* texel (j, i) is the color of bar j in on-screen row i */
+    glTexImage2D (GL_TEXTURE_2D, 0, GL_RGB, NUM_BANDS, NUM_BANDS, 0, GL_RGB,
+     GL_FLOAT, colors);
 }
 
 static void draw_bars ()
@@ -232,18 +251,43 @@ static void draw_bars ()
     glRotatef (38.0f, 1.0f, 0.0f, 0.0f);
     glRotatef (s_angle + 180.0f, 0.0f, 1.0f, 0.0f);
 
+    glEnable (GL_TEXTURE_2D);
+    glBindTexture (GL_TEXTURE_2D, s_texture);
+    glTexEnvi (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    glEnableClientState (GL_VERTEX_ARRAY);
+    glEnableClientState (GL_COLOR_ARRAY);
+    glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+
     for (int i = 0; i < NUM_BANDS; i ++)
     {
-        float z = -1.6f + (NUM_BANDS - i) * BAR_SPACING;
+        const BarVertex * v = s_rows[(s_pos + i) % NUM_BANDS];
 
-        for (int j = 0; j < NUM_BANDS; j ++)
-        {
-            draw_bar (1.6f - BAR_SPACING * j, z,
-             s_bars[(s_pos + i) % NUM_BANDS][j] * 1.6,
-             colors[i][j][0], colors[i][j][1], colors[i][j][2]);
-        }
+        glPushMatrix ();
+        glTranslatef (0.0f, 0.0f, -1.6f + (NUM_BANDS - i) * BAR_SPACING);
+
+        glMatrixMode (GL_TEXTURE);
+        glLoadIdentity ();
+        glTranslatef (0.0f, (i + 0.5f) / NUM_BANDS, 0.0f);
+        glMatrixMode (GL_MODELVIEW);
+
+        glVertexPointer (3, GL_FLOAT, sizeof (BarVertex), v->pos);
+        glColorPointer (3, GL_FLOAT, sizeof (BarVertex), v->shade);
+        glTexCoordPointer (2, GL_FLOAT, sizeof (BarVertex), v->tex);
+        glDrawArrays (GL_QUADS, 0, NUM_BANDS * VERTS_PER_BAR);
+
+        glPopMatrix ();
     }
 
+    glMatrixMode (GL_TEXTURE);
+    glLoadIdentity ();
+    glMatrixMode (GL_MODELVIEW);
+
+    glDisableClientState (GL_VERTEX_ARRAY);
+    glDisableClientState (GL_COLOR_ARRAY);
+    glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+    glDisable (GL_TEXTURE_2D);
+
     glPopMatrix ();
 }
 
@@ -263,6 +307,8 @@ static gboolean draw_cb (GtkWidget * widget)
         return false;
 #endif
 
+    VisGovernor::Cost cost (governor);
+
     glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     draw_bars ();
@@ -275,6 +321,7 @@ static gboolean draw_cb (GtkWidget * widget)
     SwapBuffers (s_hdc);
 #endif
 
+    governor.frame_painted ();
     return true;
 }
 
@@ -375,11 +422,14 @@ static void widget_realized ()
     glDepthMask (GL_TRUE);
     glPolygonMode (GL_FRONT_AND_BACK, GL_FILL);
     glClearColor (0, 0, 0, 1);
+
+    create_texture ();
 }
 
 static void widget_destroyed ()
 {
     s_widget = nullptr;
+    s_texture = 0;  /* freed along with the context */
 
 #ifdef GDK_WINDOWING_X11
     if (s_context)
@@ -44,11 +44,24 @@ static Playlist highlighted;
 static int switch_handler = 0;
 static int reorder_handler = 0;
 
+/* Treeviews are created only when a page is first shown, and released again
+ * once more than this many hidden pages (not counting the current one) have
+ * one.  Selection and focus are
+ * kept by the core; the scroll position is saved with the page. */
+static constexpr int MAX_HIDDEN_PAGES = 8;
+
+static int visit_count = 0;
+static int64_t populate_time = 0;
+
+static GtkWidget * page_at_idx (int idx)
+    { return gtk_notebook_get_nth_page ((GtkNotebook *) pl_notebook, idx); }
+
+/* returns nullptr if the page has not been shown recently */
 static GtkWidget * treeview_of (GtkWidget * page)
     { return (GtkWidget *) g_object_get_data ((GObject *) page, "treeview"); }
 
 static GtkWidget * treeview_at_idx (int idx)
-    { return treeview_of (gtk_notebook_get_nth_page ((GtkNotebook *) pl_notebook, idx)); }
+    { return treeview_of (page_at_idx (idx)); }
 
 static Playlist list_of (GtkWidget * widget)
     { return aud::from_ptr<Playlist> (g_object_get_data ((GObject *) widget, "playlist")); }
@@ -95,8 +108,9 @@ static void size_allocate_cb (GtkWidget * treeview)
 
         for (int i = 0; i < count; i ++)
         {
-            if (i != current)
-                apply_column_widths (treeview_at_idx (i));
+            GtkWidget * other = treeview_at_idx (i);
+            if (i != current && other)
+                apply_column_widths (other);
         }
     }
 }
@@ -177,10 +191,117 @@ static GtkWidget * make_close_button (GtkWidget * ebox, Playlist list)
     return button;
 }
 
+static gboolean first_paint_cb (GtkWidget * treeview)
+{
+    g_signal_handlers_disconnect_by_func (treeview, (void *) first_paint_cb, nullptr);
+
+    AUDDBG ("%d playlists, first paint after %d ms\n", Playlist::n_playlists (),
+     (int) ((g_get_monotonic_time () - populate_time) / 1000));
+
+    return false;
+}
+
+static void release_treeview (GtkWidget * page)
+{
+    GtkWidget * treeview = treeview_of (page);
+    GtkAdjustment * vscroll = gtk_scrolled_window_get_vadjustment ((GtkScrolledWindow *) page);
+
+    GtkTreePath * top;
+    if (gtk_tree_view_get_visible_range ((GtkTreeView *) treeview, & top, nullptr))
+    {
+        int row = gtk_tree_path_get_indices (top)[0];
+        g_object_set_data ((GObject *) page, "top-row", aud::to_ptr (row + 1));
+        gtk_tree_path_free (top);
+    }
+
+    g_signal_handlers_disconnect_by_func (vscroll, (void *) ui_playlist_widget_scroll, treeview);
+    g_object_set_data ((GObject *) page, "treeview", nullptr);
+    gtk_widget_destroy (treeview);
+}
+
+static void release_hidden_treeviews ()
+{
+    int n_pages = gtk_notebook_get_n_pages ((GtkNotebook *) pl_notebook);
+    int current = gtk_notebook_get_current_page ((GtkNotebook *) pl_notebook);
+
+    while (1)
+    {
+        int hidden = 0, oldest_visit = 0;
+        GtkWidget * oldest = nullptr;
+
+        for (int i = 0; i < n_pages; i ++)
+        {
+            GtkWidget * page = page_at_idx (i);
+            if (i == current || ! treeview_of (page))
+                continue;
+
+            hidden ++;
+
+            int visit = aud::from_ptr<int> (g_object_get_data ((GObject *) page, "visited"));
+            if (! oldest || visit < oldest_visit)
+            {
+                oldest = page;
+                oldest_visit = visit;
+            }
+        }
+
+        if (hidden <= MAX_HIDDEN_PAGES || ! oldest)
+            break;
+
+        release_treeview (oldest);
+    }
+}
+
+static GtkWidget * ensure_treeview (GtkWidget * page)
+{
+    g_object_set_data ((GObject *) page, "visited", aud::to_ptr (++ visit_count));
+
+    GtkWidget * treeview = treeview_of (page);
+    if (treeview)
+        return treeview;
+
+    auto list = list_of (page);
+    treeview = ui_playlist_widget_new (list);
+
+    apply_column_widths (treeview);
+    g_signal_connect (treeview, "size-allocate", (GCallback) size_allocate_cb, nullptr);
+
+    g_object_set_data ((GObject *) page, "treeview", treeview);
+    g_object_set_data ((GObject *) treeview, "playlist", aud::to_ptr (list));
+
+    gtk_container_add ((GtkContainer *) page, treeview);
+    gtk_widget_show (treeview);
+
+    int position = list.get_position ();
+    if (position >= 0)
+        audgui_list_set_highlight (treeview, position);
+
+    int focus = list.get_focus ();
+    if (focus >= 0)
+        audgui_list_set_focus (treeview, focus);
+
+    /* restore the scroll position from when the page was last shown */
+    int top_row = aud::from_ptr<int> (g_object_get_data ((GObject *) page, "top-row")) - 1;
+    if (top_row >= 0 && top_row < list.n_entries ())
+    {
+        GtkTreePath * path = gtk_tree_path_new_from_indices (top_row, -1);
+        gtk_tree_view_scroll_to_cell ((GtkTreeView *) treeview, path, nullptr, true, 0, 0);
+        gtk_tree_path_free (path);
+    }
+
+    GtkAdjustment * vscroll = gtk_scrolled_window_get_vadjustment ((GtkScrolledWindow *) page);
+    g_signal_connect_swapped (vscroll, "value-changed",
+     (GCallback) ui_playlist_widget_scroll, treeview);
+
+    release_hidden_treeviews ();
+
+    return treeview;
+}
+
 void pl_notebook_grab_focus ()
 {
     int idx = gtk_notebook_get_current_page ((GtkNotebook *) pl_notebook);
-    gtk_widget_grab_focus (treeview_at_idx (idx));
+    gtk_widget_grab_focus (ensure_treeview (page_at_idx (idx)));
 }
 
 static void tab_title_reset (GtkWidget * ebox)
@@ -249,18 +370,19 @@ static gboolean scroll_ignore_cb ()
 
 static void tab_changed (GtkNotebook * notebook, GtkWidget * page, unsigned page_num)
 {
+    ensure_treeview (page);
     Playlist::by_index (page_num).activate ();
 }
 
 static void tab_reordered (GtkNotebook * notebook, GtkWidget * page, unsigned page_num)
 {
-    auto list = list_of (treeview_of (page));
+    auto list = list_of (page);
     Playlist::reorder_playlists (list.index (), page_num, 1);
 }
 
 static GtkLabel * get_tab_label (int list_idx)
 {
-    GtkWidget * page = gtk_notebook_get_nth_page ((GtkNotebook *) pl_notebook, list_idx);
+    GtkWidget * page = page_at_idx (list_idx);
     GtkWidget * ebox = gtk_notebook_get_tab_label ((GtkNotebook *) pl_notebook, page);
     return (GtkLabel *) g_object_get_data ((GObject *) ebox, "label");
 }
@@ -303,25 +425,19 @@ void start_rename_playlist (Playlist playlist)
     gtk_widget_show (entry);
 }
 
+/* the treeview is added by ensure_treeview() when the page is shown */
 static void create_tab (int list_idx, Playlist list)
 {
     GtkWidget * scrollwin = gtk_scrolled_window_new (nullptr, nullptr);
-    GtkAdjustment * vscroll = gtk_scrolled_window_get_vadjustment ((GtkScrolledWindow *) scrollwin);
 
     /* do not allow scroll events to propagate up to the notebook */
     g_signal_connect_after (scrollwin, "scroll-event", (GCallback) scroll_ignore_cb, nullptr);
 
-    GtkWidget * treeview = ui_playlist_widget_new (list);
+    g_object_set_data ((GObject *) scrollwin, "playlist", aud::to_ptr (list));
 
-    apply_column_widths (treeview);
-    g_signal_connect (treeview, "size-allocate", (GCallback) size_allocate_cb, nullptr);
-
-    g_object_set_data ((GObject *) scrollwin, "treeview", treeview);
-
-    gtk_container_add ((GtkContainer *) scrollwin, treeview);
     gtk_scrolled_window_set_policy ((GtkScrolledWindow *) scrollwin,
      GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
-    gtk_widget_show_all (scrollwin);
+    gtk_widget_show (scrollwin);
 
     GtkWidget * ebox = gtk_event_box_new ();
     gtk_event_box_set_visible_window ((GtkEventBox *) ebox, false);
@@ -354,21 +470,10 @@ static void create_tab (int list_idx, Playlist list)
     gtk_notebook_set_tab_reorderable ((GtkNotebook *) pl_notebook, scrollwin, true);
 
     g_object_set_data ((GObject *) ebox, "playlist", aud::to_ptr (list));
-    g_object_set_data ((GObject *) treeview, "playlist", aud::to_ptr (list));
-
-    int position = list.get_position ();
-    if (position >= 0)
-        audgui_list_set_highlight (treeview, position);
-
-    int focus = list.get_focus ();
-    if (focus >= 0)
-        audgui_list_set_focus (treeview, position);
 
     g_signal_connect (ebox, "button-press-event", (GCallback) tab_button_press_cb, nullptr);
     g_signal_connect (ebox, "key-press-event", (GCallback) tab_key_press_cb, nullptr);
     g_signal_connect (entry, "activate", (GCallback) tab_title_save, ebox);
-    g_signal_connect_swapped (vscroll, "value-changed",
-     (GCallback) ui_playlist_widget_scroll, treeview);
 
     /* we have to connect to "scroll-event" on the notebook, the tabs, AND the
      * close buttons (sigh) */
@@ -385,11 +490,16 @@ static void create_tab (int list_idx, Playlist list)
 static void switch_to_active ()
 {
     int active_idx = Playlist::active_playlist ().index ();
+
+    /* "switch-page" may be blocked, so create the treeview here */
+    ensure_treeview (page_at_idx (active_idx));
     gtk_notebook_set_current_page ((GtkNotebook *) pl_notebook, active_idx);
 }
 
 void pl_notebook_populate ()
 {
+    populate_time = g_get_monotonic_time ();
+
     int n_playlists = Playlist::n_playlists ();
     for (int idx = 0; idx < n_playlists; idx ++)
         create_tab (idx, Playlist::by_index (idx));
@@ -397,6 +507,15 @@ void pl_notebook_populate ()
     switch_to_active ();
     highlighted = Playlist::playing_playlist ();
 
+    /* report the cost of startup (or of rebuilding the notebook) */
+#ifdef USE_GTK3
+    g_signal_connect (treeview_at_idx (Playlist::active_playlist ().index ()),
+     "draw", (GCallback) first_paint_cb, nullptr);
+#else
+    g_signal_connect (treeview_at_idx (Playlist::active_playlist ().index ()),
+     "expose-event", (GCallback) first_paint_cb, nullptr);
+#endif
+
     if (! switch_handler)
         switch_handler = g_signal_connect (pl_notebook, "switch-page",
          (GCallback) tab_changed, nullptr);
@@ -432,7 +551,7 @@ static void add_remove_pages ()
     /* scan through existing treeviews */
     for (int i = 0; i < pages; )
     {
-        auto list0 = list_of (treeview_at_idx (i));
+        auto list0 = list_of (page_at_idx (i));
 
         /* do we have an orphaned treeview? */
         if (! list0.exists ())
@@ -456,8 +575,8 @@ static void add_remove_pages ()
 
         for (int j = i + 1; j < pages; j ++)
         {
-            GtkWidget * page = gtk_notebook_get_nth_page ((GtkNotebook *) pl_notebook, j);
-            auto list2 = list_of (treeview_of (page));
+            GtkWidget * page = page_at_idx (j);
+            auto list2 = list_of (page);
 
             /* found it? move it to the right place */
             if (list2 == list)
@@ -501,12 +620,15 @@ void pl_notebook_update (void * data, void * user)
 
     for (int i = 0; i < n_pages; i ++)
     {
-        GtkWidget * treeview = treeview_at_idx (i);
+        GtkWidget * page = page_at_idx (i);
 
         if (global_level >= Playlist::Metadata)
-            update_tab_label (get_tab_label (i), list_of (treeview));
+            update_tab_label (get_tab_label (i), list_of (page));
 
-        ui_playlist_widget_update (treeview);
+        /* pages without a treeview are brought up to date when shown */
+        GtkWidget * treeview = treeview_of (page);
+        if (treeview)
+            ui_playlist_widget_update (treeview);
     }
 
     switch_to_active ();
@@ -524,7 +646,9 @@ void pl_notebook_set_position (void * data, void * user)
         list.set_focus (row);
     }
 
-    audgui_list_set_highlight (treeview_at_idx (list.index ()), row);
+    GtkWidget * treeview = treeview_at_idx (list.index ());
+    if (treeview)
+        audgui_list_set_highlight (treeview, row);
 }
 
 void pl_notebook_activate (void * data, void * user)
@@ -547,7 +671,7 @@ void pl_notebook_set_playing (void * data, void * user)
 
     for (int i = 0; i < pages; i ++)
     {
-        auto list = list_of (treeview_at_idx (i));
+        auto list = list_of (page_at_idx (i));
         if (list == highlighted || list == playing)
             update_tab_label (get_tab_label (i), list);
     }
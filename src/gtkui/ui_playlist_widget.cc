@@ -17,6 +17,7 @@
  * the use of this software.
  */
 
+#include <limits.h>
 #include <string.h>
 
 #include <gtk/gtk.h>
@@ -115,28 +116,35 @@ static const Playlist::SortType pw_col_sort_types[PW_COLS] = {
     Playlist::CatalogNum       // catalog number
 };
 
+/* cached rows are direct-mapped by row number and filled in aligned batches,
+ * since GtkTreeView asks for neighbouring rows one after another */
+static constexpr int ROW_CACHE_SIZE = 512;
+static constexpr int ROW_CACHE_BATCH = 32;
+
+struct CachedRow
+{
+    int row = -1;
+    String values[PW_COLS];
+};
+
 struct PlaylistWidgetData
 {
     Playlist list;
     int popup_pos = -1;
     QueuedFunc popup_timer;
+    Index<CachedRow> cache;
 
     void show_popup ()
         { audgui_infopopup_show (list, popup_pos); }
+
+    const CachedRow & cached_row (int row);
+    void invalidate_rows (int from, int to);
 };
 
-static void set_int_from_tuple (GValue * value, const Tuple & tuple, Tuple::Field field)
+static String int_from_tuple (const Tuple & tuple, Tuple::Field field)
 {
     int i = tuple.get_int (field);
-    if (i > 0)
-        g_value_take_string (value, g_strdup_printf ("%d", i));
-    else
-        g_value_set_string (value, "");
-}
-
-static void set_string_from_tuple (GValue * value, const Tuple & tuple, Tuple::Field field)
-{
-    g_value_set_string (value, tuple.get_str (field));
+    return String ((i > 0) ? (const char *) int_to_str (i) : "");
 }
 
 static void set_queued (GValue * value, Playlist list, int row)
@@ -148,13 +156,64 @@ static void set_queued (GValue * value, Playlist list, int row)
         g_value_take_string (value, g_strdup_printf ("#%d", 1 + q));
 }
 
-static void set_length (GValue * value, const Tuple & tuple)
+static String length_from_tuple (const Tuple & tuple)
 {
     int len = tuple.get_int (Tuple::Length);
-    if (len >= 0)
-        g_value_set_string (value, str_format_time (len));
-    else
-        g_value_set_string (value, "");
+    return String ((len >= 0) ? (const char *) str_format_time (len) : "");
+}
+
+static void fill_row (CachedRow & cached, int row, const Tuple & tuple)
+{
+    String * values = cached.values;
+
+    cached.row = row;
+    values[PW_COL_TITLE] = tuple.get_str (Tuple::Title);
+    values[PW_COL_ARTIST] = tuple.get_str (Tuple::Artist);
+    values[PW_COL_YEAR] = int_from_tuple (tuple, Tuple::Year);
+    values[PW_COL_ALBUM] = tuple.get_str (Tuple::Album);
+    values[PW_COL_ALBUM_ARTIST] = tuple.get_str (Tuple::AlbumArtist);
+    values[PW_COL_TRACK] = int_from_tuple (tuple, Tuple::Track);
+    values[PW_COL_GENRE] = tuple.get_str (Tuple::Genre);
+    values[PW_COL_LENGTH] = length_from_tuple (tuple);
+    values[PW_COL_FILENAME] = tuple.get_str (Tuple::Basename);
+    values[PW_COL_PATH] = tuple.get_str (Tuple::Path);
+    values[PW_COL_CUSTOM] = tuple.get_str (Tuple::FormattedTitle);
+    values[PW_COL_BITRATE] = int_from_tuple (tuple, Tuple::Bitrate);
+    values[PW_COL_COMMENT] = tuple.get_str (Tuple::Comment);
+    values[PW_COL_PUBLISHER] = tuple.get_str (Tuple::Publisher);
+    values[PW_COL_CATALOG_NUM] = tuple.get_str (Tuple::CatalogNum);
+}
+
+const CachedRow & PlaylistWidgetData::cached_row (int row)
+{
+    if (! cache.len ())
+        cache.insert (0, ROW_CACHE_SIZE);
+
+    CachedRow & cached = cache[row % ROW_CACHE_SIZE];
+    if (cached.row == row)
+        return cached;
+
+    int first = row - row % ROW_CACHE_BATCH;
+    int last = aud::min (first + ROW_CACHE_BATCH, list.n_entries ());
+
+    for (int r = first; r < last; r ++)
+    {
+        CachedRow & batch = cache[r % ROW_CACHE_SIZE];
+        if (batch.row != r)
+            fill_row (batch, r, list.entry_tuple (r, Playlist::NoWait));
+    }
+
+    return cached;
+}
+
+/* drops cached rows from <from> up to (not including) <to> */
+void PlaylistWidgetData::invalidate_rows (int from, int to)
+{
+    for (CachedRow & cached : cache)
+    {
+        if (cached.row >= from && cached.row < to)
+            cached.row = -1;
+    }
 }
 
 static void get_value (void * user, int row, int column, GValue * value)
@@ -165,63 +224,16 @@ static void get_value (void * user, int row, int column, GValue * value)
 
     column = pw_cols[column];
 
-    Tuple tuple;
-
-    if (column != PW_COL_NUMBER && column != PW_COL_QUEUED)
-        tuple = data->list.entry_tuple (row, Playlist::NoWait);
-
     switch (column)
     {
     case PW_COL_NUMBER:
         g_value_set_int (value, 1 + row);
         break;
-    case PW_COL_TITLE:
-        set_string_from_tuple (value, tuple, Tuple::Title);
-        break;
-    case PW_COL_ARTIST:
-        set_string_from_tuple (value, tuple, Tuple::Artist);
-        break;
-    case PW_COL_YEAR:
-        set_int_from_tuple (value, tuple, Tuple::Year);
-        break;
-    case PW_COL_ALBUM:
-        set_string_from_tuple (value, tuple, Tuple::Album);
-        break;
-    case PW_COL_ALBUM_ARTIST:
-        set_string_from_tuple (value, tuple, Tuple::AlbumArtist);
-        break;
-    case PW_COL_TRACK:
-        set_int_from_tuple (value, tuple, Tuple::Track);
-        break;
-    case PW_COL_GENRE:
-        set_string_from_tuple (value, tuple, Tuple::Genre);
-        break;
     case PW_COL_QUEUED:
         set_queued (value, data->list, row);
         break;
-    case PW_COL_LENGTH:
-        set_length (value, tuple);
-        break;
-    case PW_COL_FILENAME:
-        set_string_from_tuple (value, tuple, Tuple::Basename);
-        break;
-    case PW_COL_PATH:
-        set_string_from_tuple (value, tuple, Tuple::Path);
-        break;
-    case PW_COL_CUSTOM:
-        set_string_from_tuple (value, tuple, Tuple::FormattedTitle);
-        break;
-    case PW_COL_BITRATE:
-        set_int_from_tuple (value, tuple, Tuple::Bitrate);
-        break;
-    case PW_COL_COMMENT:
-        set_string_from_tuple (value, tuple, Tuple::Comment);
-        break;
-    case PW_COL_PUBLISHER:
-        set_string_from_tuple (value, tuple, Tuple::Publisher);
-        break;
-    case PW_COL_CATALOG_NUM:
-        set_string_from_tuple (value, tuple, Tuple::CatalogNum);
+    default:
+        g_value_set_string (value, data->cached_row (row).values[column]);
         break;
     }
 }
@@ -410,12 +422,19 @@ GtkWidget * ui_playlist_widget_new (Playlist playlist)
      * box can still be brought up with CTRL-F. */
     gtk_tree_view_set_enable_search ((GtkTreeView *) list, false);
 
+    bool fixed_height = aud_get_bool ("gtkui", "playlist_fixed_height");
+
     for (int i = 0; i < pw_num_cols; i ++)
     {
         int n = pw_cols[i];
         audgui_list_add_column (list, pw_col_label[n] ? _(pw_col_names[n]) :
          nullptr, i, pw_col_types[n], pw_col_min_widths[n]);
 
+        /* fixed-height mode requires every column to have fixed sizing */
+        if (fixed_height)
+            gtk_tree_view_column_set_sizing (gtk_tree_view_get_column
+             ((GtkTreeView *) list, i), GTK_TREE_VIEW_COLUMN_FIXED);
+
         if (pw_col_sort_types[n] < Playlist::n_sort_types)
         {
             auto column = gtk_tree_view_get_column ((GtkTreeView *) list, i);
@@ -427,6 +446,10 @@ GtkWidget * ui_playlist_widget_new (Playlist playlist)
         }
     }
 
+    /* all rows have the same height, so GtkTreeView need not measure each one */
+    if (fixed_height)
+        gtk_tree_view_set_fixed_height_mode ((GtkTreeView *) list, true);
+
     return list;
 }
 
@@ -443,6 +466,12 @@ void ui_playlist_widget_update (GtkWidget * widget)
     int entries = data->list.n_entries ();
     int changed = entries - update.before - update.after;
 
+    /* structural changes may shift all following rows */
+    if (update.level == Playlist::Structure)
+        data->invalidate_rows (update.before, INT_MAX);
+    else if (update.level == Playlist::Metadata)
+        data->invalidate_rows (update.before, entries - update.after);
+
     if (update.level == Playlist::Structure)
     {
         int old_entries = audgui_list_row_count (widget);
@@ -12,6 +12,16 @@ using namespace std;
 
 arch_Raw::arch_Raw(const string& aFileName)
 {
+    // local files are used in place
+    if (mMapped.open(aFileName.c_str()) && mMapped.size() <= UINT32_MAX)
+    {
+        mSize = mMapped.size();
+        mMap = const_cast<void*>(mMapped.data());
+        return;
+    }
+
+    mMapped.close();
+
     mFileDesc = VFSFile(aFileName.c_str(), "r");
     if (!mFileDesc)
     {
@@ -37,7 +47,7 @@ arch_Raw::arch_Raw(const string& aFileName)
 
 arch_Raw::~arch_Raw()
 {
-    if(mSize != 0)
+    if(mSize != 0 && !mMapped.mapped())
     {
         free(mMap);
     }
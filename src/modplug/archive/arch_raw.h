@@ -11,9 +11,12 @@
 
 #include <libaudcore/vfs.h>
 
+#include "../../decoder-common/mapped-file.h"
+
 class arch_Raw: public Archive
 {
     VFSFile mFileDesc;
+    MappedFile mMapped;
 
 public:
     arch_Raw(const std::string& aFileName);
@@ -16,11 +16,33 @@
 
 #include <libaudcore/audstrings.h>
 #include <libaudcore/i18n.h>
+#include <libaudcore/runtime.h>
 
 #include "archive/open.h"
+#include "../decoder-common/preloader.h"
 
 using namespace std;
 
+// Module preloading ==========================================
+
+// The archive of the module following the current one is read on a worker
+// thread while the current one plays (see preloader.h).  Parsing it with
+// CSoundFile::Create() is left to play(), since it depends on the global
+// settings applied there.
+static Archive * preload_archive (const char * filename)
+{
+    Archive * archive = OpenArchive (filename);
+    if (archive->Size () == 0)
+    {
+        delete archive;
+        return nullptr;
+    }
+
+    return archive;
+}
+
+static Preloader<Archive> preloader (preload_archive);
+
 // ModplugXMMS member functions ===============================
 
 bool ModplugXMMS::init ()
@@ -30,6 +52,11 @@ bool ModplugXMMS::init ()
     return true;
 }
 
+void ModplugXMMS::cleanup ()
+{
+    preloader.shutdown ();
+}
+
 bool ModplugXMMS::is_our_file (const char * filename, VFSFile & file)
 {
     string lExt;
@@ -183,12 +210,18 @@ void ModplugXMMS::PlayLoop()
 
 bool ModplugXMMS::play (const char * filename, VFSFile & file)
 {
-    //open and mmap the file
-    mArchive = OpenArchive(filename);
-    if(mArchive->Size() == 0)
+    mArchive = preloader.take (filename).release ();
+
+    if (! mArchive)
     {
-        delete mArchive;
-        return false;
+        //open and mmap the file
+        mArchive = OpenArchive(filename);
+        if(mArchive->Size() == 0)
+        {
+            delete mArchive;
+            mArchive = nullptr;
+            return false;
+        }
     }
 
     mSoundFile = new CSoundFile;
@@ -258,6 +291,9 @@ bool ModplugXMMS::play (const char * filename, VFSFile & file)
         mArchive->Size()
     );
 
+    // start loading the next module while this one plays
+    preloader.start (filename, exts);
+
     set_stream_bitrate(mSoundFile->GetNumChannels() * 1000);
 
     open_audio(FMT_S16_NE, mModProps.mFrequency, mModProps.mChannels);
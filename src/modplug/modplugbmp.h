@@ -65,6 +65,7 @@ public:
         .with_exts (exts)) {}
 
     bool init ();
+    void cleanup ();
 
     bool is_our_file (const char * filename, VFSFile & file);
     bool read_tag (const char * filename, VFSFile & file, Tuple & tuple, Index<char> * image);
@@ -24,15 +24,32 @@
  * SUCH DAMAGE.
  */
 
+#include <libaudcore/audstrings.h>
 #include <libaudcore/i18n.h>
 #include <libaudcore/plugin.h>
 #include <libaudcore/preferences.h>
 #include <libaudcore/runtime.h>
 
 #include "mptwrap.h"
+#include "../decoder-common/preloader.h"
 
 static bool force_apply = false;
 
+// The module following the current one is loaded on a worker thread while
+// the current one plays (see preloader.h).
+static MPTWrap *preload_module(const char *filename)
+{
+    VFSFile file(filename, "r");
+    SmartPtr<MPTWrap> mpt(new MPTWrap);
+
+    if (!file || !mpt->open(file, false))
+        return nullptr;
+
+    return mpt.release();
+}
+
+static Preloader<MPTWrap> preloader(preload_module);
+
 static constexpr const char *CFG_SECTION               = "openmpt";
 static constexpr const char *SETTING_STEREO_SEPARATION = "stereo_separation";
 static constexpr const char *SETTING_INTERPOLATOR      = "interpolator";
@@ -72,10 +89,15 @@ public:
         return true;
     }
 
+    void cleanup()
+    {
+        preloader.shutdown();
+    }
+
     bool is_our_file(const char *filename, VFSFile &file)
     {
         MPTWrap mpt;
-        return mpt.open(file);
+        return mpt.open(file, false);
     }
 
     bool read_tag(const char *filename, VFSFile &file, Tuple &tuple, Index<char> *)
@@ -95,13 +117,20 @@ public:
 
     bool play(const char *filename, VFSFile &file)
     {
-        MPTWrap mpt;
-        if (!mpt.open(file))
-            return false;
+        SmartPtr<MPTWrap> mpt = preloader.take(filename);
+
+        if (!mpt)
+        {
+            mpt.capture(new MPTWrap);
+            if (!mpt->open(file, false))
+                return false;
+        }
+
+        preloader.start(filename, exts);
 
         force_apply = true;
 
-        open_audio(FMT_FLOAT, mpt.rate(), mpt.channels());
+        open_audio(FMT_FLOAT, mpt->rate(), mpt->channels());
 
         while (!check_stop())
         {
@@ -109,16 +138,16 @@ public:
             int seek_value = check_seek();
 
             if (seek_value >= 0)
-                mpt.seek(seek_value);
+                mpt->seek(seek_value);
 
             if (force_apply)
             {
-                mpt.set_interpolator(aud_get_int(CFG_SECTION, SETTING_INTERPOLATOR));
-                mpt.set_stereo_separation(aud_get_int(CFG_SECTION, SETTING_STEREO_SEPARATION));
+                mpt->set_interpolator(aud_get_int(CFG_SECTION, SETTING_INTERPOLATOR));
+                mpt->set_stereo_separation(aud_get_int(CFG_SECTION, SETTING_STEREO_SEPARATION));
                 force_apply = false;
             }
 
-            auto n = mpt.read(buffer, aud::n_elems(buffer));
+            auto n = mpt->read(buffer, aud::n_elems(buffer));
             if (n == 0)
                 break;
 
@@ -41,15 +41,30 @@ static String to_aud_str(const char * str)
     return aud_str;
 }
 
-bool MPTWrap::open(VFSFile &file)
+bool MPTWrap::open(VFSFile &file, bool read_info)
 {
+    openmpt_module *m;
+
+    if (m_map.open(file.filename()))
+    {
 #if OPENMPT_API_VERSION_MAJOR <= 0 && OPENMPT_API_VERSION_MINOR < 3
-    auto m = openmpt_module_create(callbacks, &file, openmpt_log_func_silent,
-     nullptr, nullptr);
+        m = openmpt_module_create_from_memory(m_map.data(), m_map.size(),
+         openmpt_log_func_silent, nullptr, nullptr);
 #else
-    auto m = openmpt_module_create2(callbacks, &file, openmpt_log_func_silent,
-     nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+        m = openmpt_module_create_from_memory2(m_map.data(), m_map.size(),
+         openmpt_log_func_silent, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
 #endif
+    }
+    else
+    {
+#if OPENMPT_API_VERSION_MAJOR <= 0 && OPENMPT_API_VERSION_MINOR < 3
+        m = openmpt_module_create(callbacks, &file, openmpt_log_func_silent,
+         nullptr, nullptr);
+#else
+        m = openmpt_module_create2(callbacks, &file, openmpt_log_func_silent,
+         nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+#endif
+    }
 
     if (m == nullptr)
         return false;
@@ -58,6 +73,11 @@ bool MPTWrap::open(VFSFile &file)
 
     openmpt_module_select_subsong(mod.get(), -1);
 
+    // Calculating the duration means rendering through the whole song
+    // without output, which playback does not need.
+    if (!read_info)
+        return true;
+
     m_duration = openmpt_module_get_duration_seconds(mod.get()) * 1000;
     m_title = to_aud_str(openmpt_module_get_metadata(mod.get(), "title"));
     m_format = to_aud_str(openmpt_module_get_metadata(mod.get(), "type_long"));
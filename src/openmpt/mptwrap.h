@@ -34,6 +34,8 @@
 #include <libopenmpt/libopenmpt.h>
 #include <libopenmpt/libopenmpt_stream_callbacks_file.h>
 
+#include "../decoder-common/mapped-file.h"
+
 class MPTWrap
 {
 public:
@@ -59,7 +61,7 @@ public:
     static bool is_valid_stereo_separation(int);
     void set_stereo_separation(int);
 
-    bool open(VFSFile &);
+    bool open(VFSFile &, bool read_info = true);
     int64_t read(float *, int64_t);
     void seek(int pos);
 
@@ -78,6 +80,9 @@ private:
 
     static constexpr openmpt_stream_callbacks callbacks = { stream_read, stream_seek, stream_tell };
 
+    // local files are loaded straight from a mapping, which has to outlive
+    // the module
+    MappedFile m_map;
     SmartPtr<openmpt_module, openmpt_module_destroy> mod;
 
     int m_duration = 0;
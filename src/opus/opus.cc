@@ -17,6 +17,7 @@
  * the use of this software.
  */
 
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 
@@ -51,12 +52,9 @@ public:
     bool play(const char * filename, VFSFile & file);
 
 private:
-    static const int pcm_frames = 1024;
-    static const int pcm_bufsize = 2 * pcm_frames;
+    /* op_read_float() returns at most one packet, which is up to 120 ms */
+    static const int pcm_frames = 5760;
     static const int sample_rate = 48000; /* Opus supports 48 kHz only */
-
-    int m_bitrate = 0;
-    int m_channels = 0;
 };
 
 EXPORT OpusPlugin aud_plugin_instance;
@@ -248,9 +246,9 @@ bool OpusPlugin::read_tag(const char * filename, VFSFile & file, Tuple & tuple,
         return false;
     }
 
-    m_channels = op_channel_count(opus_file, -1);
-    m_bitrate = op_bitrate(opus_file, -1);
-    tuple.set_format("Opus", m_channels, sample_rate, m_bitrate / 1000);
+    int channels = op_channel_count(opus_file, -1);
+    int bitrate = op_bitrate(opus_file, -1);
+    tuple.set_format("Opus", channels, sample_rate, bitrate / 1000);
 
     int total_time = op_pcm_total(opus_file, -1);
     if (total_time > 0)
@@ -275,15 +273,22 @@ bool OpusPlugin::play(const char * filename, VFSFile & file)
         return false;
     }
 
+    int channels = op_channel_count(opus_file, -1);
+    int bitrate = op_bitrate(opus_file, -1);
+
+    /* sized for one packet; grows only if a later link has more channels */
     Index<float> pcm_out;
-    pcm_out.resize(pcm_bufsize * sizeof(float));
+    pcm_out.resize(pcm_frames * channels);
 
     bool error = false;
     int last_section = -1;
     Tuple tuple = get_playback_tuple();
     ReplayGainInfo rg_info;
 
-    set_stream_bitrate(m_bitrate);
+    auto decode_time = std::chrono::steady_clock::duration::zero();
+    int64_t decoded = 0;
+
+    set_stream_bitrate(bitrate);
 
     if (update_tuple(opus_file, tuple))
         set_playback_tuple(tuple.ref());
@@ -291,7 +296,7 @@ bool OpusPlugin::play(const char * filename, VFSFile & file)
     if (update_replay_gain(opus_file, &rg_info))
         set_replay_gain(rg_info);
 
-    open_audio(FMT_FLOAT, sample_rate, m_channels);
+    open_audio(FMT_FLOAT, sample_rate, channels);
 
     while (!check_stop())
     {
@@ -306,43 +311,56 @@ bool OpusPlugin::play(const char * filename, VFSFile & file)
         }
 
         int current_section = last_section;
-        int bytes = op_read_float(opus_file, pcm_out.begin(), pcm_frames,
-                                  &current_section);
-        if (bytes == OP_HOLE)
+        auto start = std::chrono::steady_clock::now();
+        int samples = op_read_float(opus_file, pcm_out.begin(), pcm_out.len(),
+                                    &current_section);
+        decode_time += std::chrono::steady_clock::now() - start;
+
+        if (samples == OP_HOLE)
             continue;
 
-        if (bytes <= 0)
+        if (samples <= 0)
             break;
 
+        decoded += samples;
+
         if (update_tuple(opus_file, tuple))
             set_playback_tuple(tuple.ref());
 
         if (current_section != last_section)
         {
-            int channels = op_channel_count(opus_file, -1);
+            /* a new link of a chained stream; the output is reopened only
+             * if the channel count has changed */
+            if (update_replay_gain(opus_file, &rg_info))
+                set_replay_gain(rg_info);
 
-            if (channels != m_channels)
-            {
-                m_channels = channels;
+            int link_channels = op_channel_count(opus_file, current_section);
 
-                if (update_replay_gain(opus_file, &rg_info))
-                    set_replay_gain(rg_info);
+            if (link_channels != channels)
+            {
+                channels = link_channels;
+                open_audio(FMT_FLOAT, sample_rate, channels);
 
-                open_audio(FMT_FLOAT, sample_rate, m_channels);
+                if (pcm_out.len() < pcm_frames * channels)
+                    pcm_out.resize(pcm_frames * channels);
             }
         }
 
-        write_audio(pcm_out.begin(), bytes * m_channels * sizeof(float));
+        write_audio(pcm_out.begin(), samples * channels * sizeof(float));
 
         if (current_section != last_section)
         {
-            m_bitrate = op_bitrate(opus_file, -1);
-            set_stream_bitrate(m_bitrate);
+            int link_bitrate = op_bitrate(opus_file, current_section);
+            if (link_bitrate > 0)
+                set_stream_bitrate(link_bitrate);
 
             last_section = current_section;
         }
     }
 
+    AUDDBG("Decoded %.1f s of audio in %.1f ms.\n", (double)decoded / sample_rate,
+           std::chrono::duration<double, std::milli>(decode_time).count());
+
     op_free(opus_file);
     return !error;
 }
@@ -30,6 +30,8 @@
 #include <libaudcore/plugin.h>
 #include <libaudqt/libaudqt.h>
 
+#include "../ui-common/vis-governor.h"
+
 #define MAX_BANDS   (256)
 #define VIS_DELAY 2 /* delay before falloff in frames */
 #define VIS_FALLOFF 2 /* falloff in pixels per frame */
@@ -55,6 +57,14 @@ private:
 };
 
 static SpectrumWidget * spect_widget = nullptr;
+static VisGovernor governor ("Spectrum Analyzer");
+
+/* false while the widget or its window is hidden or minimized */
+static bool spect_visible ()
+{
+    return spect_widget && spect_widget->isVisible () &&
+     ! spect_widget->window ()->isMinimized () && ! spect_widget->visibleRegion ().isEmpty ();
+}
 
 SpectrumWidget::SpectrumWidget (QWidget * parent) :
     QWidget (parent)
@@ -94,10 +104,13 @@ void SpectrumWidget::resizeEvent (QResizeEvent * event)
 
 void SpectrumWidget::paintEvent (QPaintEvent * event)
 {
+    VisGovernor::Cost cost (governor);
     QPainter p (this);
 
     paint_background (p);
     paint_spectrum (p);
+
+    governor.frame_painted ();
 }
 
 class QtSpectrum : public VisPlugin
@@ -123,9 +136,11 @@ EXPORT QtSpectrum aud_plugin_instance;
 
 void QtSpectrum::render_freq (const float * freq)
 {
-    if (! bands)
+    if (! bands || ! governor.accept_frame (spect_visible ()))
         return;
 
+    VisGovernor::Cost cost (governor);
+
     for (int i = 0; i < bands; i ++)
     {
         /* 40 dB range */
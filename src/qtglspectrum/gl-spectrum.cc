@@ -31,6 +31,8 @@
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions_2_0>
 
+#include "../ui-common/vis-governor.h"
+
 #define NUM_BANDS 32
 #define DB_RANGE 40
 
@@ -76,6 +78,63 @@ static int s_pos = 0;
 static float s_angle = 25, s_anglespeed = 0.05f;
 static float s_bars[NUM_BANDS][NUM_BANDS];
 
+/* Each row of the history keeps its bars as a persistent vertex array, so
+ * only the newest row is rebuilt per frame.  The vertex colors hold just the
+ * brightness; the color gradient comes from a small texture indexed by the
+ * row's on-screen position, which changes as the history scrolls. */
+struct BarVertex {
+    float pos[3];
+    float shade[3];
+    float tex[2];
+};
+
+static constexpr int VERTS_PER_BAR = 16;
+
+static BarVertex s_rows[NUM_BANDS][NUM_BANDS * VERTS_PER_BAR];
+
+static BarVertex * add_quad (BarVertex * v, const float (* corners)[3],
+ float shade, float s)
+{
+    for (int n = 0; n < 4; n ++, v ++)
+    {
+        for (int c = 0; c < 3; c ++)
+        {
+            v->pos[c] = corners[n][c];
+            v->shade[c] = shade;
+        }
+
+        v->tex[0] = s;
+        v->tex[1] = 0;
+    }
+
+    return v;
+}
+
+/* rebuilds the vertex array for one row of the history, at z = 0 */
+static void build_row (int row)
+{
+    BarVertex * v = s_rows[row];
+
+    for (int j = 0; j < NUM_BANDS; j ++)
+    {
+        float h = s_bars[row][j] * 1.6f;
+        float x1 = 1.6f - BAR_SPACING * j, x2 = x1 + BAR_WIDTH;
+        float z1 = 0, z2 = BAR_WIDTH;
+        float bright = 0.2f + 0.8f * h;
+        float s = (j + 0.5f) / NUM_BANDS;
+
+        const float top[4][3] = {{x1, h, z1}, {x2, h, z1}, {x2, h, z2}, {x1, h, z2}};
+        const float left[4][3] = {{x1, 0, z1}, {x1, h, z1}, {x1, h, z2}, {x1, 0, z2}};
+        const float right[4][3] = {{x2, h, z1}, {x2, 0, z1}, {x2, 0, z2}, {x2, h, z2}};
+        const float front[4][3] = {{x1, 0, z1}, {x2, 0, z1}, {x2, h, z1}, {x1, h, z1}};
+
+        v = add_quad (v, top, bright, s);
+        v = add_quad (v, left, 0.65f * bright, s);
+        v = add_quad (v, right, 0.65f * bright, s);
+        v = add_quad (v, front, 0.8f * bright, s);
+    }
+}
+
 class GLSpectrumWidget : public QOpenGLWidget, protected QOpenGLFunctions_2_0
 {
 public:
@@ -87,18 +146,25 @@ private:
     void resizeGL (int w, int h);
     void initializeGL ();
 
+    void create_texture ();
     void draw_bars ();
-    void draw_bar (float x, float z, float h, float r, float g, float b);
-    void draw_rectangle (float x1, float y1, float z1, float x2, float y2,
-                         float z2, float r, float g, float b);
+
+    GLuint m_texture = 0;
 };
 
 GLSpectrumWidget * s_widget = nullptr;
+static VisGovernor governor ("OpenGL Spectrum Analyzer");
+
+/* false while the widget or its window is hidden or minimized */
+static bool widget_visible ()
+{
+    return s_widget && s_widget->isVisible () &&
+     ! s_widget->window ()->isMinimized () && ! s_widget->visibleRegion ().isEmpty ();
+}
 
 bool GLSpectrumQt::init ()
 {
-    for (int i = 0; i <= NUM_BANDS; i ++)
-        logscale[i] = powf (256, (float) i / NUM_BANDS) - 0.5f;
+    compute_log_xscale (logscale, NUM_BANDS);
 
     for (int y = 0; y < NUM_BANDS; y ++)
     {
@@ -114,50 +180,28 @@ bool GLSpectrumQt::init ()
         }
     }
 
+    for (int i = 0; i < NUM_BANDS; i ++)
+        build_row (i);
+
     return true;
 }
 
-/* stolen from the skins plugin */
-/* convert linear frequency graph to logarithmic one */
-static void make_log_graph (const float * freq, float * graph)
+void GLSpectrumQt::render_freq (const float * freq)
 {
-    for (int i = 0; i < NUM_BANDS; i ++)
-    {
-        /* sum up values in freq array between logscale[i] and logscale[i + 1],
-           including fractional parts */
-        int a = ceilf (logscale[i]);
-        int b = floorf (logscale[i + 1]);
-        float sum = 0;
-
-        if (b < a)
-            sum += freq[b] * (logscale[i + 1] - logscale[i]);
-        else
-        {
-            if (a > 0)
-                sum += freq[a - 1] * (a - logscale[i]);
-            for (; a < b; a ++)
-                sum += freq[a];
-            if (b < 256)
-                sum += freq[b] * (logscale[i + 1] - b);
-        }
-
-        /* fudge factor to make the graph have the same overall height as a
-           12-band one no matter how many bands there are */
-        sum *= (float) NUM_BANDS / 12;
+    if (! governor.accept_frame (widget_visible ()))
+        return;
 
-        /* convert to dB */
-        float val = 20 * log10f (sum);
+    VisGovernor::Cost cost (governor);
+    float * graph = s_bars[s_pos];
 
+    for (int i = 0; i < NUM_BANDS; i ++)
+    {
         /* scale (-DB_RANGE, 0.0) to (0.0, 1.0) */
-        val = 1 + val / DB_RANGE;
-
+        float val = 1 + compute_freq_band (freq, logscale, i, NUM_BANDS) / DB_RANGE;
         graph[i] = aud::clamp (val, 0.0f, 1.0f);
     }
-}
 
-void GLSpectrumQt::render_freq (const float * freq)
-{
-    make_log_graph (freq, s_bars[s_pos]);
+    build_row (s_pos);
     s_pos = (s_pos + 1) % NUM_BANDS;
 
     s_angle += s_anglespeed;
@@ -172,52 +216,23 @@ void GLSpectrumQt::clear ()
 {
     memset (s_bars, 0, sizeof s_bars);
 
+    for (int i = 0; i < NUM_BANDS; i ++)
+        build_row (i);
+
     if (s_widget)
         s_widget->update ();
 }
 
-void GLSpectrumWidget::draw_rectangle (float x1, float y1, float z1, float x2, float y2,
- float z2, float r, float g, float b)
+void GLSpectrumWidget::create_texture ()
 {
-    glColor4f (r, g, b, 1.0f);
-
-    glBegin (GL_POLYGON);
-    glVertex3f (x1, y2, z1);
-    glVertex3f (x2, y2, z1);
-    glVertex3f (x2, y2, z2);
-    glVertex3f (x1, y2, z2);
-    glEnd ();
-
-    glColor4f (0.65f * r, 0.65f * g, 0.65f * b, 1.0f);
-
-    glBegin (GL_POLYGON);
-    glVertex3f (x1, y1, z1);
-    glVertex3f (x1, y2, z1);
-    glVertex3f (x1, y2, z2);
-    glVertex3f (x1, y1, z2);
-    glEnd ();
-
-    glBegin (GL_POLYGON);
-    glVertex3f (x2, y2, z1);
-    glVertex3f (x2, y1, z1);
-    glVertex3f (x2, y1, z2);
-    glVertex3f (x2, y2, z2);
-    glEnd ();
-
-    glColor4f (0.8f * r, 0.8f * g, 0.8f * b, 1.0f);
-
-    glBegin (GL_POLYGON);
-    glVertex3f (x1, y1, z1);
-    glVertex3f (x2, y1, z1);
-    glVertex3f (x2, y2, z1);
-    glVertex3f (x1, y2, z1);
-    glEnd ();
-}
-
-void GLSpectrumWidget::draw_bar (float x, float z, float h, float r, float g, float b)
-{
-    draw_rectangle (x, 0, z, x + BAR_WIDTH, h, z + BAR_WIDTH,
-     r * (0.2f + 0.8f * h), g * (0.2f + 0.8f * h), b * (0.2f + 0.8f * h));
+    glGenTextures (1, & m_texture);
+    glBindTexture (GL_TEXTURE_2D, m_texture);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    /* texel (j, i) is the color of bar j in on-screen row i */
+    glTexImage2D (GL_TEXTURE_2D, 0, GL_RGB, NUM_BANDS, NUM_BANDS, 0, GL_RGB,
+     GL_FLOAT, colors);
 }
 
 void GLSpectrumWidget::draw_bars ()
@@ -228,19 +243,43 @@ void GLSpectrumWidget::draw_bars ()
     glRotatef (s_angle + 180.0f, 0.0f, 1.0f, 0.0f);
     glPolygonMode (GL_FRONT_AND_BACK, GL_FILL);
 
+    glEnable (GL_TEXTURE_2D);
+    glBindTexture (GL_TEXTURE_2D, m_texture);
+    glTexEnvi (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    glEnableClientState (GL_VERTEX_ARRAY);
+    glEnableClientState (GL_COLOR_ARRAY);
+    glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+
     for (int i = 0; i < NUM_BANDS; i ++)
     {
-        float z = -1.6f + (NUM_BANDS - i) * BAR_SPACING;
+        const BarVertex * v = s_rows[(s_pos + i) % NUM_BANDS];
 
-        for (int j = 0; j < NUM_BANDS; j ++)
-        {
-            draw_bar (1.6f - BAR_SPACING * j, z,
-             s_bars[(s_pos + i) % NUM_BANDS][j] * 1.6,
-             colors[i][j][0], colors[i][j][1], colors[i][j][2]);
-        }
+        glPushMatrix ();
+        glTranslatef (0.0f, 0.0f, -1.6f + (NUM_BANDS - i) * BAR_SPACING);
+
+        glMatrixMode (GL_TEXTURE);
+        glLoadIdentity ();
+        glTranslatef (0.0f, (i + 0.5f) / NUM_BANDS, 0.0f);
+        glMatrixMode (GL_MODELVIEW);
+
+        glVertexPointer (3, GL_FLOAT, sizeof (BarVertex), v->pos);
+        glColorPointer (3, GL_FLOAT, sizeof (BarVertex), v->shade);
+        glTexCoordPointer (2, GL_FLOAT, sizeof (BarVertex), v->tex);
+        glDrawArrays (GL_QUADS, 0, NUM_BANDS * VERTS_PER_BAR);
+
+        glPopMatrix ();
     }
 
-    glPolygonMode (GL_FRONT_AND_BACK, GL_FILL);
+    glMatrixMode (GL_TEXTURE);
+    glLoadIdentity ();
+    glMatrixMode (GL_MODELVIEW);
+
+    glDisableClientState (GL_VERTEX_ARRAY);
+    glDisableClientState (GL_COLOR_ARRAY);
+    glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+    glDisable (GL_TEXTURE_2D);
+
     glPopMatrix ();
 }
 
@@ -254,11 +293,20 @@ GLSpectrumWidget::GLSpectrumWidget (QWidget * parent) : QOpenGLWidget (parent)
 
 GLSpectrumWidget::~GLSpectrumWidget ()
 {
+    if (m_texture)
+    {
+        makeCurrent ();
+        glDeleteTextures (1, & m_texture);
+        doneCurrent ();
+    }
+
     s_widget = nullptr;
 }
 
 void GLSpectrumWidget::paintGL ()
 {
+    VisGovernor::Cost cost (governor);
+
     glDisable (GL_BLEND);
     glMatrixMode (GL_PROJECTION);
     glPushMatrix();
@@ -284,6 +332,8 @@ void GLSpectrumWidget::paintGL ()
     glDisable (GL_DEPTH_TEST);
     glDisable (GL_BLEND);
     glDepthMask (GL_TRUE);
+
+    governor.frame_painted ();
 }
 
 void GLSpectrumWidget::resizeGL (int w, int h)
@@ -293,6 +343,7 @@ void GLSpectrumWidget::resizeGL (int w, int h)
 void GLSpectrumWidget::initializeGL ()
 {
     initializeOpenGLFunctions ();
+    create_texture ();
 }
 
 void * GLSpectrumQt::get_qt_widget ()
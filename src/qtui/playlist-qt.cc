@@ -20,6 +20,7 @@
 #include <QHeaderView>
 #include <QKeyEvent>
 #include <QMenu>
+#include <QScrollBar>
 #include <QSortFilterProxyModel>
 
 #include <libaudcore/audstrings.h>
@@ -37,12 +38,13 @@
 PlaylistWidget::PlaylistWidget(QWidget * parent, Playlist playlist)
     : audqt::TreeView(parent), m_playlist(playlist),
       model(new PlaylistModel(this, playlist)),
-      proxyModel(new PlaylistProxyModel(this, playlist))
+      proxyModel(new PlaylistProxyModel(this, playlist, model))
 {
     model->setFont(font());
 
     /* setting up filtering model */
     proxyModel->setSourceModel(model);
+    proxyModel->setFilterDoneFunc(filterDone, this);
 
     inUpdate = true; /* prevents changing focused row */
     setModel(proxyModel);
@@ -70,6 +72,9 @@ PlaylistWidget::PlaylistWidget(QWidget * parent, Playlist playlist)
     updateSelection(0, 0);
     inUpdate = false;
 
+    connect(verticalScrollBar(), &QScrollBar::valueChanged,
+            [this](int) { prefetchVisible(); });
+
     connect(this, &QTreeView::activated, [this](const QModelIndex & index) {
         if (index.isValid())
         {
@@ -126,6 +131,59 @@ QModelIndex PlaylistWidget::visibleIndexNear(int row)
     return index;
 }
 
+// fills the model's row cache for the visible rows and one page on
+// either side, so that scrolling back and forth hits the cache
+void PlaylistWidget::prefetchVisible()
+{
+    auto top = indexAt(QPoint(0, 0));
+    if (!top.isValid())
+        return;
+
+    auto bottom = indexAt(QPoint(0, viewport()->height() - 1));
+
+    int rows = proxyModel->rowCount();
+    int first = top.row();
+    int last = bottom.isValid() ? bottom.row() : rows - 1;
+    int page = last - first + 1;
+
+    first = aud::max(first - page, 0);
+    last = aud::min(last + page, rows - 1);
+
+    for (int r = first; r <= last; r++)
+        model->prefetchRows(proxyModel->mapToSource(proxyModel->index(r, 0)).row(), 1);
+}
+
+int PlaylistWidget::topRow()
+{
+    return indexToRow(indexAt(QPoint(0, 0)));
+}
+
+// the row can only be scrolled to once the widget has its final size
+void PlaylistWidget::setTopRow(int row)
+{
+    pendingTopRow = row;
+
+    if (isVisible())
+        applyTopRow();
+}
+
+void PlaylistWidget::applyTopRow()
+{
+    auto index = rowToIndex(pendingTopRow);
+    if (index.isValid())
+        scrollTo(index, PositionAtTop);
+
+    pendingTopRow = -1;
+}
+
+void PlaylistWidget::showEvent(QShowEvent * event)
+{
+    audqt::TreeView::showEvent(event);
+
+    if (pendingTopRow >= 0)
+        applyTopRow();
+}
+
 void PlaylistWidget::changeEvent(QEvent * event)
 {
     if (event->type() == QEvent::FontChange)
@@ -422,6 +480,8 @@ void PlaylistWidget::playlistUpdate()
     int entries = m_playlist.n_entries();
     int changed = entries - update.before - update.after;
 
+    proxyModel->playlistUpdate(update, model->rowCount());
+
     if (update.level == Playlist::Structure)
     {
         int old_entries = model->rowCount();
@@ -468,30 +528,34 @@ void PlaylistWidget::playlistUpdate()
 void PlaylistWidget::setFilter(const char * text)
 {
     // Save the current focus before filtering
-    int focus = m_playlist.get_focus();
+    filterFocus = m_playlist.get_focus();
 
-    // Empty the model before updating the filter.  This prevents Qt from
-    // performing a series of "rows added" or "rows deleted" updates, which can
-    // be very slow (worst case O(N^2) complexity) on a large playlist.
-    model->entriesRemoved(0, model->rowCount());
-
-    // Update the filter
+    // The filter is applied in the background; matching rows are shown as
+    // they are found and filterDone() is called at the end.
     proxyModel->setFilter(text);
+}
+
+void PlaylistWidget::filterDone(void * data)
+{
+    auto widget = (PlaylistWidget *)data;
+    int focus = widget->filterFocus;
 
-    // Repopulate the model
-    model->entriesAdded(0, m_playlist.n_entries());
+    if (focus < 0)
+        return;
+
+    widget->filterFocus = -1;
 
     // If the previously focused row is no longer visible with the new filter,
     // try to find a nearby one that is, and focus it.
-    auto index = visibleIndexNear(focus);
+    auto index = widget->visibleIndexNear(focus);
 
     if (index.isValid())
     {
-        focus = indexToRow(index);
-        m_playlist.set_focus(focus);
-        m_playlist.select_all(false);
-        m_playlist.select_entry(focus, true);
-        scrollTo(index);
+        focus = widget->indexToRow(index);
+        widget->m_playlist.set_focus(focus);
+        widget->m_playlist.select_all(false);
+        widget->m_playlist.select_entry(focus, true);
+        widget->scrollTo(index);
     }
 }
 
@@ -46,6 +46,10 @@ public:
     void setFirstVisibleColumn(int col);
     void moveFocus(int distance);
 
+    // used to keep the scroll position while the widget is released
+    int topRow();
+    void setTopRow(int row);
+
     void setContextMenu(QMenu * menu) { contextMenu = menu; }
 
 private:
@@ -55,6 +59,8 @@ private:
     QMenu * contextMenu = nullptr;
 
     int currentPos = -1;
+    int pendingTopRow = -1;
+    int filterFocus = -1;
     bool inUpdate = false;
     int firstVisibleColumn = 0;
 
@@ -64,6 +70,9 @@ private:
     QModelIndex rowToIndex(int row);
     int indexToRow(const QModelIndex & index);
     QModelIndex visibleIndexNear(int row);
+    void applyTopRow();
+
+    static void filterDone(void * data);
 
     void getSelectedRanges(int rowsBefore, int rowsAfter,
                            QItemSelection & selected,
@@ -71,6 +80,7 @@ private:
     void updateSelection(int rowsBefore, int rowsAfter);
 
     void changeEvent(QEvent * event);
+    void showEvent(QShowEvent * event);
     void contextMenuEvent(QContextMenuEvent * event);
     void keyPressEvent(QKeyEvent * event);
     void mouseMoveEvent(QMouseEvent * event);
@@ -87,6 +97,7 @@ private:
     void hidePopup();
 
     void updateSettings();
+    void prefetchVisible();
 
     const HookReceiver<PlaylistWidget> hook1{
         "qtui update playlist settings", this, &PlaylistWidget::updateSettings};
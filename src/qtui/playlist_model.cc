@@ -17,6 +17,8 @@
  * the use of this software.
  */
 
+#include <limits.h>
+
 #include <QApplication>
 #include <QIcon>
 #include <QMimeData>
@@ -25,6 +27,7 @@
 #include <libaudcore/audstrings.h>
 #include <libaudcore/drct.h>
 #include <libaudcore/i18n.h>
+#include <libaudcore/runtime.h>
 #include <libaudqt/libaudqt.h>
 
 #include "playlist_model.h"
@@ -54,6 +57,11 @@ PlaylistModel::PlaylistModel(QObject * parent, Playlist playlist)
 {
 }
 
+PlaylistModel::~PlaylistModel()
+{
+    AUDDBG("Row cache: %u hits, %u misses\n", m_hits, m_misses);
+}
+
 int PlaylistModel::rowCount(const QModelIndex & parent) const
 {
     return parent.isValid() ? 0 : m_rows;
@@ -89,46 +97,92 @@ QVariant PlaylistModel::alignment(int col) const
     }
 }
 
+const PlaylistModel::CachedRow & PlaylistModel::cachedRow(int row) const
+{
+    if (!m_cache.len())
+        m_cache.insert(0, RowCacheSize);
+
+    CachedRow & cached = m_cache[row % RowCacheSize];
+    if (cached.row == row)
+    {
+        m_hits++;
+        return cached;
+    }
+
+    m_misses++;
+    cached.row = row;
+
+    Tuple tuple = m_playlist.entry_tuple(row, Playlist::NoWait);
+
+    for (int col = 0; col < n_cols; col++)
+    {
+        auto field = s_fields[col];
+        if (field == Tuple::Invalid)
+            continue;
+
+        QVariant & value = cached.cols[col];
+
+        switch (tuple.get_value_type(field))
+        {
+        case Tuple::Empty:
+            value = QVariant();
+            break;
+        case Tuple::String:
+            value = QString(tuple.get_str(field));
+            break;
+        case Tuple::Int:
+        {
+            int val = tuple.get_int(field);
+
+            if (col == Length)
+                value = QString(str_format_time(val));
+            else if (col == Bitrate)
+                value = QString("%1 kbit/s").arg(val);
+            else
+                value = QString("%1").arg(val);
+
+            break;
+        }
+        }
+    }
+
+    return cached;
+}
+
+void PlaylistModel::prefetchRows(int row, int count) const
+{
+    int last = aud::min(row + aud::min(count, RowCacheSize), m_rows);
+    for (int r = aud::max(row, 0); r < last; r++)
+        cachedRow(r);
+}
+
+// drops cached rows from <from> up to (not including) <to>
+void PlaylistModel::invalidateRows(int from, int to)
+{
+    for (auto & cached : m_cache)
+    {
+        if (cached.row >= from && cached.row < to)
+            cached.row = -1;
+    }
+}
+
 QVariant PlaylistModel::data(const QModelIndex & index, int role) const
 {
     int col = index.column() - 1;
     if (col < 0 || col >= n_cols)
         return QVariant();
 
-    Tuple tuple;
-    int val = -1;
-
     switch (role)
     {
     case Qt::DisplayRole:
-        if (s_fields[col] != Tuple::Invalid)
-        {
-            tuple = m_playlist.entry_tuple(index.row(), Playlist::NoWait);
-
-            switch (tuple.get_value_type(s_fields[col]))
-            {
-            case Tuple::Empty:
-                return QVariant();
-            case Tuple::String:
-                return QString(tuple.get_str(s_fields[col]));
-            case Tuple::Int:
-                val = tuple.get_int(s_fields[col]);
-                break;
-            }
-        }
-
         switch (col)
         {
         case EntryNumber:
             return QString("%1").arg(index.row() + 1);
         case QueuePos:
             return queuePos(index.row());
-        case Length:
-            return QString(str_format_time(val));
-        case Bitrate:
-            return QString("%1 kbit/s").arg(val);
         default:
-            return QString("%1").arg(val);
+            return cachedRow(index.row()).cols[col];
         }
 
     case Qt::FontRole:
@@ -258,6 +312,8 @@ void PlaylistModel::entriesAdded(int row, int count)
     if (count < 1)
         return;
 
+    invalidateRows(row, INT_MAX);
+
     int last = row + count - 1;
     beginInsertRows(QModelIndex(), row, last);
     m_rows += count;
@@ -269,6 +325,8 @@ void PlaylistModel::entriesRemoved(int row, int count)
     if (count < 1)
         return;
 
+    invalidateRows(row, INT_MAX);
+
     int last = row + count - 1;
     beginRemoveRows(QModelIndex(), row, last);
     m_rows -= count;
@@ -280,12 +338,23 @@ void PlaylistModel::entriesChanged(int row, int count)
     if (count < 1)
         return;
 
+    invalidateRows(row, row + count);
+
     int bottom = row + count - 1;
     auto topLeft = createIndex(row, 0);
     auto bottomRight = createIndex(bottom, columnCount() - 1);
     emit dataChanged(topLeft, bottomRight);
 }
 
+void PlaylistModel::entriesRefiltered(int row, int count)
+{
+    if (count < 1)
+        return;
+
+    // the cached row data is still valid
+    emit dataChanged(createIndex(row, 0), createIndex(row + count - 1, 0));
+}
+
 QString PlaylistModel::queuePos(int row) const
 {
     int at = m_playlist.queue_find_entry(row);
@@ -297,32 +366,38 @@ QString PlaylistModel::queuePos(int row) const
 
 /* ---------------------------------- */
 
-void PlaylistProxyModel::setFilter(const char * filter)
+static constexpr int FILTER_CHUNK = 2048;
+
+PlaylistProxyModel::PlaylistProxyModel(QObject * parent, Playlist playlist,
+                                       PlaylistModel * model)
+    : QSortFilterProxyModel(parent), m_playlist(playlist), m_model(model)
 {
-    m_searchTerms = str_list_to_index(filter, " ");
-    invalidateFilter();
 }
 
-bool PlaylistProxyModel::filterAcceptsRow(int source_row,
-                                          const QModelIndex &) const
+PlaylistProxyModel::~PlaylistProxyModel()
 {
-    if (!m_searchTerms.len())
-        return true;
+    pthread_mutex_lock(&m_mutex);
+    m_quit = true;
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
 
-    Tuple tuple = m_playlist.entry_tuple(source_row);
+    if (m_running)
+        pthread_join(m_thread, nullptr);
 
-    String strings[] = {tuple.get_str(Tuple::Title),
-                        tuple.get_str(Tuple::Artist),
-                        tuple.get_str(Tuple::Album),
-                        tuple.get_str(Tuple::Basename)};
+    m_deliver.stop();
+}
 
-    for (auto & term : m_searchTerms)
+// each of the old terms must be contained in one of the new terms
+static bool terms_extend(const Index<String> & oldTerms,
+                         const Index<String> & newTerms)
+{
+    for (auto & oldTerm : oldTerms)
     {
         bool found = false;
 
-        for (auto & s : strings)
+        for (auto & newTerm : newTerms)
         {
-            if (s && strstr_nocase_utf8(s, term))
+            if (strstr(newTerm, oldTerm))
             {
                 found = true;
                 break;
@@ -335,3 +410,375 @@ bool PlaylistProxyModel::filterAcceptsRow(int source_row,
 
     return true;
 }
+
+static String fold_entry(const Tuple & tuple)
+{
+    Index<String> fields;
+
+    for (auto field : {Tuple::Title, Tuple::Artist, Tuple::Album, Tuple::Basename})
+    {
+        String s = tuple.get_str(field);
+        if (s)
+            fields.append(s);
+    }
+
+    return String(str_tolower_utf8(index_to_str_list(fields, "\n")));
+}
+
+static bool match_entry(const char * folded, const Index<String> & terms)
+{
+    for (auto & term : terms)
+    {
+        if (!strstr(folded, term))
+            return false;
+    }
+
+    return true;
+}
+
+void PlaylistProxyModel::setFilter(const char * filter)
+{
+    auto terms = str_list_to_index(str_tolower_utf8(filter), " ");
+
+    // a longer query can only match a subset of the previous result
+    bool narrowing = m_complete && m_terms.len() && terms_extend(m_terms, terms);
+
+    m_terms = std::move(terms);
+
+    if (!m_terms.len())
+    {
+        cancelJob();
+
+        // the folded metadata is kept only while filtering
+        pthread_mutex_lock(&m_mutex);
+        m_folded.clear();
+        pthread_mutex_unlock(&m_mutex);
+
+        m_shown.clear();
+        m_candidates.clear();
+        m_complete = false;
+
+        resetSourceModel();
+
+        if (m_doneFunc)
+            m_doneFunc(m_doneData);
+
+        return;
+    }
+
+    int rows = m_model->rowCount();
+
+    pthread_mutex_lock(&m_mutex);
+    if (m_folded.len() != rows)
+    {
+        m_folded.clear();
+        m_folded.insert(0, rows);
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    Index<int> candidates;
+
+    if (narrowing)
+    {
+        // the view keeps showing the previous result until this completes
+        for (int row = 0; row < rows; row++)
+        {
+            if (m_shown[row])
+                candidates.append(row);
+        }
+
+        startJob(std::move(candidates), false);
+    }
+    else
+    {
+        m_shown.clear();
+        m_shown.insert(0, rows);
+        resetSourceModel();
+
+        candidates.insert(0, rows);
+        for (int row = 0; row < rows; row++)
+            candidates[row] = row;
+
+        startJob(std::move(candidates), true);
+    }
+}
+
+void PlaylistProxyModel::playlistUpdate(const Playlist::Update & update,
+                                        int oldEntries)
+{
+    // a selection change leaves a running job unaffected
+    bool refilter = m_terms.len() && update.level >= Playlist::Metadata;
+
+    Index<int> remaining;
+
+    if (refilter)
+    {
+        // take what has been matched so far, so that only the rest is
+        // carried over into the new job
+        applyResults();
+
+        if (!m_complete)
+            remaining.insert(m_candidates.begin() + m_applied, 0,
+                             m_candidates.len() - m_applied);
+    }
+
+    int entries = m_playlist.n_entries();
+    int changed = entries - update.before - update.after;
+    int removed = oldEntries - update.before - update.after;
+
+    pthread_mutex_lock(&m_mutex);
+
+    if (refilter && update.level == Playlist::Structure)
+    {
+        m_folded.remove(update.before, removed);
+        m_folded.insert(update.before, changed);
+        m_structure++;
+    }
+    else if (refilter)
+    {
+        m_cleared++;
+
+        for (int row = update.before; row < update.before + changed; row++)
+        {
+            m_folded[row].text = String();
+            m_folded[row].cleared = m_cleared;
+        }
+    }
+
+    // lets the worker know that row numbers are up to date again
+    m_updates++;
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    if (!refilter)
+        return;
+
+    if (update.level == Playlist::Structure)
+    {
+        // new rows stay hidden until they have been matched
+        m_shown.remove(update.before, removed);
+        m_shown.insert(update.before, changed);
+    }
+
+    // match the changed rows, along with any rows that the previous job did
+    // not get to (renumbered past the change)
+    Index<int> candidates;
+
+    for (int row : remaining)
+    {
+        if (row < update.before)
+            candidates.append(row);
+    }
+
+    for (int row = update.before; row < update.before + changed; row++)
+        candidates.append(row);
+
+    for (int row : remaining)
+    {
+        if (row >= oldEntries - update.after)
+            candidates.append(row + entries - oldEntries);
+    }
+
+    startJob(std::move(candidates), m_complete || m_streaming);
+}
+
+bool PlaylistProxyModel::filterAcceptsRow(int source_row,
+                                          const QModelIndex &) const
+{
+    if (!m_terms.len())
+        return true;
+
+    return source_row < m_shown.len() && m_shown[source_row];
+}
+
+// Emptying and repopulating the source model is much faster than letting Qt
+// process a large number of scattered row insertions or removals.
+void PlaylistProxyModel::resetSourceModel()
+{
+    int rows = m_model->rowCount();
+    m_model->entriesRemoved(0, rows);
+    m_model->entriesAdded(0, rows);
+}
+
+void PlaylistProxyModel::cancelJob()
+{
+    m_generation++;
+
+    pthread_mutex_lock(&m_mutex);
+    m_jobGeneration = m_generation;
+    m_jobPending = false;
+    m_results.clear();
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+// In streaming mode, results are passed on to the view as they arrive.
+// Otherwise the view is updated all at once when the job completes.
+void PlaylistProxyModel::startJob(Index<int> && candidates, bool streaming)
+{
+    m_generation++;
+    m_candidates = std::move(candidates);
+    m_applied = 0;
+    m_streaming = streaming;
+    m_complete = false;
+
+    pthread_mutex_lock(&m_mutex);
+
+    m_jobGeneration = m_generation;
+    m_jobPending = true;
+    m_jobTerms = m_terms;
+    m_jobCandidates.clear();
+    m_jobCandidates.insert(m_candidates.begin(), 0, m_candidates.len());
+    m_results.clear();
+
+    if (!m_running)
+    {
+        m_quit = false;
+        m_running = !pthread_create(&m_thread, nullptr, worker, this);
+    }
+
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    if (!m_candidates.len())
+        applyResults();
+}
+
+void PlaylistProxyModel::applyResults()
+{
+    pthread_mutex_lock(&m_mutex);
+    auto results = std::move(m_results);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (auto & result : results)
+    {
+        if (result.generation != m_generation)
+            continue;
+
+        int count = result.matched.len();
+        int first = m_candidates[m_applied];
+        int last = m_candidates[m_applied + count - 1];
+
+        for (int i = 0; i < count; i++)
+            m_shown[m_candidates[m_applied + i]] = result.matched[i];
+
+        m_applied += count;
+
+        if (m_streaming)
+            m_model->entriesRefiltered(first, last - first + 1);
+    }
+
+    if (m_complete || m_applied < m_candidates.len())
+        return;
+
+    if (!m_streaming)
+        resetSourceModel();
+
+    m_candidates.clear();
+    m_applied = 0;
+    m_complete = true;
+
+    if (m_doneFunc)
+        m_doneFunc(m_doneData);
+}
+
+void * PlaylistProxyModel::worker(void * data)
+{
+    ((PlaylistProxyModel *)data)->run();
+    return nullptr;
+}
+
+void PlaylistProxyModel::deliver(void * data)
+{
+    ((PlaylistProxyModel *)data)->applyResults();
+}
+
+void PlaylistProxyModel::run()
+{
+    pthread_mutex_lock(&m_mutex);
+
+    while (!m_quit)
+    {
+        if (!m_jobPending)
+        {
+            pthread_cond_wait(&m_cond, &m_mutex);
+            continue;
+        }
+
+        int generation = m_jobGeneration;
+        auto terms = std::move(m_jobTerms);
+        auto candidates = std::move(m_jobCandidates);
+        m_jobPending = false;
+
+        for (int start = 0; start < candidates.len(); start += FILTER_CHUNK)
+        {
+            int count = aud::min(candidates.len() - start, FILTER_CHUNK);
+            int structure = m_structure;
+            int cleared = m_cleared;
+
+            // take the cached metadata, then look up the rest unlocked,
+            // since entry_tuple() may wait for the entry to be scanned
+            Index<String> texts;
+            for (int i = 0; i < count; i++)
+            {
+                int row = candidates[start + i];
+                texts.append(row < m_folded.len() ? m_folded[row].text : String());
+            }
+
+            pthread_mutex_unlock(&m_mutex);
+
+            Result result{generation};
+            result.matched.insert(0, count);
+
+            for (int i = 0; i < count; i++)
+            {
+                if (!texts[i])
+                    texts[i] = fold_entry(m_playlist.entry_tuple(candidates[start + i]));
+
+                result.matched[i] = match_entry(texts[i], terms);
+            }
+
+            pthread_mutex_lock(&m_mutex);
+
+            // row numbers may be out of date if the playlist has changed;
+            // wait for the update to be processed to find out
+            bool settled = true;
+
+            if (m_playlist.update_pending())
+            {
+                int updates = m_updates;
+
+                while (!m_quit && m_jobGeneration == generation &&
+                       m_updates == updates)
+                    pthread_cond_wait(&m_cond, &m_mutex);
+
+                settled = (m_updates != updates);
+            }
+
+            if (m_quit)
+                break;
+
+            // the texts remain valid, even if the job has been replaced,
+            // unless rows were inserted or removed meanwhile; rows whose
+            // metadata changed meanwhile are looked up again later
+            if (settled && m_structure == structure)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    int row = candidates[start + i];
+                    if (row < m_folded.len() && m_folded[row].cleared <= cleared)
+                        m_folded[row].text = std::move(texts[i]);
+                }
+            }
+
+            if (m_jobGeneration != generation)
+                break;
+
+            m_results.append(std::move(result));
+            m_deliver.queue(deliver, this);
+        }
+    }
+
+    pthread_mutex_unlock(&m_mutex);
+    return nullptr;
+}
@@ -20,9 +20,12 @@
 #ifndef PLAYLIST_MODEL_H
 #define PLAYLIST_MODEL_H
 
+#include <pthread.h>
+
 #include <QAbstractListModel>
 #include <QSortFilterProxyModel>
 
+#include <libaudcore/mainloop.h>
 #include <libaudcore/playlist.h>
 
 class PlaylistModel : public QAbstractListModel
@@ -53,6 +56,7 @@ public:
     static const char * const labels[];
 
     PlaylistModel(QObject * parent, Playlist playlist);
+    ~PlaylistModel();
 
     int rowCount(const QModelIndex & parent = QModelIndex()) const;
     int columnCount(const QModelIndex & parent = QModelIndex()) const;
@@ -70,35 +74,125 @@ public:
     void entriesAdded(int row, int count);
     void entriesRemoved(int row, int count);
     void entriesChanged(int row, int count);
+    // makes a proxy model re-evaluate its filter for the given rows
+    void entriesRefiltered(int row, int count);
 
     void setFont(const QFont & font);
     void setPlayingCol(int playing_col);
 
+    void prefetchRows(int row, int count) const;
+    unsigned cacheHits() const { return m_hits; }
+    unsigned cacheMisses() const { return m_misses; }
+
 private:
+    // display text of one playlist entry, prepared from a single tuple
+    struct CachedRow
+    {
+        int row = -1;
+        QVariant cols[n_cols];
+    };
+
+    // direct-mapped by row number; large enough for several screens
+    static constexpr int RowCacheSize = 512;
+
     Playlist m_playlist;
     int m_rows;
     QFont m_bold;
     int m_playing_col = -1;
 
+    mutable Index<CachedRow> m_cache;
+    mutable unsigned m_hits = 0, m_misses = 0;
+
     QVariant alignment(int col) const;
     QString queuePos(int row) const;
+
+    const CachedRow & cachedRow(int row) const;
+    void invalidateRows(int from, int to);
 };
 
+// Filtering runs on a background thread, so that looking up and matching
+// the metadata of a large playlist does not block the UI.  Matching rows
+// are added to the view as they are found.
 class PlaylistProxyModel : public QSortFilterProxyModel
 {
 public:
-    PlaylistProxyModel(QObject * parent, Playlist playlist)
-        : QSortFilterProxyModel(parent), m_playlist(playlist)
+    PlaylistProxyModel(QObject * parent, Playlist playlist,
+                       PlaylistModel * model);
+    ~PlaylistProxyModel();
+
+    void setFilter(const char * filter);
+
+    // called once the current filter has been applied to every row
+    void setFilterDoneFunc(void (*func)(void *), void * data)
     {
+        m_doneFunc = func;
+        m_doneData = data;
     }
 
-    void setFilter(const char * filter);
+    // must be called before the update is passed on to the source model
+    void playlistUpdate(const Playlist::Update & update, int oldEntries);
 
 private:
+    struct Result
+    {
+        int generation;
+        Index<char> matched;
+    };
+
+    // lowercased metadata of one row; <cleared> tells the worker whether the
+    // text was invalidated after it started looking up a chunk
+    struct FoldedText
+    {
+        String text;
+        int cleared = 0;
+    };
+
     bool filterAcceptsRow(int source_row, const QModelIndex &) const;
 
+    void startJob(Index<int> && candidates, bool streaming);
+    void cancelJob();
+    void resetSourceModel();
+    void applyResults();
+    void run();
+
+    static void * worker(void * data);
+    static void deliver(void * data);
+
     Playlist m_playlist;
-    Index<String> m_searchTerms;
+    PlaylistModel * m_model;
+
+    // accessed only from the main thread
+    Index<String> m_terms;
+    Index<char> m_shown;
+    Index<int> m_candidates;
+    int m_generation = 0;
+    int m_applied = 0;
+    bool m_streaming = false;
+    bool m_complete = false;
+
+    void (*m_doneFunc)(void *) = nullptr;
+    void * m_doneData = nullptr;
+
+    // shared with the worker thread, protected by m_mutex
+    pthread_mutex_t m_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t m_cond = PTHREAD_COND_INITIALIZER;
+    pthread_t m_thread;
+    bool m_running = false, m_quit = false;
+
+    int m_jobGeneration = 0;
+    bool m_jobPending = false;
+    Index<String> m_jobTerms;
+    Index<int> m_jobCandidates;
+    Index<FoldedText> m_folded; // built up as needed
+    Index<Result> m_results;
+
+    // counts of processed playlist updates: all of them, and those that
+    // renumbered rows or changed metadata while filtering
+    int m_updates = 0;
+    int m_structure = 0;
+    int m_cleared = 0;
+
+    QueuedFunc m_deliver;
 };
 
 #endif
@@ -35,37 +35,79 @@
 
 #include <libaudqt/libaudqt.h>
 
+// A tab page.  The playlist widget and search bar are created only when the
+// page is first shown, and may be released again while the page is hidden.
+// Selection and focus are kept by the core, so only the scroll position has
+// to be saved.
 class LayoutWidget : public QWidget
 {
 public:
     LayoutWidget(QWidget * parent, Playlist playlist, QMenu * contextMenu);
 
+    Playlist playlist() const { return m_playlist; }
     PlaylistWidget * playlistWidget() const { return m_playlistWidget; }
 
+    PlaylistWidget * ensurePlaylistWidget();
+    void releasePlaylistWidget();
+
+    // a filtered view would be lost on release
+    bool canRelease() const
+        { return m_playlistWidget && m_searchBar->isHidden(); }
+
     void activateSearch()
     {
+        ensurePlaylistWidget();
         m_searchBar->show();
         // use ShortcutFocusReason to select text in the search entry
         // (the default OtherFocusReason does not select text)
         m_searchBar->setFocus(Qt::ShortcutFocusReason);
     }
 
+    int lastVisit = 0;
+
 private:
-    PlaylistWidget * m_playlistWidget;
-    SearchBar * m_searchBar;
+    Playlist m_playlist;
+    QMenu * m_contextMenu;
+    PlaylistWidget * m_playlistWidget = nullptr;
+    SearchBar * m_searchBar = nullptr;
+    int m_topRow = -1;
 };
 
 LayoutWidget::LayoutWidget(QWidget * parent, Playlist playlist,
                            QMenu * contextMenu)
-    : QWidget(parent), m_playlistWidget(new PlaylistWidget(this, playlist)),
-      m_searchBar(new SearchBar(this, m_playlistWidget))
+    : QWidget(parent), m_playlist(playlist), m_contextMenu(contextMenu)
+{
+    audqt::make_vbox(this, 0);
+}
+
+PlaylistWidget * LayoutWidget::ensurePlaylistWidget()
 {
-    auto layout = audqt::make_vbox(this, 0);
-    layout->addWidget(m_playlistWidget);
-    layout->addWidget(m_searchBar);
+    if (m_playlistWidget)
+        return m_playlistWidget;
 
-    m_playlistWidget->setContextMenu(contextMenu);
+    m_playlistWidget = new PlaylistWidget(this, m_playlist);
+    m_searchBar = new SearchBar(this, m_playlistWidget);
+
+    layout()->addWidget(m_playlistWidget);
+    layout()->addWidget(m_searchBar);
+
+    m_playlistWidget->setContextMenu(m_contextMenu);
     m_searchBar->hide();
+
+    if (m_topRow >= 0 && m_topRow < m_playlist.n_entries())
+        m_playlistWidget->setTopRow(m_topRow);
+
+    return m_playlistWidget;
+}
+
+void LayoutWidget::releasePlaylistWidget()
+{
+    m_topRow = m_playlistWidget->topRow();
+
+    delete m_searchBar;
+    delete m_playlistWidget;
+    m_searchBar = nullptr;
+    m_playlistWidget = nullptr;
 }
 
 /* --------------------------------- */
@@ -80,18 +122,65 @@ PlaylistTabs::PlaylistTabs(QWidget * parent)
     m_tabbar->setFocusPolicy(Qt::NoFocus);
     setTabBar(m_tabbar);
 
+    m_populate_timer.start();
+
     addRemovePlaylists();
     m_tabbar->updateTitles();
     m_tabbar->updateIcons();
     setCurrentIndex(Playlist::active_playlist().index());
 
+    // report the startup cost once the first playlist has been painted
+    m_first_paint = showTab(currentIndex())->viewport();
+    m_first_paint->installEventFilter(this);
+
     connect(this, &QTabWidget::currentChanged, this,
             &PlaylistTabs::currentChangedTrigger);
 }
 
-PlaylistWidget * PlaylistTabs::currentPlaylistWidget() const
+PlaylistWidget * PlaylistTabs::showTab(int idx)
+{
+    auto w = (LayoutWidget *)widget(idx);
+    if (!w)
+        return nullptr;
+
+    w->lastVisit = ++m_visit_count;
+    auto playlistWidget = w->ensurePlaylistWidget();
+
+    releaseHiddenTabs();
+    return playlistWidget;
+}
+
+// releases the widgets of the least recently shown tabs
+void PlaylistTabs::releaseHiddenTabs()
 {
-    return ((LayoutWidget *)currentWidget())->playlistWidget();
+    while (true)
+    {
+        LayoutWidget * oldest = nullptr;
+        int hidden = 0;
+
+        for (int i = 0; i < count(); i++)
+        {
+            auto w = (LayoutWidget *)widget(i);
+            if (i == currentIndex() || !w->playlistWidget())
+                continue;
+
+            hidden++;
+
+            if (w->canRelease() &&
+                (!oldest || w->lastVisit < oldest->lastVisit))
+                oldest = w;
+        }
+
+        if (hidden <= max_hidden_tabs || !oldest)
+            break;
+
+        oldest->releasePlaylistWidget();
+    }
+}
+
+PlaylistWidget * PlaylistTabs::currentPlaylistWidget()
+{
+    return showTab(currentIndex());
 }
 
 PlaylistWidget * PlaylistTabs::playlistWidget(int idx) const
@@ -102,6 +191,7 @@ PlaylistWidget * PlaylistTabs::playlistWidget(int idx) const
 
 void PlaylistTabs::activateSearch()
 {
+    showTab(currentIndex());
     ((LayoutWidget *)currentWidget())->activateSearch();
 }
 
@@ -113,7 +203,7 @@ void PlaylistTabs::addRemovePlaylists()
     for (int i = 0; i < tabs; i++)
     {
         auto w = (LayoutWidget *)widget(i);
-        int list_idx = w->playlistWidget()->playlist().index();
+        int list_idx = w->playlist().index();
 
         if (list_idx < 0)
         {
@@ -129,7 +219,7 @@ void PlaylistTabs::addRemovePlaylists()
             for (int j = i + 1; j < tabs; j++)
             {
                 w = (LayoutWidget *)widget(j);
-                list_idx = w->playlistWidget()->playlist().index();
+                list_idx = w->playlist().index();
 
                 if (list_idx == i)
                 {
@@ -160,12 +250,25 @@ void PlaylistTabs::addRemovePlaylists()
 
 void PlaylistTabs::currentChangedTrigger(int idx)
 {
+    // during updates, the tab is shown once the final index is set
     if (!m_in_update)
+    {
+        showTab(idx);
         Playlist::by_index(idx).activate();
+    }
 }
 
 bool PlaylistTabs::eventFilter(QObject * obj, QEvent * e)
 {
+    if (e->type() == QEvent::Paint && obj == m_first_paint)
+    {
+        AUDDBG("%d playlists, first paint after %d ms\n",
+               Playlist::n_playlists(), (int)m_populate_timer.elapsed());
+
+        obj->removeEventFilter(this);
+        m_first_paint = nullptr;
+    }
+
     if (e->type() == QEvent::KeyPress)
     {
         QKeyEvent * ke = (QKeyEvent *)e;
@@ -193,6 +296,8 @@ void PlaylistTabs::playlist_activate_cb()
     setCurrentIndex(Playlist::active_playlist().index());
     m_tabbar->cancelRename();
     m_in_update = false;
+
+    showTab(currentIndex());
 }
 
 void PlaylistTabs::playlist_update_cb(Playlist::UpdateLevel global_level)
@@ -203,11 +308,18 @@ void PlaylistTabs::playlist_update_cb(Playlist::UpdateLevel global_level)
     if (global_level >= Playlist::Metadata)
         m_tabbar->updateTitles();
 
+    // hidden tabs without a widget are brought up to date when shown
     for (int i = 0; i < count(); i++)
-        playlistWidget(i)->playlistUpdate();
+    {
+        auto widget = playlistWidget(i);
+        if (widget)
+            widget->playlistUpdate();
+    }
 
     setCurrentIndex(Playlist::active_playlist().index());
     m_in_update = false;
+
+    showTab(currentIndex());
 }
 
 void PlaylistTabs::playlist_position_cb(Playlist list)
@@ -20,6 +20,7 @@
 #ifndef PLAYLIST_TABS_H
 #define PLAYLIST_TABS_H
 
+#include <QElapsedTimer>
 #include <QTabBar>
 #include <QTabWidget>
 
@@ -36,7 +37,9 @@ class PlaylistTabs : public QTabWidget
 public:
     PlaylistTabs(QWidget * parent = nullptr);
 
-    PlaylistWidget * currentPlaylistWidget() const;
+    // creates the current tab's widget if needed
+    PlaylistWidget * currentPlaylistWidget();
+    // returns nullptr for tabs that have not been shown recently
     PlaylistWidget * playlistWidget(int idx) const;
 
     void currentChangedTrigger(int idx);
@@ -50,6 +53,16 @@ private:
     PlaylistTabBar * m_tabbar;
     bool m_in_update = false;
 
+    // at most this many tabs besides the current one keep their widgets
+    static constexpr int max_hidden_tabs = 8;
+    int m_visit_count = 0;
+
+    QElapsedTimer m_populate_timer;
+    QObject * m_first_paint = nullptr;
+
+    PlaylistWidget * showTab(int idx);
+    void releaseHiddenTabs();
+
     void activateSearch();
     void addRemovePlaylists();
     void renameCurrent();
@@ -180,8 +180,26 @@ bool SIDPlugin::play(const char *filename, VFSFile &file)
 
     while (! check_stop ())
     {
-        if (check_seek () >= 0)
-            AUDWARN ("Seeking is not implemented, ignoring.\n");
+        int seek_value = check_seek ();
+        if (seek_value >= 0)
+        {
+            int time_played = aud::rescale<int64_t> (bytes_played,
+             xs_cfg.audioFrequency * xs_cfg.audioChannels * 2, 1000);
+
+            /* The emulation can only run forward, so seeking backward
+             * restarts the sub-tune from the beginning. */
+            if (seek_value < time_played)
+            {
+                if (!xs_sidplayfp_initsong(subTune))
+                    break;
+
+                time_played = 0;
+            }
+
+            xs_sidplayfp_skip(seek_value - time_played, audioBuffer, audioBufSize);
+            bytes_played = aud::rescale<int64_t> (seek_value, 1000,
+             xs_cfg.audioFrequency * xs_cfg.audioChannels) * 2;
+        }
 
         int bufRemaining = xs_sidplayfp_fillbuffer(audioBuffer, audioBufSize);
 
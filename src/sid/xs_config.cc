@@ -39,6 +39,7 @@ static constexpr const char * const defaults[] = {
     "mos8580", "FALSE",
     "forceModel", "FALSE",
     "emulateFilters", "TRUE",
+    "engineProfile", aud::numeric_string<XS_ENGINE_QUALITY>::str,
     "clockSpeed", aud::numeric_string<XS_CLOCK_PAL>::str,
     "forceSpeed", "FALSE",
     "playMaxTimeEnable", "FALSE",
@@ -57,6 +58,11 @@ static constexpr ComboItem clock_speeds[] = {
     {"PAL", XS_CLOCK_PAL}
 };
 
+static constexpr ComboItem engine_profiles[] = {
+    ComboItem(N_("High quality (reSIDfp)"), XS_ENGINE_QUALITY),
+    ComboItem(N_("Fast (reSID, fast sampling)"), XS_ENGINE_FAST)
+};
+
 static constexpr PreferencesWidget widgets[] = {
     WidgetLabel(N_("<b>Output</b>")),
     WidgetSpin(N_("Channels:"),
@@ -66,6 +72,9 @@ static constexpr PreferencesWidget widgets[] = {
         WidgetInt("sid", "audioFrequency"),
         {8000, 96000, 25, N_("Hz")}),
     WidgetLabel(N_("<b>Emulation</b>")),
+    WidgetCombo(N_("Engine:"),
+        WidgetInt("sid", "engineProfile"),
+        {{engine_profiles}}),
     WidgetCheck(N_("Emulate MOS 8580 (default: MOS 6581)"),
         WidgetBool("sid", "mos8580")),
     WidgetCheck(N_("Do not automatically select chip model"),
@@ -123,6 +132,7 @@ void xs_init_configuration()
 
     /* Filter values */
     xs_cfg.emulateFilters = aud_get_bool("sid", "emulateFilters");
+    xs_cfg.engineProfile = aud_get_int("sid", "engineProfile");
 
     xs_cfg.clockSpeed = aud_get_int("sid", "clockSpeed");
     xs_cfg.forceSpeed = aud_get_bool("sid", "forceSpeed");
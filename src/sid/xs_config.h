@@ -18,6 +18,12 @@ enum XS_CLOCK {
 };
 
 
+enum XS_ENGINE {
+    XS_ENGINE_QUALITY = 0,      /* reSIDfp, resampling */
+    XS_ENGINE_FAST              /* reSID (if available), fast sampling */
+};
+
+
 enum XS_SIDMODEL {
     XS_SIDMODEL_UNKNOWN = 0,
     XS_SIDMODEL_6581,
@@ -38,6 +44,7 @@ extern struct xs_cfg_t {
     bool    forceSpeed;         /* true = force to given clockspeed */
 
     bool    emulateFilters;
+    int     engineProfile;      /* quality/speed trade-off, see XS_ENGINE */
 
     /* Playing settings */
     bool    playMaxTimeEnable,
@@ -27,32 +27,135 @@
 #include "xs_config.h"
 #include "xs_sidplay2.h"
 
-#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <sidplayfp/sidplayfp.h>
-#include <sidplayfp/SidDatabase.h>
+#include <sidplayfp/sidversion.h>
 #include <sidplayfp/SidInfo.h>
 #include <sidplayfp/SidTune.h>
 #include <sidplayfp/SidTuneInfo.h>
 #include <sidplayfp/builders/residfp.h>
 
+#if __has_include(<sidplayfp/builders/resid.h>)
+#include <sidplayfp/builders/resid.h>
+#define XS_HAVE_RESID
+#endif
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/multihash.h>
 #include <libaudcore/runtime.h>
 #include <libaudcore/vfs.h>
 
+/* Emulation speed-up used while seeking; 3200% is the maximum
+ * accepted by sidplayfp::fastForward() */
+#define XS_FASTFORWARD_PERCENT 3200
+
+/* Song lengths per sub-tune (in milliseconds), keyed on tune MD5 */
+typedef SimpleHash<String, Index<int>> SongLengthIndex;
+
 struct SidState {
     sidplayfp *currEng;
     sidbuilder *currBuilder;
     SidTune *currTune;
 
-    SidDatabase database;
-    bool database_loaded = false;
-    pthread_mutex_t database_mutex = PTHREAD_MUTEX_INITIALIZER;
+    /* read-only once loaded, so lookups need no locking */
+    SongLengthIndex songLengths;
 };
 
 static SidState state;
 
 
+/* Parse a "m:ss[.mmm]" entry (optionally followed by a "(X)" flag
+ * as in older HVSC releases) into milliseconds
+ */
+static int xs_parse_length(const char *str)
+{
+    char *end;
+    long min = strtol(str, &end, 10);
+    if (end == str || *end != ':')
+        return -1;
+
+    str = end + 1;
+    long sec = strtol(str, &end, 10);
+    if (end == str)
+        return -1;
+
+    long ms = 0;
+    if (*end == '.') {
+        str = end + 1;
+        ms = strtol(str, &end, 10);
+        /* scale "5" to 500 ms, "25" to 250 ms, etc. */
+        for (int digits = end - str; digits < 3; digits++)
+            ms *= 10;
+    }
+
+    return (min * 60 + sec) * 1000 + ms;
+}
+
+
+/* Load the HVSC song length database into an in-memory MD5 index
+ */
+static void xs_load_songlengths(const char *filename)
+{
+    VFSFile file(filename, "r");
+    if (!file)
+        return;
+
+    Index<char> data = file.read_all();
+    data.append(0);
+
+    char *line = data.begin();
+    while (line && *line) {
+        char *next = strchr(line, '\n');
+        if (next)
+            *next++ = 0;
+
+        char *eq = strchr(line, '=');
+        if (line[0] != ';' && line[0] != '[' && eq) {
+            *eq = 0;
+
+            Index<int> lengths;
+            for (char *tok = strtok(eq + 1, " \t\r"); tok; tok = strtok(nullptr, " \t\r"))
+                lengths.append(xs_parse_length(tok));
+
+            if (lengths.len())
+                state.songLengths.add(String(str_tolower(line)), std::move(lengths));
+        }
+
+        line = next;
+    }
+
+    AUDDBG("Loaded %d song length entries.\n", state.songLengths.n_items());
+}
+
+
+/* Look up the length of each sub-tune of the given tune
+ */
+static void xs_lookup_songlengths(SidTune &tune, xs_tuneinfo_t &ti)
+{
+    if (!state.songLengths.n_items())
+        return;
+
+    /* Songlengths.md5 as shipped since HVSC #68 uses the new MD5 format */
+    char md5[SidTune::MD5_LENGTH + 1];
+#if LIBSIDPLAYFP_VERSION_MAJ > 2 || \
+    (LIBSIDPLAYFP_VERSION_MAJ == 2 && LIBSIDPLAYFP_VERSION_MIN >= 2)
+    if (!tune.createMD5New(md5))
+#else
+    if (!tune.createMD5(md5))
+#endif
+        return;
+
+    const Index<int> *lengths = state.songLengths.lookup(String(md5));
+    if (!lengths)
+        return;
+
+    for (int i = 0; i < ti.nsubTunes && i < lengths->len(); i++)
+        ti.subTunes[i].tuneLength = (*lengths)[i];
+}
+
+
 /* Check if we can play the given file
  */
 bool xs_sidplayfp_probe(const void *buf, int64_t bufSize)
@@ -89,8 +192,30 @@ bool xs_sidplayfp_init()
     /* Audio parameters sanity checking and setup */
     config.frequency = xs_cfg.audioFrequency;
 
-    /* Initialize builder object */
-    state.currBuilder = new ReSIDfpBuilder("ReSIDfp builder");
+    /* Initialize builder object according to the engine profile */
+    switch (xs_cfg.engineProfile)
+    {
+    case XS_ENGINE_FAST:
+        config.samplingMethod = SidConfig::INTERPOLATE;
+        config.fastSampling = true;
+#ifdef XS_HAVE_RESID
+        state.currBuilder = new ReSIDBuilder("ReSID builder");
+#else
+        state.currBuilder = new ReSIDfpBuilder("ReSIDfp builder");
+#endif
+        break;
+
+    default:
+        AUDERR("[SIDPlayFP] Invalid engineProfile=%d, falling back to high quality.\n",
+            xs_cfg.engineProfile);
+        /* fall through */
+    case XS_ENGINE_QUALITY:
+        config.samplingMethod = SidConfig::RESAMPLE_INTERPOLATE;
+        config.fastSampling = false;
+        state.currBuilder = new ReSIDfpBuilder("ReSIDfp builder");
+        xs_cfg.engineProfile = XS_ENGINE_QUALITY;
+        break;
+    }
 
     /* Builder object created, initialize it */
     state.currBuilder->create(state.currEng->info().maxsids());
@@ -155,7 +280,7 @@ bool xs_sidplayfp_init()
     }
 
     /* Load song length database */
-    state.database_loaded = state.database.open(SIDDATADIR "/sidplayfp/Songlengths.md5");
+    xs_load_songlengths("file://" SIDDATADIR "/sidplayfp/Songlengths.md5");
 
     /* Create the sidtune */
     state.currTune = new SidTune(0);
@@ -184,8 +309,7 @@ void xs_sidplayfp_close()
         state.currTune = nullptr;
     }
 
-    if (state.database_loaded)
-        state.database.close();
+    state.songLengths.clear();
 }
 
 
@@ -215,6 +339,40 @@ unsigned xs_sidplayfp_fillbuffer(char * audioBuffer, unsigned audioBufSize)
 }
 
 
+/* Emulate forward by the given time with output discarded. The emulation
+ * runs in fast-forward mode, which produces only a fraction of the samples
+ * and skips the final resampling for the rest.
+ */
+void xs_sidplayfp_skip(int msec, char * audioBuffer, unsigned audioBufSize)
+{
+    int64_t remaining = aud::rescale<int64_t> (msec, 1000,
+     xs_cfg.audioFrequency * xs_cfg.audioChannels);
+
+    bool fast = state.currEng->fastForward(XS_FASTFORWARD_PERCENT);
+    int ratio = fast ? XS_FASTFORWARD_PERCENT / 100 : 1;
+
+    while (remaining > 0)
+    {
+        unsigned count = aud::min<int64_t> (audioBufSize / 2,
+         (remaining + ratio - 1) / ratio);
+
+        /* keep whole frames so that the channels stay aligned */
+        count -= count % xs_cfg.audioChannels;
+        if (!count)
+            count = xs_cfg.audioChannels;
+
+        unsigned done = state.currEng->play((short *)audioBuffer, count);
+        if (!done)
+            break;
+
+        remaining -= (int64_t)done * ratio;
+    }
+
+    if (fast)
+        state.currEng->fastForward(100);
+}
+
+
 /* Load a given SID-tune file
  */
 bool xs_sidplayfp_load(const void *buf, int64_t bufSize)
@@ -250,18 +408,7 @@ bool xs_sidplayfp_getinfo(xs_tuneinfo_t &ti, const void *buf, int64_t bufSize)
     /* Fill in subtune information */
     ti.subTunes.insert(0, ti.nsubTunes);
 
-    if (state.database_loaded)
-    {
-        pthread_mutex_lock(&state.database_mutex);
-
-        for (int i = 0; i < ti.nsubTunes; i++)
-        {
-            myTune.selectSong(i + 1);
-            ti.subTunes[i].tuneLength = state.database.lengthMs(myTune);
-        }
-
-        pthread_mutex_unlock(&state.database_mutex);
-    }
+    xs_lookup_songlengths(myTune, ti);
 
     return true;
 }
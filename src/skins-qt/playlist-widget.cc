@@ -133,6 +133,32 @@ void PlaylistWidget::cancel_all ()
     popup_hide ();
 }
 
+const PlaylistWidget::CachedRow & PlaylistWidget::cached_row (int entry)
+{
+    CachedRow & row = m_row_cache[entry % RowCacheSize];
+    if (row.entry == entry)
+        return row;
+
+    Tuple tuple = m_playlist.entry_tuple (entry, Playlist::NoWait);
+    int len = tuple.get_int (Tuple::Length);
+
+    row.entry = entry;
+    row.length = (len >= 0) ? QString ((const char *) str_format_time (len)) : QString ();
+    row.title = QString ((const char *) tuple.get_str (Tuple::FormattedTitle));
+
+    return row;
+}
+
+/* drops cached rows for entries from <from> up to (not including) <to> */
+void PlaylistWidget::invalidate_rows (int from, int to)
+{
+    for (CachedRow & row : m_row_cache)
+    {
+        if (row.entry >= from && row.entry < to)
+            row = CachedRow ();
+    }
+}
+
 void PlaylistWidget::draw (QPainter & cr)
 {
     int active_entry = m_playlist.get_position ();
@@ -193,17 +219,15 @@ void PlaylistWidget::draw (QPainter & cr)
 
     for (int i = m_first; i < m_first + m_rows && i < m_length; i ++)
     {
-        Tuple tuple = m_playlist.entry_tuple (i, Playlist::NoWait);
-        int len = tuple.get_int (Tuple::Length);
-        if (len < 0)
+        auto & row = cached_row (i);
+        if (row.length.isNull ())
             continue;
 
         cr.setPen (QColor (skin.colors[(i == active_entry) ?
          SKIN_PLEDIT_CURRENT : SKIN_PLEDIT_NORMAL]));
         cr.drawText (left, m_offset + m_row_height * (i - m_first),
          m_width - left - right, m_row_height,
-         Qt::AlignRight | Qt::AlignVCenter,
-         (const char *) str_format_time (len), & rect);
+         Qt::AlignRight | Qt::AlignVCenter, row.length, & rect);
 
         width = aud::max (width, rect.width ());
     }
@@ -241,14 +265,11 @@ void PlaylistWidget::draw (QPainter & cr)
 
     for (int i = m_first; i < m_first + m_rows && i < m_length; i ++)
     {
-        Tuple tuple = m_playlist.entry_tuple (i, Playlist::NoWait);
-        String title = tuple.get_str (Tuple::FormattedTitle);
-
         cr.setPen (QColor (skin.colors[(i == active_entry) ?
          SKIN_PLEDIT_CURRENT : SKIN_PLEDIT_NORMAL]));
         cr.drawText (left, m_offset + m_row_height * (i - m_first),
          m_width - left - right, m_row_height,
-         Qt::AlignLeft | Qt::AlignVCenter, (const char *) title);
+         Qt::AlignLeft | Qt::AlignVCenter, cached_row (i).title);
     }
 
     /* focus rectangle */
@@ -299,6 +320,22 @@ void PlaylistWidget::set_font (const char * font)
     refresh ();
 }
 
+void PlaylistWidget::playlist_update ()
+{
+    if (m_playlist == Playlist::active_playlist ())
+    {
+        auto update = m_playlist.update_detail ();
+
+        /* structural changes may shift all following entries */
+        if (update.level == Playlist::Structure)
+            invalidate_rows (update.before, INT_MAX);
+        else if (update.level == Playlist::Metadata)
+            invalidate_rows (update.before, m_playlist.n_entries () - update.after);
+    }
+
+    refresh ();
+}
+
 void PlaylistWidget::refresh ()
 {
     auto prev_playlist = m_playlist;
@@ -310,6 +347,7 @@ void PlaylistWidget::refresh ()
 
     if (m_playlist != prev_playlist)
     {
+        clear_cache ();
         cancel_all ();
         m_first = 0;
         ensure_visible (m_playlist.get_focus ());
@@ -28,6 +28,10 @@
 #ifndef SKINS_UI_SKINNED_PLAYLIST_H
 #define SKINS_UI_SKINNED_PLAYLIST_H
 
+#include <limits.h>
+
+#include <QString>
+
 #include <libaudcore/hook.h>
 #include <libaudcore/mainloop.h>
 #include <libaudcore/playlist.h>
@@ -48,6 +52,7 @@ public:
     void resize (int width, int height);
     void set_font (const char * m_font);
     void refresh ();
+    void playlist_update ();
     bool handle_keypress (QKeyEvent * event);
     void row_info (int * m_rows, int * m_first);
     void scroll_to (int row);
@@ -56,6 +61,17 @@ public:
     int hover_end ();
 
 private:
+    /* display text of a playlist entry */
+    struct CachedRow {
+        int entry = -1;
+        QString length;
+        QString title;
+    };
+
+    const CachedRow & cached_row (int entry);
+    void invalidate_rows (int from, int to);
+    void clear_cache () { invalidate_rows (0, INT_MAX); }
+
     void draw (QPainter & cr) override;
     bool button_press (QMouseEvent * event) override;
     bool button_release (QMouseEvent * event) override;
@@ -99,6 +115,11 @@ private:
     int m_width = 0, m_height = 0, m_row_height = 1, m_offset = 0, m_rows = 0, m_first = 0;
     int m_scroll = 0, m_hover = -1, m_drag = 0, m_popup_pos = -1;
     QueuedFunc m_popup_timer;
+
+    /* direct-mapped by entry number, so any window of consecutive
+     * rows up to this size can be redrawn without refetching */
+    static constexpr int RowCacheSize = 512;
+    CachedRow m_row_cache[RowCacheSize];
 };
 
 #endif
@@ -491,7 +491,7 @@ static void playlistwin_create_window ()
 
 static void update_cb (void *, void *)
 {
-    playlistwin_list->refresh ();
+    playlistwin_list->playlist_update ();
 
     update_info ();
     update_rollup_text ();
@@ -0,0 +1,2 @@
+#include "skins_util.h"
+#include "../ui-common/skin-files.cc"
@@ -27,6 +27,7 @@
  * Audacious or using our public API to be a derived work.
  */
 
+#include <limits.h>
 #include <gdk/gdkkeysyms.h>
 
 #include "menus.h"
@@ -130,6 +131,82 @@ void PlaylistWidget::cancel_all ()
     popup_hide ();
 }
 
+static void clear_row (void * layout)
+{
+    if (layout)
+        g_object_unref (layout);
+}
+
+PlaylistWidget::CachedRow & PlaylistWidget::cached_row (int entry)
+{
+    CachedRow & row = m_row_cache[entry % RowCacheSize];
+    if (row.entry == entry)
+        return row;
+
+    clear_row (row.number);
+    clear_row (row.length);
+    clear_row (row.title);
+    row = CachedRow ();
+    row.entry = entry;
+
+    Tuple tuple = m_playlist.entry_tuple (entry, Playlist::NoWait);
+    PangoRectangle rect;
+
+    int len = tuple.get_int (Tuple::Length);
+    if (len >= 0)
+    {
+        row.length = gtk_widget_create_pango_layout (gtk_dr (), str_format_time (len));
+        pango_layout_set_font_description (row.length, m_font.get ());
+        pango_layout_get_pixel_extents (row.length, nullptr, & rect);
+        row.length_width = rect.width;
+    }
+
+    String title = tuple.get_str (Tuple::FormattedTitle);
+    row.title = gtk_widget_create_pango_layout (gtk_dr (), title);
+    pango_layout_set_font_description (row.title, m_font.get ());
+    pango_layout_set_ellipsize (row.title, PANGO_ELLIPSIZE_END);
+
+    return row;
+}
+
+PangoLayout * PlaylistWidget::cached_number (CachedRow & row)
+{
+    if (! row.number)
+    {
+        char buf[16];
+        snprintf (buf, sizeof buf, "%d.", 1 + row.entry);
+
+        row.number = gtk_widget_create_pango_layout (gtk_dr (), buf);
+        pango_layout_set_font_description (row.number, m_font.get ());
+
+        PangoRectangle rect;
+        pango_layout_get_pixel_extents (row.number, nullptr, & rect);
+        row.number_width = rect.width;
+    }
+
+    return row.number;
+}
+
+/* drops cached rows for entries from <from> up to (not including) <to> */
+void PlaylistWidget::invalidate_rows (int from, int to)
+{
+    for (CachedRow & row : m_row_cache)
+    {
+        if (row.entry >= from && row.entry < to)
+        {
+            clear_row (row.number);
+            clear_row (row.length);
+            clear_row (row.title);
+            row = CachedRow ();
+        }
+    }
+}
+
+void PlaylistWidget::clear_cache ()
+{
+    invalidate_rows (0, INT_MAX);
+}
+
 void PlaylistWidget::draw (cairo_t * cr)
 {
     int active_entry = m_playlist.get_position ();
@@ -178,21 +255,14 @@ void PlaylistWidget::draw (cairo_t * cr)
 
         for (int i = m_first; i < m_first + m_rows && i < m_length; i ++)
         {
-            char buf[16];
-            snprintf (buf, sizeof buf, "%d.", 1 + i);
-
-            layout = gtk_widget_create_pango_layout (gtk_dr (), buf);
-            pango_layout_set_font_description (layout, m_font.get ());
-
-            PangoRectangle rect;
-            pango_layout_get_pixel_extents (layout, nullptr, & rect);
-            width = aud::max (width, rect.width);
+            CachedRow & row = cached_row (i);
+            layout = cached_number (row);
+            width = aud::max (width, row.number_width);
 
             cairo_move_to (cr, left, m_offset + m_row_height * (i - m_first));
             set_cairo_color (cr, skin.colors[(i == active_entry) ?
              SKIN_PLEDIT_CURRENT : SKIN_PLEDIT_NORMAL]);
             pango_cairo_show_layout (cr, layout);
-            g_object_unref (layout);
         }
 
         left += width + 4;
@@ -204,23 +274,16 @@ void PlaylistWidget::draw (cairo_t * cr)
 
     for (int i = m_first; i < m_first + m_rows && i < m_length; i ++)
     {
-        Tuple tuple = m_playlist.entry_tuple (i, Playlist::NoWait);
-        int len = tuple.get_int (Tuple::Length);
-        if (len < 0)
+        CachedRow & row = cached_row (i);
+        if (! row.length)
             continue;
 
-        layout = gtk_widget_create_pango_layout (gtk_dr (), str_format_time (len));
-        pango_layout_set_font_description (layout, m_font.get ());
-
-        PangoRectangle rect;
-        pango_layout_get_pixel_extents (layout, nullptr, & rect);
-        width = aud::max (width, rect.width);
+        width = aud::max (width, row.length_width);
 
-        cairo_move_to (cr, m_width - right - rect.width, m_offset + m_row_height * (i - m_first));
+        cairo_move_to (cr, m_width - right - row.length_width, m_offset + m_row_height * (i - m_first));
         set_cairo_color (cr, skin.colors[(i == active_entry) ?
          SKIN_PLEDIT_CURRENT : SKIN_PLEDIT_NORMAL]);
-        pango_cairo_show_layout (cr, layout);
-        g_object_unref (layout);
+        pango_cairo_show_layout (cr, row.length);
     }
 
     right += width + 6;
@@ -262,19 +325,19 @@ void PlaylistWidget::draw (cairo_t * cr)
 
     for (int i = m_first; i < m_first + m_rows && i < m_length; i ++)
     {
-        Tuple tuple = m_playlist.entry_tuple (i, Playlist::NoWait);
-        String title = tuple.get_str (Tuple::FormattedTitle);
+        CachedRow & row = cached_row (i);
 
-        layout = gtk_widget_create_pango_layout (gtk_dr (), title);
-        pango_layout_set_font_description (layout, m_font.get ());
-        pango_layout_set_width (layout, PANGO_SCALE * (m_width - left - right));
-        pango_layout_set_ellipsize (layout, PANGO_ELLIPSIZE_END);
+        /* the available width depends on the other visible rows */
+        if (row.title_width != m_width - left - right)
+        {
+            row.title_width = m_width - left - right;
+            pango_layout_set_width (row.title, PANGO_SCALE * row.title_width);
+        }
 
         cairo_move_to (cr, left, m_offset + m_row_height * (i - m_first));
         set_cairo_color (cr, skin.colors[(i == active_entry) ?
          SKIN_PLEDIT_CURRENT : SKIN_PLEDIT_NORMAL]);
-        pango_cairo_show_layout (cr, layout);
-        g_object_unref (layout);
+        pango_cairo_show_layout (cr, row.title);
     }
 
     /* focus rectangle */
@@ -326,6 +389,7 @@ void PlaylistWidget::resize (int width, int height)
 void PlaylistWidget::set_font (const char * font)
 {
     m_font.capture (pango_font_description_from_string (font));
+    clear_cache ();
 
     PangoLayout * layout = gtk_widget_create_pango_layout (gtk_dr (), "A");
     pango_layout_set_font_description (layout, m_font.get ());
@@ -340,6 +404,22 @@ void PlaylistWidget::set_font (const char * font)
     refresh ();
 }
 
+void PlaylistWidget::playlist_update ()
+{
+    if (m_playlist == Playlist::active_playlist ())
+    {
+        auto update = m_playlist.update_detail ();
+
+        /* structural changes may shift all following entries */
+        if (update.level == Playlist::Structure)
+            invalidate_rows (update.before, INT_MAX);
+        else if (update.level == Playlist::Metadata)
+            invalidate_rows (update.before, m_playlist.n_entries () - update.after);
+    }
+
+    refresh ();
+}
+
 void PlaylistWidget::refresh ()
 {
     auto prev_playlist = m_playlist;
@@ -351,6 +431,7 @@ void PlaylistWidget::refresh ()
 
     if (m_playlist != prev_playlist)
     {
+        clear_cache ();
         cancel_all ();
         m_first = 0;
         ensure_visible (m_playlist.get_focus ());
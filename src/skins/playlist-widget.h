@@ -42,12 +42,13 @@ class PlaylistWidget : public Widget
 {
 public:
     PlaylistWidget (int width, int height, const char * font);
-    ~PlaylistWidget () { cancel_all (); }
+    ~PlaylistWidget () { cancel_all (); clear_cache (); }
 
     void set_slider (PlaylistSlider * slider) { m_slider = slider; }
     void resize (int width, int height);
     void set_font (const char * m_font);
     void refresh ();
+    void playlist_update ();
     bool handle_keypress (GdkEventKey * event);
     void row_info (int * m_rows, int * m_first);
     void scroll_to (int row);
@@ -56,6 +57,20 @@ public:
     int hover_end ();
 
 private:
+    /* text of a playlist entry, laid out for the current font */
+    struct CachedRow {
+        int entry = -1;
+        PangoLayout * number = nullptr;
+        PangoLayout * length = nullptr;
+        PangoLayout * title = nullptr;
+        int number_width = 0, length_width = 0, title_width = 0;
+    };
+
+    CachedRow & cached_row (int entry);
+    PangoLayout * cached_number (CachedRow & row);
+    void invalidate_rows (int from, int to);
+    void clear_cache ();
+
     void draw (cairo_t * cr);
     bool button_press (GdkEventButton * event);
     bool button_release (GdkEventButton * event);
@@ -94,6 +109,11 @@ private:
     int m_width = 0, m_height = 0, m_row_height = 1, m_offset = 0, m_rows = 0, m_first = 0;
     int m_scroll = 0, m_hover = -1, m_drag = 0, m_popup_pos = -1;
     QueuedFunc m_popup_timer;
+
+    /* direct-mapped by entry number, so any window of consecutive
+     * rows up to this size can be redrawn without re-layout */
+    static constexpr int RowCacheSize = 512;
+    CachedRow m_row_cache[RowCacheSize];
 };
 
 #endif
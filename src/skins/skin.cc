@@ -39,6 +39,8 @@
 #include "skin.h"
 #include "skins_util.h"
 
+#include "../ui-common/skin-files.h"
+
 struct SkinPixmapIdMapping {
     const char *name;
     const char *alt_name;
@@ -93,19 +95,54 @@ static const uint32_t default_vis_colors[24] = {
 
 Skin skin;
 
-static bool skin_load_pixmap_id (SkinPixmapId id, const char * path)
+static void skin_load_pixmap_id (int id, void * data)
 {
-    StringBuf filename = skin_pixmap_locate (path, skin_pixmap_id_map[id].name,
-     skin_pixmap_id_map[id].alt_name);
+    auto files = (const SkinFiles *) data;
+    const char * name = skin_pixmap_id_map[id].name;
 
-    if (! filename)
+    Index<char> buf = files->read_pixmap (name, skin_pixmap_id_map[id].alt_name);
+    if (! buf.len ())
     {
-        AUDERR ("Skin does not contain a \"%s\" pixmap.\n", skin_pixmap_id_map[id].name);
-        return false;
+        AUDERR ("Skin does not contain a \"%s\" pixmap.\n", name);
+        return;
     }
 
-    skin.pixmaps[id].capture (surface_new_from_file (filename));
-    return skin.pixmaps[id] ? true : false;
+    skin.pixmaps[id].capture (surface_new_from_data (buf, name));
+}
+
+static void skin_pixmap_to_cache (cairo_surface_t * s, SkinCachedPixmap & cached)
+{
+    cached.width = s ? cairo_image_surface_get_width (s) : 0;
+    cached.height = s ? cairo_image_surface_get_height (s) : 0;
+
+    if (! s)
+        return;
+
+    cairo_surface_flush (s);
+
+    const unsigned char * data = cairo_image_surface_get_data (s);
+    int stride = cairo_image_surface_get_stride (s);
+
+    for (int y = 0; y < cached.height; y ++)
+        cached.pixels.insert ((const uint32_t *) (data + stride * y), -1, cached.width);
+}
+
+static cairo_surface_t * skin_pixmap_from_cache (const SkinCachedPixmap & cached)
+{
+    if (! cached.width || ! cached.height)
+        return nullptr;
+
+    cairo_surface_t * s = surface_new (cached.width, cached.height);
+    cairo_surface_flush (s);
+
+    unsigned char * data = cairo_image_surface_get_data (s);
+    int stride = cairo_image_surface_get_stride (s);
+
+    for (int y = 0; y < cached.height; y ++)
+        memcpy (data + stride * y, & cached.pixels[cached.width * y], 4 * cached.width);
+
+    cairo_surface_mark_dirty (s);
+    return s;
 }
 
 static int color_diff (uint32_t a, uint32_t b)
@@ -149,15 +186,14 @@ static void skin_get_eq_spline_colors (cairo_surface_t * s)
         skin.eq_spline_colors[i] = surface_get_pixel (s, 115, i + 294);
 }
 
-static void skin_load_viscolor (const char * path)
+static void skin_load_viscolor (const SkinFiles & files)
 {
     memcpy (skin.vis_colors, default_vis_colors, sizeof skin.vis_colors);
 
-    VFSFile file = open_local_file_nocase (path, "viscolor.txt");
-    if (! file)
+    Index<char> buffer = files.read ("viscolor.txt");
+    if (! buffer.len ())
         return;
 
-    Index<char> buffer = file.read_all ();
     buffer.append (0);  /* null-terminated */
 
     char * string = buffer.begin ();
@@ -190,14 +226,36 @@ static void skin_numbers_generate_dash (CairoSurfacePtr & s)
     s.capture (surface);
 }
 
-static bool skin_load_pixmaps (const char * path)
+/* Decoded pixmaps are taken from the persistent cache if the skin has not
+ * changed since; otherwise they are decoded in parallel and cached. */
+static bool skin_load_pixmaps (const SkinFiles & files, const char * path)
 {
     AUDDBG ("Loading pixmaps in %s\n", path);
 
-    /* eq_ex.bmp was added after Winamp 2.0 so some skins do not include it */
-    for (int i = 0; i < SKIN_PIXMAP_COUNT; i ++)
-        if (! skin_load_pixmap_id ((SkinPixmapId) i, path) && i != SKIN_EQ_EX)
-            return false;
+    Index<SkinCachedPixmap> cached;
+
+    if (skin_cache_load (path, cached) && cached.len () == SKIN_PIXMAP_COUNT)
+    {
+        for (int i = 0; i < SKIN_PIXMAP_COUNT; i ++)
+            skin.pixmaps[i].capture (skin_pixmap_from_cache (cached[i]));
+    }
+    else
+    {
+        skin_run_parallel (SKIN_PIXMAP_COUNT, skin_load_pixmap_id, (void *) & files);
+
+        /* eq_ex.bmp was added after Winamp 2.0 so some skins do not include it */
+        for (int i = 0; i < SKIN_PIXMAP_COUNT; i ++)
+            if (! skin.pixmaps[i] && i != SKIN_EQ_EX)
+                return false;
+
+        cached.clear ();
+        cached.insert (0, SKIN_PIXMAP_COUNT);
+
+        for (int i = 0; i < SKIN_PIXMAP_COUNT; i ++)
+            skin_pixmap_to_cache (skin.pixmaps[i].get (), cached[i]);
+
+        skin_cache_save (path, cached);
+    }
 
     skin_get_textcolors (skin.pixmaps[SKIN_TEXT].get ());
     skin_get_eq_spline_colors (skin.pixmaps[SKIN_EQMAIN].get ());
@@ -213,36 +271,25 @@ static bool skin_load_data (const char * path)
     if (! g_file_test (path, G_FILE_TEST_EXISTS))
         return false;
 
-    StringBuf archive_path;
-    if (file_is_archive (path))
+    SkinFiles files;
+    if (! files.open (path))
     {
-        AUDDBG ("Attempt to load archive\n");
-        archive_path = archive_decompress (path);
-
-        if (! archive_path)
-        {
-            AUDDBG ("Unable to extract skin archive (%s)\n", path);
-            return false;
-        }
-
-        path = archive_path;
+        AUDDBG ("Unable to open skin (%s)\n", path);
+        return false;
     }
 
-    bool success = skin_load_pixmaps (path);
+    bool success = skin_load_pixmaps (files, path);
 
     if (success)
     {
-        skin_load_hints (path);
-        skin_load_pl_colors (path);
-        skin_load_viscolor (path);
-        skin_load_masks (path);
+        skin_load_hints (files);
+        skin_load_pl_colors (files);
+        skin_load_viscolor (files);
+        skin_load_masks (files);
     }
     else
         AUDDBG ("Skin loading failed\n");
 
-    if (archive_path)
-        del_directory (archive_path);
-
     return success;
 }
 
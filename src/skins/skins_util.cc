@@ -24,6 +24,7 @@
  */
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -46,9 +47,13 @@
 #define DIRMODE (S_IRWXU)
 #endif
 
+/* may be called from several threads while loading a skin */
 StringBuf find_file_case_path (const char * folder, const char * basename)
 {
     static SimpleHash<String, Index<String>> cache;
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    pthread_mutex_lock (& mutex);
 
     String key (folder);
     Index<String> * list = cache.lookup (key);
@@ -57,7 +62,10 @@ StringBuf find_file_case_path (const char * folder, const char * basename)
     {
         GDir * handle = g_dir_open (folder, 0, nullptr);
         if (! handle)
+        {
+            pthread_mutex_unlock (& mutex);
             return StringBuf ();
+        }
 
         list = cache.add (key, Index<String> ());
 
@@ -68,33 +76,19 @@ StringBuf find_file_case_path (const char * folder, const char * basename)
         g_dir_close (handle);
     }
 
+    String found;
     for (const String & entry : * list)
     {
         if (! strcmp_nocase (entry, basename))
-            return filename_build ({folder, entry});
+        {
+            found = entry;
+            break;
+        }
     }
 
-    return StringBuf ();
-}
-
-VFSFile open_local_file_nocase (const char * folder, const char * basename)
-{
-    StringBuf path = find_file_case_path (folder, basename);
-    return path ? VFSFile (path, "r") : VFSFile ();
-}
-
-StringBuf skin_pixmap_locate (const char * folder, const char * basename, const char * altname)
-{
-    static const char * const exts[] = {".bmp", ".png", ".xpm"};
-
-    for (const char * ext : exts)
-    {
-        StringBuf name = find_file_case_path (folder, str_concat ({basename, ext}));
-        if (name)
-            return name.settle ();
-    }
+    pthread_mutex_unlock (& mutex);
 
-    return altname ? skin_pixmap_locate (folder, altname) : StringBuf ();
+    return found ? filename_build ({folder, found}) : StringBuf ();
 }
 
 char * text_parse_line (char * text)
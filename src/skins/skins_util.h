@@ -32,10 +32,6 @@ typedef void (* DirForeachFunc) (const char * path, const char * basename);
 
 StringBuf find_file_case_path (const char * folder, const char * basename);
 
-VFSFile open_local_file_nocase (const char * folder, const char * basename);
-StringBuf skin_pixmap_locate (const char * folder, const char * basename,
- const char * altname = nullptr);
-
 char * text_parse_line (char * text);
 
 void make_directory (const char * path);
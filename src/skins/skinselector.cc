@@ -33,8 +33,11 @@
 #include "skin.h"
 #include "skinselector.h"
 #include "skins_util.h"
+#include "surface.h"
 #include "view.h"
 
+#include "../ui-common/skin-files.h"
+
 enum SkinViewCols {
     SKIN_VIEW_COL_PREVIEW,
     SKIN_VIEW_COL_FORMATTEDNAME,
@@ -54,26 +57,19 @@ static AudguiPixbuf skin_get_preview (const char * path)
 {
     AudguiPixbuf preview;
 
-    StringBuf archive_path;
-    if (file_is_archive (path))
-    {
-        archive_path = archive_decompress (path);
-        if (! archive_path)
-            return preview;
-
-        path = archive_path;
-    }
+    SkinFiles files;
+    if (! files.open (path))
+        return preview;
 
-    StringBuf preview_path = skin_pixmap_locate (path, "main");
-    if (preview_path)
-        preview.capture (gdk_pixbuf_new_from_file (preview_path, nullptr));
-
-    if (archive_path)
-        del_directory (archive_path);
+    Index<char> data = files.read_pixmap ("main");
+    if (data.len ())
+        preview.capture (pixbuf_new_from_data (data, path));
 
     return preview;
 }
 
+/* Returns the unscaled thumbnail, regenerating it if the skin has been
+ * modified since it was saved.  Called from several threads at once. */
 static AudguiPixbuf skin_get_thumbnail (const char * path)
 {
     StringBuf base = filename_get_base (path);
@@ -82,7 +78,7 @@ static AudguiPixbuf skin_get_thumbnail (const char * path)
     StringBuf thumbname = filename_build ({skins_get_skin_thumb_dir (), base});
     AudguiPixbuf thumb;
 
-    if (g_file_test (thumbname, G_FILE_TEST_EXISTS))
+    if (skin_cache_is_fresh (thumbname, path))
         thumb.capture (gdk_pixbuf_new_from_file (thumbname, nullptr));
 
     if (! thumb)
@@ -90,18 +86,17 @@ static AudguiPixbuf skin_get_thumbnail (const char * path)
         thumb = skin_get_preview (path);
 
         if (thumb)
-        {
-            make_directory (skins_get_skin_thumb_dir ());
             gdk_pixbuf_save (thumb.get (), thumbname, "png", nullptr, nullptr);
-        }
     }
 
-    if (thumb)
-        audgui_pixbuf_scale_within (thumb, audgui_get_dpi () * 3 / 2);
-
     return thumb;
 }
 
+static void skin_get_thumbnail_worker (int i, void * thumbs)
+{
+    ((AudguiPixbuf *) thumbs)[i] = skin_get_thumbnail (skinlist[i].path);
+}
+
 static void scan_skindir_func (const char * path, const char * basename)
 {
     if (g_file_test (path, G_FILE_TEST_IS_REGULAR))
@@ -149,9 +144,24 @@ void skin_view_update (GtkTreeView * treeview)
     String current_path = aud_get_str ("skins", "skin");
     GtkTreePath * current_skin = nullptr;
 
-    for (const SkinNode & node : skinlist)
+    /* generating thumbnails is slow with many skins installed, so it is
+     * spread across several threads */
+    Index<AudguiPixbuf> thumbnails;
+    thumbnails.insert (0, skinlist.len ());
+
+    make_directory (skins_get_skin_thumb_dir ());
+    skin_run_parallel (skinlist.len (), skin_get_thumbnail_worker, thumbnails.begin ());
+
+    int thumb_size = audgui_get_dpi () * 3 / 2;
+
+    for (int i = 0; i < skinlist.len (); i ++)
     {
-        AudguiPixbuf thumbnail = skin_get_thumbnail (node.path);
+        const SkinNode & node = skinlist[i];
+        AudguiPixbuf & thumbnail = thumbnails[i];
+
+        if (thumbnail)
+            audgui_pixbuf_scale_within (thumbnail, thumb_size);
+
         StringBuf formattedname = str_concat ({"<big><b>", node.name,
          "</b></big>\n<i>", node.desc, "</i>"});
 
@@ -31,16 +31,35 @@ cairo_surface_t * surface_new (int w, int h)
     return cairo_image_surface_create (CAIRO_FORMAT_RGB24, w, h);
 }
 
-cairo_surface_t * surface_new_from_file (const char * name)
+GdkPixbuf * pixbuf_new_from_data (const Index<char> & data, const char * name)
 {
     GError * error = nullptr;
-    AudguiPixbuf p (gdk_pixbuf_new_from_file (name, & error));
+    GdkPixbufLoader * loader = gdk_pixbuf_loader_new ();
+
+    if (gdk_pixbuf_loader_write (loader, (const unsigned char *) data.begin (),
+     data.len (), & error))
+        gdk_pixbuf_loader_close (loader, & error);
+    else
+        gdk_pixbuf_loader_close (loader, nullptr);
+
+    GdkPixbuf * pixbuf = nullptr;
 
     if (error)
     {
         AUDERR ("Error loading %s: %s.\n", name, error->message);
         g_error_free (error);
     }
+    else if ((pixbuf = gdk_pixbuf_loader_get_pixbuf (loader)))
+        g_object_ref (pixbuf);
+
+    g_object_unref (loader);
+    return pixbuf;
+}
+
+/* safe to call from any thread, since only image surfaces are involved */
+cairo_surface_t * surface_new_from_data (const Index<char> & data, const char * name)
+{
+    AudguiPixbuf p (pixbuf_new_from_data (data, name));
 
     if (! p)
         return nullptr;
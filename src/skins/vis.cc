@@ -36,11 +36,10 @@ static const float vis_pfalloff_speeds[] = {1.2, 1.3, 1.4, 1.5, 1.6};
 static const int vis_scope_colors[16] = {22, 22, 21, 21, 20, 10, 19, 19, 18,
  19, 19, 20, 20, 21, 21, 22};
 
-#define RGB_SEEK(x,y) (set = rgb + 76 * (y) + (x))
+#define RGB_SEEK(x,y) (set = m_rgb + 76 * (y) + (x))
 #define RGB_SET(c) (* set ++ = (c))
 #define RGB_SET_Y(c) do {* set = (c); set += 76;} while (0)
 #define RGB_SET_INDEX(c) RGB_SET (skin.vis_colors[c])
-#define RGB_SET_INDEX_Y(c) RGB_SET_Y (skin.vis_colors[c])
 
 void SkinnedVis::set_colors ()
 {
@@ -81,160 +80,253 @@ void SkinnedVis::set_colors ()
         RGB_SET_INDEX (1);
         RGB_SET_INDEX (0);
     }
+
+    update_palette ();
+    invalidate ();
 }
 
-void SkinnedVis::draw (cairo_t * cr)
+/* resolves the skin color indexes used by the analyzer and scope, so that
+ * drawing a column only copies pixels */
+void SkinnedVis::update_palette ()
 {
-    uint32_t rgb[76 * 16];
-    uint32_t * set;
-
-    if (config.vis_type != VIS_VOICEPRINT)
-    {
-        for (set = rgb; set < rgb + 76 * 16; set += 76 * 2)
-            memcpy (set, m_pattern_fill, sizeof m_pattern_fill);
-    }
-
-    switch (config.vis_type)
-    {
-    case VIS_ANALYZER:
+    for (int h = 0; h <= 16; h ++)
     {
-        bool bars = (config.analyzer_type == ANALYZER_BARS);
-
-        for (int x = 0; x < 75; x ++)
+        for (int y = 0; y < h; y ++)
         {
-            if (bars && (x & 3) == 3)
-                continue;
-
-            int h = m_data[bars ? (x >> 2) : x];
-            h = aud::clamp (h, 0, 16);
-            RGB_SEEK (x, 16 - h);
-
             switch (config.analyzer_mode)
             {
             case ANALYZER_NORMAL:
-                for (int y = 0; y < h; y ++)
-                    RGB_SET_INDEX_Y (18 - h + y);
+                m_bar_colors[h][y] = skin.vis_colors[18 - h + y];
                 break;
             case ANALYZER_FIRE:
-                for (int y = 0; y < h; y ++)
-                    RGB_SET_INDEX_Y (2 + y);
+                m_bar_colors[h][y] = skin.vis_colors[2 + y];
                 break;
             default: /* ANALYZER_VLINES */
-                for (int y = 0; y < h; y ++)
-                    RGB_SET_INDEX_Y (18 - h);
+                m_bar_colors[h][y] = skin.vis_colors[18 - h];
                 break;
             }
+        }
+    }
 
-            if (config.analyzer_peaks)
-            {
-                int h = m_peak[bars ? (x >> 2) : x];
-                h = aud::clamp (h, 0, 16);
+    for (int y = 0; y < 16; y ++)
+        m_scope_colors[y] = skin.vis_colors[vis_scope_colors[y]];
 
-                if (h)
-                {
-                    RGB_SEEK (x, 16 - h);
-                    RGB_SET_INDEX (23);
-                }
-            }
-        }
+    m_peak_color = skin.vis_colors[23];
+}
 
-        break;
-    }
-    case VIS_VOICEPRINT:
-    {
-        if (m_voiceprint_advance)
-        {
-            m_voiceprint_advance = false;
-            memmove (m_voiceprint_data, m_voiceprint_data + 1, sizeof
-             m_voiceprint_data - 1);
+void SkinnedVis::invalidate ()
+{
+    for (int & key : m_column_keys)
+        key = -1;
 
-            for (int y = 0; y < 16; y ++)
-                m_voiceprint_data[76 * y + 75] = m_data[y];
-        }
+    m_voiceprint_dirty = true;
+}
 
-        unsigned char * get = m_voiceprint_data;
-        uint32_t * colors = (config.voiceprint_mode == VOICEPRINT_NORMAL) ?
-         m_voice_color : (config.voiceprint_mode == VOICEPRINT_FIRE) ?
-         m_voice_color_fire : /* VOICEPRINT_ICE */ m_voice_color_ice;
-        set = rgb;
+/* summarizes everything that determines how column <x> looks in the current
+ * mode; 0 means the column shows only the background pattern */
+int SkinnedVis::column_key (int x) const
+{
+    if (x == 75)
+        return 0;
 
-        for (int y = 0; y < 16; y ++)
-        for (int x = 0; x < 76; x ++)
-            RGB_SET (colors[* get ++]);
-        break;
+    switch (config.vis_type)
+    {
+    case VIS_ANALYZER:
+    {
+        bool bars = (config.analyzer_type == ANALYZER_BARS);
+        if (bars && (x & 3) == 3)
+            return 0;
+
+        int i = bars ? (x >> 2) : x;
+        int h = aud::clamp ((int) m_data[i], 0, 16);
+        int peak = config.analyzer_peaks ? aud::clamp ((int) m_peak[i], 0, 16) : 0;
+
+        return 1 + h + 17 * peak;
     }
     case VIS_SCOPE:
+    {
         if (! m_active)
-            goto DRAW;
+            return 0;
 
-        switch (config.scope_mode)
-        {
-        case SCOPE_DOT:
-            for (int x = 0; x < 75; x ++)
-            {
-                int h = aud::clamp ((int) m_data[x], 0, 15);
-                RGB_SEEK (x, h);
-                RGB_SET_INDEX (vis_scope_colors[h]);
-            }
-            break;
-        case SCOPE_LINE:
-        {
-            for (int x = 0; x < 74; x ++)
-            {
-                int h = aud::clamp ((int) m_data[x], 0, 15);
-                int h2 = aud::clamp ((int) m_data[x + 1], 0, 15);
+        int h = aud::clamp ((int) m_data[x], 0, 15);
+        if (config.scope_mode != SCOPE_LINE || x == 74)
+            return 1 + h;
 
-                if (h < h2)
-                    h2 --;
-                else if (h > h2)
-                {
-                    int temp = h;
-                    h = h2 + 1;
-                    h2 = temp;
-                }
+        int h2 = aud::clamp ((int) m_data[x + 1], 0, 15);
+        return 1 + h + 16 * h2;
+    }
+    default:
+        return 0;
+    }
+}
 
-                RGB_SEEK (x, h);
+void SkinnedVis::draw_column (int x, int key)
+{
+    uint32_t * set = m_rgb + x;
 
-                for (int y = h; y <= h2; y ++)
-                    RGB_SET_INDEX_Y (vis_scope_colors[y]);
-            }
+    for (int y = 0; y < 16; y ++)
+        RGB_SET_Y (m_pattern_fill[76 * (y & 1) + x]);
 
-            int h = aud::clamp ((int) m_data[74], 0, 15);
-            RGB_SEEK (74, h);
-            RGB_SET_INDEX (vis_scope_colors[h]);
-            break;
+    if (! key)
+        return;
+
+    if (config.vis_type == VIS_ANALYZER)
+    {
+        int h = (key - 1) % 17;
+        int peak = (key - 1) / 17;
+
+        RGB_SEEK (x, 16 - h);
+        for (int y = 0; y < h; y ++)
+            RGB_SET_Y (m_bar_colors[h][y]);
+
+        if (peak)
+        {
+            RGB_SEEK (x, 16 - peak);
+            RGB_SET (m_peak_color);
         }
-        default: /* SCOPE_SOLID */
-            for (int x = 0; x < 75; x ++)
-            {
-                int h = aud::clamp ((int) m_data[x], 0, 15);
-                int h2;
 
-                if (h < 8)
-                    h2 = 8;
-                else
-                {
-                    h2 = h;
-                    h = 8;
-                }
+        return;
+    }
 
-                RGB_SEEK (x, h);
+    int h = aud::clamp ((int) m_data[x], 0, 15);
+    int h2;
 
-                for (int y = h; y <= h2; y ++)
-                    RGB_SET_INDEX_Y (vis_scope_colors[y]);
-            }
+    switch (config.scope_mode)
+    {
+    case SCOPE_DOT:
+        h2 = h;
+        break;
+    case SCOPE_LINE:
+        if (x == 74)
+        {
+            h2 = h;
             break;
         }
+
+        h2 = aud::clamp ((int) m_data[x + 1], 0, 15);
+
+        if (h < h2)
+            h2 --;
+        else if (h > h2)
+        {
+            int temp = h;
+            h = h2 + 1;
+            h2 = temp;
+        }
+        break;
+    default: /* SCOPE_SOLID */
+        if (h < 8)
+            h2 = 8;
+        else
+        {
+            h2 = h;
+            h = 8;
+        }
         break;
     }
 
-DRAW:
-    cairo_surface_t * surf = cairo_image_surface_create_for_data
-     ((unsigned char *) rgb, CAIRO_FORMAT_RGB24, 76, 16, 4 * 76);
-    cairo_set_source_surface (cr, surf, 0, 0);
+    RGB_SEEK (x, h);
+
+    for (int y = h; y <= h2; y ++)
+        RGB_SET_Y (m_scope_colors[y]);
+}
+
+/* copies columns <x1> through <x2> into the scaled backing surface */
+void SkinnedVis::upload (int x1, int x2)
+{
+    int scale = config.scale;
+
+    cairo_surface_flush (m_surface);
+
+    unsigned char * data = cairo_image_surface_get_data (m_surface);
+    int stride = cairo_image_surface_get_stride (m_surface);
+
+    for (int y = 0; y < 16 * scale; y ++)
+    {
+        auto row = (uint32_t *) (data + stride * y);
+        const uint32_t * src = m_rgb + 76 * (y / scale);
+
+        for (int x = x1 * scale; x < (x2 + 1) * scale; x ++)
+            row[x] = src[x / scale];
+    }
+
+    cairo_surface_mark_dirty_rectangle (m_surface, x1 * scale, 0,
+     (x2 + 1 - x1) * scale, 16 * scale);
+}
+
+void SkinnedVis::draw (cairo_t * cr)
+{
+    int scale = config.scale;
+    int mode = config.vis_type | (config.analyzer_mode << 4) |
+     (config.analyzer_type << 8) | (config.analyzer_peaks << 12) |
+     (config.scope_mode << 16) | (config.voiceprint_mode << 20);
+
+    if (mode != m_mode)
+    {
+        m_mode = mode;
+        update_palette ();
+        invalidate ();
+    }
+
+    int x1 = 76, x2 = -1;
+
+    if (! m_surface || m_surface_scale != scale)
+    {
+        if (m_surface)
+            cairo_surface_destroy (m_surface);
+
+        m_surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, 76 * scale, 16 * scale);
+        m_surface_scale = scale;
+        x1 = 0;
+        x2 = 75;
+    }
+
+    if (config.vis_type == VIS_VOICEPRINT)
+    {
+        if (m_voiceprint_dirty)
+        {
+            const unsigned char * get = m_voiceprint_data;
+            uint32_t * colors = (config.voiceprint_mode == VOICEPRINT_NORMAL) ?
+             m_voice_color : (config.voiceprint_mode == VOICEPRINT_FIRE) ?
+             m_voice_color_fire : /* VOICEPRINT_ICE */ m_voice_color_ice;
+            uint32_t * set = m_rgb;
+
+            for (int y = 0; y < 16; y ++)
+            for (int x = 0; x < 76; x ++)
+                RGB_SET (colors[* get ++]);
+
+            m_voiceprint_dirty = false;
+            x1 = 0;
+            x2 = 75;
+        }
+    }
+    else
+    {
+        /* the analyzer and scope usually change only some columns */
+        for (int x = 0; x < 76; x ++)
+        {
+            int key = column_key (x);
+            if (key == m_column_keys[x])
+                continue;
+
+            draw_column (x, key);
+            m_column_keys[x] = key;
+
+            x1 = aud::min (x1, x);
+            x2 = aud::max (x2, x);
+        }
+    }
+
+    if (x1 <= x2)
+        upload (x1, x2);
+
+    /* the backing surface is already scaled */
+    cairo_save (cr);
+    cairo_scale (cr, 1.0 / scale, 1.0 / scale);
+    cairo_set_source_surface (cr, m_surface, 0, 0);
     cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_NEAREST);
     cairo_paint (cr);
-    cairo_surface_destroy (surf);
+    cairo_restore (cr);
 }
 
 SkinnedVis::SkinnedVis ()
@@ -244,16 +336,22 @@ SkinnedVis::SkinnedVis ()
     clear ();
 }
 
+SkinnedVis::~SkinnedVis ()
+{
+    if (m_surface)
+        cairo_surface_destroy (m_surface);
+}
+
 void SkinnedVis::clear ()
 {
     m_active = false;
-    m_voiceprint_advance = false;
 
     memset (m_data, 0, sizeof m_data);
     memset (m_peak, 0, sizeof m_peak);
     memset (m_peak_speed, 0, sizeof m_peak_speed);
     memset (m_voiceprint_data, 0, sizeof m_voiceprint_data);
 
+    invalidate ();
     queue_draw ();
 }
 
@@ -306,10 +404,14 @@ void SkinnedVis::render (const unsigned char * data)
     }
     else if (config.vis_type == VIS_VOICEPRINT)
     {
-        for (int i = 0; i < 16; i ++)
-            m_data[i] = data[15 - i];
+        /* advance here rather than in draw(), which may run less often */
+        memmove (m_voiceprint_data, m_voiceprint_data + 1, sizeof
+         m_voiceprint_data - 1);
 
-        m_voiceprint_advance = true;
+        for (int y = 0; y < 16; y ++)
+            m_voiceprint_data[76 * y + 75] = data[15 - y];
+
+        m_voiceprint_dirty = true;
     }
     else
     {
@@ -318,5 +420,7 @@ void SkinnedVis::render (const unsigned char * data)
     }
 
     m_active = true;
-    draw_now ();
+
+    /* coalesced by GTK into the next frame rather than drawn per callback */
+    queue_draw ();
 }
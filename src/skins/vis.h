@@ -56,6 +56,7 @@ class SkinnedVis : public Widget
 {
 public:
     SkinnedVis ();
+    ~SkinnedVis ();
     void set_colors ();
     void clear ();
     void render (const unsigned char * data);
@@ -63,14 +64,31 @@ public:
 private:
     void draw (cairo_t * cr);
 
+    void update_palette ();
+    void invalidate ();
+    int column_key (int x) const;
+    void draw_column (int x, int key);
+    void upload (int x1, int x2);
+
     uint32_t m_voice_color[256];
     uint32_t m_voice_color_fire[256];
     uint32_t m_voice_color_ice[256];
     uint32_t m_pattern_fill[76 * 2];
+    uint32_t m_bar_colors[17][16];
+    uint32_t m_scope_colors[16];
+    uint32_t m_peak_color;
 
-    bool m_active, m_voiceprint_advance;
+    bool m_active, m_voiceprint_dirty;
     float m_data[75], m_peak[75], m_peak_speed[75];
     unsigned char m_voiceprint_data[76 * 16];
+
+    /* current frame, kept between draws */
+    uint32_t m_rgb[76 * 16];
+    int m_column_keys[76];
+    int m_mode = -1;
+
+    cairo_surface_t * m_surface = nullptr;
+    int m_surface_scale = 0;
 };
 
 class SmallVis : public Widget
@@ -19,6 +19,7 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <sndfile.h>
 
@@ -312,6 +313,92 @@ bool SndfilePlugin::read_tag (const char * filename, VFSFile & file, Tuple & tup
     return true;
 }
 
+/* How the samples are read and what format they are passed on in */
+enum class ReadMode {
+    Raw,    /* file data as is, with sf_read_raw() */
+    Short,  /* sf_readf_short() */
+    Int,    /* sf_readf_int() */
+    Float   /* sf_readf_float() */
+};
+
+struct PlayFormat {
+    ReadMode mode;
+    int format;
+    int sample_size;
+};
+
+/* Integer PCM is passed on in its own format instead of being converted to
+ * floating point.  In plain PCM containers, the data is read unchanged and
+ * the output plugin or the core does any byte swapping. */
+static PlayFormat get_play_format (SNDFILE * sndfile, const SF_INFO & sfinfo)
+{
+    bool raw_container = false;
+
+    switch (sfinfo.format & SF_FORMAT_TYPEMASK)
+    {
+        case SF_FORMAT_WAV:
+        case SF_FORMAT_WAVEX:
+        case SF_FORMAT_W64:
+        case SF_FORMAT_RF64:
+        case SF_FORMAT_AIFF:
+        case SF_FORMAT_CAF:
+        case SF_FORMAT_AU:
+        case SF_FORMAT_RAW:
+            raw_container = true;
+            break;
+    }
+
+    if (raw_container)
+    {
+        const uint16_t one = 1;
+        bool host_le = * (const uint8_t *) & one;
+        bool swap = sf_command (sndfile, SFC_RAW_DATA_NEEDS_ENDSWAP, nullptr, 0);
+        bool le = (host_le != swap);
+
+        switch (sfinfo.format & SF_FORMAT_SUBMASK)
+        {
+            case SF_FORMAT_PCM_S8:
+                return {ReadMode::Raw, FMT_S8, 1};
+            case SF_FORMAT_PCM_U8:
+                return {ReadMode::Raw, FMT_U8, 1};
+            case SF_FORMAT_PCM_16:
+                return {ReadMode::Raw, le ? FMT_S16_LE : FMT_S16_BE, 2};
+            case SF_FORMAT_PCM_24:
+                return {ReadMode::Raw, le ? FMT_S24_3LE : FMT_S24_3BE, 3};
+            case SF_FORMAT_PCM_32:
+                return {ReadMode::Raw, le ? FMT_S32_LE : FMT_S32_BE, 4};
+        }
+    }
+
+    switch (sfinfo.format & SF_FORMAT_SUBMASK)
+    {
+        case SF_FORMAT_PCM_S8:
+        case SF_FORMAT_PCM_U8:
+        case SF_FORMAT_PCM_16:
+            return {ReadMode::Short, FMT_S16_NE, 2};
+
+        /* libsndfile scales these to the full 32-bit range */
+        case SF_FORMAT_PCM_24:
+        case SF_FORMAT_PCM_32:
+            return {ReadMode::Int, FMT_S32_NE, 4};
+
+        default:
+            return {ReadMode::Float, FMT_FLOAT, 4};
+    }
+}
+
+/* Reads about 256 KiB at a time, which is between 100 and 500 ms of audio.
+ * Fewer, larger reads keep the per-call overhead down for files with many
+ * channels or high sample rates. */
+static int block_frames (const SF_INFO & sfinfo, int sample_size)
+{
+    int64_t bytes_per_sec = (int64_t) sfinfo.samplerate * sfinfo.channels * sample_size;
+    int64_t ms = aud::clamp<int64_t> (256 * 1024 * 1000 / aud::max<int64_t> (bytes_per_sec, 1),
+     100, 500);
+
+    return aud::max<int64_t> (sfinfo.samplerate * ms / 1000, 1);
+}
+
 bool SndfilePlugin::play (const char * filename, VFSFile & file)
 {
     SF_INFO sfinfo {}; // must be zeroed before sf_open()
@@ -323,10 +410,14 @@ bool SndfilePlugin::play (const char * filename, VFSFile & file)
     if (sndfile == nullptr)
         return false;
 
-    open_audio (FMT_FLOAT, sfinfo.samplerate, sfinfo.channels);
+    PlayFormat pf = get_play_format (sndfile, sfinfo);
+    int frame_size = sfinfo.channels * pf.sample_size;
+    int block = block_frames (sfinfo, pf.sample_size);
 
-    Index<float> buffer;
-    buffer.resize (sfinfo.channels * (sfinfo.samplerate / 50));
+    open_audio (pf.format, sfinfo.samplerate, sfinfo.channels);
+
+    Index<char> buffer;
+    buffer.resize (block * frame_size);
 
     while (! check_stop ())
     {
@@ -337,11 +428,28 @@ bool SndfilePlugin::play (const char * filename, VFSFile & file)
             sf_seek (sndfile, aud::min (frames, (int64_t) sfinfo.frames), SEEK_SET);
         }
 
-        int samples = sf_read_float (sndfile, buffer.begin (), buffer.len ());
-        if (! samples)
+        sf_count_t got = 0;
+
+        switch (pf.mode)
+        {
+            case ReadMode::Raw:
+                got = sf_read_raw (sndfile, buffer.begin (), buffer.len ()) / frame_size;
+                break;
+            case ReadMode::Short:
+                got = sf_readf_short (sndfile, (short *) buffer.begin (), block);
+                break;
+            case ReadMode::Int:
+                got = sf_readf_int (sndfile, (int *) buffer.begin (), block);
+                break;
+            case ReadMode::Float:
+                got = sf_readf_float (sndfile, (float *) buffer.begin (), block);
+                break;
+        }
+
+        if (got <= 0)
             break;
 
-        write_audio (buffer.begin (), sizeof (float) * samples);
+        write_audio (buffer.begin (), got * frame_size);
     }
 
     sf_close (sndfile);
@@ -0,0 +1,555 @@
+/*
+ * skin-files.cc
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+/* This file is compiled as part of each skinned interface, after its own
+ * skins_util.h, which provides find_file_case_path(), file_is_archive(),
+ * archive_decompress(), del_directory(), and make_directory(). */
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/runtime.h>
+
+#include "skin-files.h"
+
+#define ZIP_LOCAL_HEADER 0x04034b50
+#define ZIP_CENTRAL_HEADER 0x02014b50
+#define ZIP_END_HEADER 0x06054b50
+
+static constexpr int ZIP_MAX_ENTRY_SIZE = 64 << 20;
+static constexpr int SKIN_MAX_THREADS = 8;
+static constexpr int SKIN_CACHE_MAX = 32;
+
+static const char skin_cache_magic[8] = {'A', 'U', 'D', 'S', 'K', 'N', 'C', '1'};
+
+static unsigned get16 (const char * p)
+{
+    return (unsigned char) p[0] | ((unsigned char) p[1] << 8);
+}
+
+static uint32_t get32 (const char * p)
+{
+    return get16 (p) | ((uint32_t) get16 (p + 2) << 16);
+}
+
+bool SkinFiles::open (const char * path)
+{
+    close ();
+
+    if (g_file_test (path, G_FILE_TEST_IS_DIR))
+    {
+        m_dir = String (path);
+        return true;
+    }
+
+    if (str_has_suffix_nocase (path, ".wsz") || str_has_suffix_nocase (path, ".zip"))
+    {
+        if (open_zip (path))
+            return true;
+
+        AUDDBG ("Falling back to extracting %s\n", path);
+        close ();
+    }
+
+    if (! file_is_archive (path))
+        return false;
+
+    StringBuf tmpdir = archive_decompress (path);
+    if (! tmpdir)
+    {
+        AUDDBG ("Unable to extract skin archive (%s)\n", path);
+        return false;
+    }
+
+    m_dir = m_tmpdir = String (tmpdir);
+    return true;
+}
+
+void SkinFiles::close ()
+{
+    if (m_tmpdir)
+        del_directory (m_tmpdir);
+
+    m_dir = String ();
+    m_tmpdir = String ();
+    m_zip.clear ();
+    m_entries.clear ();
+}
+
+/* Reads the central directory of a ZIP archive.  Only the "stored" and
+ * "deflate" methods are supported, which covers practically all skins;
+ * anything else (e.g. ZIP64) makes the caller fall back to unzip. */
+bool SkinFiles::open_zip (const char * path)
+{
+    VFSFile file (path, "r");
+    if (! file)
+        return false;
+
+    m_zip = file.read_all ();
+
+    const char * data = m_zip.begin ();
+    int len = m_zip.len ();
+
+    /* the end record may be followed by a comment of up to 64 KiB */
+    int end = -1;
+    for (int i = len - 22; i >= 0 && i >= len - 22 - 65535; i --)
+    {
+        if (get32 (data + i) == ZIP_END_HEADER)
+        {
+            end = i;
+            break;
+        }
+    }
+
+    if (end < 0)
+        return false;
+
+    int count = get16 (data + end + 10);
+    int64_t pos = get32 (data + end + 16);
+
+    for (int i = 0; i < count; i ++)
+    {
+        if (pos + 46 > len || get32 (data + pos) != ZIP_CENTRAL_HEADER)
+            return false;
+
+        int flags = get16 (data + pos + 8);
+        int method = get16 (data + pos + 10);
+        int64_t packed_size = get32 (data + pos + 20);
+        int64_t size = get32 (data + pos + 24);
+        int name_len = get16 (data + pos + 28);
+        int64_t local = get32 (data + pos + 42);
+
+        if (pos + 46 + name_len > len)
+            return false;
+
+        StringBuf name = str_copy (data + pos + 46, name_len);
+        pos += 46 + name_len + get16 (data + pos + 30) + get16 (data + pos + 32);
+
+        if (local + 30 > len || get32 (data + local) != ZIP_LOCAL_HEADER)
+            return false;
+
+        int64_t offset = local + 30 + get16 (data + local + 26) + get16 (data + local + 28);
+        if (offset + packed_size > len || size > ZIP_MAX_ENTRY_SIZE)
+            return false;
+
+        /* skip encrypted entries */
+        if (flags & 1)
+            continue;
+
+        /* like "unzip -j", ignore any directory structure within the archive */
+        const char * base = name;
+        for (const char * c = name; * c; c ++)
+        {
+            if (* c == '/' || * c == '\\')
+                base = c + 1;
+        }
+
+        if (* base)
+            m_entries.append (ZipEntry {String (base), method, offset, packed_size, size});
+    }
+
+    AUDDBG ("Read %d entries from %s\n", m_entries.len (), path);
+    return true;
+}
+
+const SkinFiles::ZipEntry * SkinFiles::find_zip_entry (const char * name) const
+{
+    for (const ZipEntry & entry : m_entries)
+    {
+        if (! strcmp_nocase (entry.name, name))
+            return & entry;
+    }
+
+    return nullptr;
+}
+
+Index<char> SkinFiles::read_zip_entry (const ZipEntry & entry) const
+{
+    Index<char> buf;
+    const char * src = m_zip.begin () + entry.offset;
+
+    if (entry.method == 0)
+    {
+        buf.insert (src, 0, entry.packed_size);
+        return buf;
+    }
+
+    if (entry.method != Z_DEFLATED)
+    {
+        AUDWARN ("Unsupported compression method %d (%s)\n", entry.method,
+         (const char *) entry.name);
+        return buf;
+    }
+
+    buf.insert (0, entry.size);
+
+    z_stream stream {};
+    if (inflateInit2 (& stream, -MAX_WBITS) != Z_OK)
+        return Index<char> ();
+
+    stream.next_in = (Bytef *) src;
+    stream.avail_in = entry.packed_size;
+    stream.next_out = (Bytef *) buf.begin ();
+    stream.avail_out = entry.size;
+
+    int ret = inflate (& stream, Z_FINISH);
+    inflateEnd (& stream);
+
+    if (ret != Z_STREAM_END || (int64_t) stream.total_out != entry.size)
+    {
+        AUDWARN ("Error decompressing %s\n", (const char *) entry.name);
+        buf.clear ();
+    }
+
+    return buf;
+}
+
+bool SkinFiles::contains (const char * name) const
+{
+    if (m_dir)
+        return (bool) find_file_case_path (m_dir, name);
+
+    return find_zip_entry (name) != nullptr;
+}
+
+Index<char> SkinFiles::read (const char * name) const
+{
+    if (m_dir)
+    {
+        StringBuf path = find_file_case_path (m_dir, name);
+        return path ? VFSFile (path, "r").read_all () : Index<char> ();
+    }
+
+    const ZipEntry * entry = find_zip_entry (name);
+    return entry ? read_zip_entry (* entry) : Index<char> ();
+}
+
+Index<char> SkinFiles::read_pixmap (const char * basename, const char * altname) const
+{
+    static const char * const exts[] = {".bmp", ".png", ".xpm"};
+
+    for (const char * ext : exts)
+    {
+        StringBuf name = str_concat ({basename, ext});
+        if (contains (name))
+            return read (name);
+    }
+
+    return altname ? read_pixmap (altname) : Index<char> ();
+}
+
+VFSFile SkinFiles::open_file (const char * name) const
+{
+    if (m_dir)
+    {
+        StringBuf path = find_file_case_path (m_dir, name);
+        return path ? VFSFile (path, "r") : VFSFile ();
+    }
+
+    const ZipEntry * entry = find_zip_entry (name);
+    if (! entry)
+        return VFSFile ();
+
+    /* text files are small; hand them to the parser through a temporary
+     * file rather than extracting the whole archive */
+    Index<char> data = read_zip_entry (* entry);
+    VFSFile file = VFSFile::tmpfile ();
+
+    if (! file || file.fwrite (data.begin (), 1, data.len ()) != data.len () ||
+     file.fseek (0, VFS_SEEK_SET) < 0)
+        return VFSFile ();
+
+    return file;
+}
+
+struct ParallelWork {
+    SkinWorkFunc func;
+    void * user;
+    int count, next;
+    pthread_mutex_t mutex;
+};
+
+static void * parallel_worker (void * data)
+{
+    auto work = (ParallelWork *) data;
+
+    while (1)
+    {
+        pthread_mutex_lock (& work->mutex);
+        int i = work->next ++;
+        pthread_mutex_unlock (& work->mutex);
+
+        if (i >= work->count)
+            break;
+
+        work->func (i, work->user);
+    }
+
+    return nullptr;
+}
+
+void skin_run_parallel (int count, SkinWorkFunc func, void * user)
+{
+    ParallelWork work = {func, user, count, 0, PTHREAD_MUTEX_INITIALIZER};
+
+    int n_threads = aud::min (aud::clamp ((int) g_get_num_processors (), 1,
+     SKIN_MAX_THREADS), count);
+
+    /* the calling thread does its share of the work too */
+    Index<pthread_t> threads;
+    for (int i = 1; i < n_threads; i ++)
+    {
+        pthread_t thread;
+        if (! pthread_create (& thread, nullptr, parallel_worker, & work))
+            threads.append (thread);
+    }
+
+    parallel_worker (& work);
+
+    for (pthread_t thread : threads)
+        pthread_join (thread, nullptr);
+
+    pthread_mutex_destroy (& work.mutex);
+}
+
+/* for a directory, the newest of its files counts */
+static int64_t skin_mtime (const char * path)
+{
+    GStatBuf st;
+    if (g_stat (path, & st) < 0)
+        return -1;
+
+    int64_t mtime = st.st_mtime;
+
+    if (S_ISDIR (st.st_mode))
+    {
+        GDir * dir = g_dir_open (path, 0, nullptr);
+        if (! dir)
+            return mtime;
+
+        const char * name;
+        while ((name = g_dir_read_name (dir)))
+        {
+            if (g_stat (filename_build ({path, name}), & st) == 0)
+                mtime = aud::max (mtime, (int64_t) st.st_mtime);
+        }
+
+        g_dir_close (dir);
+    }
+
+    return mtime;
+}
+
+static StringBuf skin_cache_dir ()
+{
+    return filename_build ({g_get_user_cache_dir (), "audacious", "skin-cache"});
+}
+
+static StringBuf skin_cache_file (const char * path)
+{
+    return filename_build ({skin_cache_dir (), str_printf ("%08x.pixmaps", str_calc_hash (path))});
+}
+
+/* removes the least recently written entries beyond SKIN_CACHE_MAX */
+static void skin_cache_prune ()
+{
+    struct CacheFile {
+        String path;
+        int64_t mtime;
+    };
+
+    StringBuf dirname = skin_cache_dir ();
+    GDir * dir = g_dir_open (dirname, 0, nullptr);
+    if (! dir)
+        return;
+
+    Index<CacheFile> files;
+    const char * name;
+
+    while ((name = g_dir_read_name (dir)))
+    {
+        StringBuf path = filename_build ({dirname, name});
+        GStatBuf st;
+
+        if (str_has_suffix_nocase (name, ".pixmaps") && g_stat (path, & st) == 0)
+            files.append (CacheFile {String (path), (int64_t) st.st_mtime});
+    }
+
+    g_dir_close (dir);
+
+    if (files.len () <= SKIN_CACHE_MAX)
+        return;
+
+    files.sort ([] (const CacheFile & a, const CacheFile & b)
+        { return (a.mtime > b.mtime) - (a.mtime < b.mtime); });
+
+    for (int i = 0; i < files.len () - SKIN_CACHE_MAX; i ++)
+        g_unlink (files[i].path);
+}
+
+/*
+ * Cache file layout (native byte order, since the cache is never shared
+ * between machines):
+ *
+ *   char magic[8], int64 mtime, int32 path length, char path[],
+ *   int32 count, then for each pixmap: int32 width, int32 height,
+ *   uint32 pixels[width * height]
+ */
+
+class CacheReader
+{
+public:
+    CacheReader (const Index<char> & data) : m_data (data) {}
+
+    bool get (void * out, int64_t len)
+    {
+        if (len < 0 || m_pos + len > m_data.len ())
+            return false;
+
+        memcpy (out, m_data.begin () + m_pos, len);
+        m_pos += len;
+        return true;
+    }
+
+    template<class T>
+    bool get (T & out)
+        { return get (& out, sizeof out); }
+
+private:
+    const Index<char> & m_data;
+    int64_t m_pos = 0;
+};
+
+bool skin_cache_load (const char * path, Index<SkinCachedPixmap> & pixmaps)
+{
+    int64_t mtime = skin_mtime (path);
+    if (mtime < 0)
+        return false;
+
+    StringBuf filename = skin_cache_file (path);
+    if (! g_file_test (filename, G_FILE_TEST_EXISTS))
+        return false;
+
+    Index<char> data = VFSFile (filename, "r").read_all ();
+    CacheReader reader (data);
+
+    char magic[sizeof skin_cache_magic];
+    int64_t cached_mtime;
+    int32_t path_len, count;
+
+    if (! reader.get (magic) || memcmp (magic, skin_cache_magic, sizeof magic) ||
+     ! reader.get (cached_mtime) || cached_mtime != mtime ||
+     ! reader.get (path_len) || path_len != (int32_t) strlen (path))
+        return false;
+
+    StringBuf cached_path (path_len);
+    if (! reader.get (cached_path, path_len) || strcmp (cached_path, path) ||
+     ! reader.get (count) || count < 0)
+        return false;
+
+    Index<SkinCachedPixmap> loaded;
+
+    for (int i = 0; i < count; i ++)
+    {
+        int32_t width, height;
+        if (! reader.get (width) || ! reader.get (height) || width < 0 || height < 0 ||
+         (int64_t) width * height > ZIP_MAX_ENTRY_SIZE)
+            return false;
+
+        auto & pixmap = loaded.append ();
+        pixmap.width = width;
+        pixmap.height = height;
+        pixmap.pixels.insert (0, width * height);
+
+        if (! reader.get (pixmap.pixels.begin (), (int64_t) width * height * 4))
+            return false;
+    }
+
+    AUDDBG ("Loaded %d cached pixmaps for %s\n", count, path);
+    pixmaps = std::move (loaded);
+    return true;
+}
+
+void skin_cache_save (const char * path, const Index<SkinCachedPixmap> & pixmaps)
+{
+    int64_t mtime = skin_mtime (path);
+    if (mtime < 0)
+        return;
+
+    Index<char> data;
+    auto put = [& data] (const void * ptr, int64_t len)
+        { data.insert ((const char *) ptr, -1, len); };
+
+    int32_t path_len = strlen (path);
+    int32_t count = pixmaps.len ();
+
+    put (skin_cache_magic, sizeof skin_cache_magic);
+    put (& mtime, sizeof mtime);
+    put (& path_len, sizeof path_len);
+    put (path, path_len);
+    put (& count, sizeof count);
+
+    for (const SkinCachedPixmap & pixmap : pixmaps)
+    {
+        int32_t size[2] = {pixmap.width, pixmap.height};
+        put (size, sizeof size);
+        put (pixmap.pixels.begin (), (int64_t) pixmap.pixels.len () * 4);
+    }
+
+    make_directory (skin_cache_dir ());
+
+    /* write under a temporary name so that a partial file is never read */
+    StringBuf filename = skin_cache_file (path);
+    StringBuf temp = str_concat ({filename, ".tmp"});
+
+    VFSFile file (temp, "w");
+    if (! file || file.fwrite (data.begin (), 1, data.len ()) != data.len () ||
+     file.fflush () < 0)
+    {
+        AUDWARN ("Error writing %s\n", (const char *) temp);
+        return;
+    }
+
+    file = VFSFile ();
+
+    if (g_rename (temp, filename) < 0)
+    {
+        AUDWARN ("Error renaming %s\n", (const char *) temp);
+        g_unlink (temp);
+        return;
+    }
+
+    skin_cache_prune ();
+}
+
+bool skin_cache_is_fresh (const char * generated, const char * path)
+{
+    GStatBuf st;
+    if (g_stat (generated, & st) < 0)
+        return false;
+
+    int64_t mtime = skin_mtime (path);
+    return mtime >= 0 && (int64_t) st.st_mtime >= mtime;
+}
@@ -0,0 +1,93 @@
+/*
+ * skin-files.h
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef UI_COMMON_SKIN_FILES_H
+#define UI_COMMON_SKIN_FILES_H
+
+#include <stdint.h>
+
+#include <libaudcore/index.h>
+#include <libaudcore/objects.h>
+#include <libaudcore/vfs.h>
+
+/* Gives access to the files of a skin, whether it is a plain directory or an
+ * archive.  ZIP archives (including .wsz) are read into memory; other archive
+ * types are still extracted to a temporary directory.  File names are matched
+ * case-insensitively.  The read functions may be called from several threads
+ * at once. */
+class SkinFiles
+{
+public:
+    SkinFiles () {}
+    ~SkinFiles () { close (); }
+
+    SkinFiles (const SkinFiles &) = delete;
+    void operator= (const SkinFiles &) = delete;
+
+    bool open (const char * path);
+    void close ();
+
+    bool contains (const char * name) const;
+    Index<char> read (const char * name) const;
+
+    /* reads <basename>.bmp, .png, or .xpm, falling back to <altname> */
+    Index<char> read_pixmap (const char * basename, const char * altname = nullptr) const;
+
+    /* for parsers that need a VFSFile; returns a null file if not found */
+    VFSFile open_file (const char * name) const;
+
+private:
+    struct ZipEntry {
+        String name;
+        int method;
+        int64_t offset, packed_size, size;
+    };
+
+    bool open_zip (const char * path);
+    const ZipEntry * find_zip_entry (const char * name) const;
+    Index<char> read_zip_entry (const ZipEntry & entry) const;
+
+    String m_dir, m_tmpdir;
+    Index<char> m_zip;
+    Index<ZipEntry> m_entries;
+};
+
+/* Runs func (i, user) for each i in [0, count) on a pool of worker threads and
+ * returns once all calls have finished. */
+typedef void (* SkinWorkFunc) (int i, void * user);
+void skin_run_parallel (int count, SkinWorkFunc func, void * user);
+
+/* A decoded pixmap in native-endian 0xxxRRGGBB format, as used by both cairo
+ * (CAIRO_FORMAT_RGB24) and Qt (QImage::Format_RGB32).  A missing pixmap has
+ * zero size. */
+struct SkinCachedPixmap {
+    int width, height;
+    Index<uint32_t> pixels;
+};
+
+/* Persistent cache of decoded skin pixmaps, shared by the GTK and Qt skinned
+ * interfaces.  Entries are keyed on the skin's path and modification time. */
+bool skin_cache_load (const char * path, Index<SkinCachedPixmap> & pixmaps);
+void skin_cache_save (const char * path, const Index<SkinCachedPixmap> & pixmaps);
+
+/* checks whether a file generated from the skin at <path> (e.g. a preview
+ * thumbnail) is at least as new as the skin itself */
+bool skin_cache_is_fresh (const char * generated, const char * path);
+
+#endif // UI_COMMON_SKIN_FILES_H
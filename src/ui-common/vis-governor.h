@@ -0,0 +1,104 @@
+/*
+ * vis-governor.h
+ * Copyright 2026 Audacious developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef UI_COMMON_VIS_GOVERNOR_H
+#define UI_COMMON_VIS_GOVERNOR_H
+
+#include <chrono>
+
+#include <libaudcore/runtime.h>
+
+// Paces a visualization plugin to its display rather than to the rate at
+// which the core delivers frames.  Frames are skipped entirely while the
+// widget is hidden.  Otherwise every frame updates the plugin's state (bar
+// falloff, history, fade), since those advance per frame, and requests a
+// redraw; the toolkit coalesces redraw requests, so painting follows the
+// display refresh.  The frame counts and the time spent are reported
+// periodically at debug level.
+class VisGovernor
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    VisGovernor(const char * name) : m_name(name) {}
+
+    // called when the core delivers a frame; false if it should be skipped
+    bool accept_frame(bool visible)
+    {
+        if (!visible)
+        {
+            m_skipped++;
+            return false;
+        }
+
+        m_frames++;
+        return true;
+    }
+
+    // called each time the widget paints
+    void frame_painted()
+    {
+        m_painted++;
+        report();
+    }
+
+    // accumulates the time spent between construction and destruction
+    class Cost
+    {
+    public:
+        Cost(VisGovernor & governor)
+            : m_governor(governor), m_start(Clock::now())
+        {
+        }
+
+        ~Cost() { m_governor.m_cost += Clock::now() - m_start; }
+
+    private:
+        VisGovernor & m_governor;
+        Clock::time_point m_start;
+    };
+
+private:
+    void report()
+    {
+        auto now = Clock::now();
+
+        if (m_report_time == Clock::time_point())
+            m_report_time = now;
+        else if (now - m_report_time >= std::chrono::seconds(10))
+        {
+            double ms = std::chrono::duration<double, std::milli>(m_cost).count();
+
+            AUDDBG("%s: %d frames, %d painted, %d skipped while hidden, "
+                   "vis cost %.3f ms/paint\n", m_name, m_frames, m_painted,
+                   m_skipped, m_painted ? ms / m_painted : 0.0);
+
+            m_report_time = now;
+            m_frames = m_painted = m_skipped = 0;
+            m_cost = Clock::duration::zero();
+        }
+    }
+
+    const char * m_name;
+    Clock::time_point m_report_time;
+    Clock::duration m_cost = Clock::duration::zero();
+    int m_frames = 0, m_painted = 0, m_skipped = 0;
+};
+
+#endif // UI_COMMON_VIS_GOVERNOR_H
@@ -30,6 +30,8 @@
 #include <string.h>
 #include <math.h>
 
+#include <chrono>
+
 #include <ogg/ogg.h>
 #include <vorbis/codec.h>
 #include <vorbis/vorbisfile.h>
@@ -227,17 +229,34 @@ static bool update_replay_gain (OggVorbis_File * vf, ReplayGainInfo * rg_info)
 static long
 vorbis_interleave_buffer(float **pcm, int samples, int ch, float *pcmout)
 {
-    int i, j;
-    for (i = 0; i < samples; i++)
-        for (j = 0; j < ch; j++)
-            *pcmout++ = pcm[j][i];
+    if (ch == 2)
+    {
+        const float * left = pcm[0];
+        const float * right = pcm[1];
+
+        for (int i = 0; i < samples; i++)
+        {
+            pcmout[2 * i] = left[i];
+            pcmout[2 * i + 1] = right[i];
+        }
+    }
+    else
+    {
+        for (int j = 0; j < ch; j++)
+        {
+            const float * in = pcm[j];
+
+            for (int i = 0; i < samples; i++)
+                pcmout[i * ch + j] = in[i];
+        }
+    }
 
     return ch * samples * sizeof(float);
 }
 
 
-#define PCM_FRAMES 1024
-#define PCM_BUFSIZE (PCM_FRAMES * 2)
+/* ov_read_float() returns at most half of the largest block size (8192) */
+#define PCM_FRAMES 4096
 
 bool VorbisPlugin::play (const char * filename, VFSFile & file)
 {
@@ -246,9 +265,13 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
     int last_section = -1;
     Tuple tuple = get_playback_tuple ();
     ReplayGainInfo rg_info;
-    float pcmout[PCM_BUFSIZE*sizeof(float)], **pcm;
+    Index<float> pcmout;
+    float **pcm;
     int bytes, channels, samplerate, br;
 
+    auto decode_time = std::chrono::steady_clock::duration::zero();
+    int64_t decoded = 0;
+
     memset(&vf, 0, sizeof(vf));
 
     bool stream = (file.fsize () < 0);
@@ -277,6 +300,9 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
 
     open_audio (FMT_FLOAT, samplerate, channels);
 
+    /* grows only if a later link has more channels */
+    pcmout.resize (PCM_FRAMES * channels);
+
     /*
      * Note that chaining changes things here; A vorbis file may
      * be a mix of different channels, bitrates and sample rates.
@@ -296,15 +322,15 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
         }
 
         int current_section = last_section;
+        auto start = std::chrono::steady_clock::now ();
         bytes = ov_read_float(&vf, &pcm, PCM_FRAMES, &current_section);
+
         if (bytes == OV_HOLE)
             continue;
 
         if (bytes <= 0)
             break;
 
-        bytes = vorbis_interleave_buffer (pcm, bytes, channels, pcmout);
-
         if (update_tuple (& vf, tuple))
             set_playback_tuple (tuple.ref ());
 
@@ -317,19 +343,30 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
              */
             vi = ov_info(&vf, -1);
 
+            if (update_replay_gain (& vf, & rg_info))
+                set_replay_gain (rg_info);
+
+            /* the output is reopened only if the format has changed */
             if (vi->rate != samplerate || vi->channels != channels)
             {
                 samplerate = vi->rate;
                 channels = vi->channels;
 
-                if (update_replay_gain (& vf, & rg_info))
-                    set_replay_gain (rg_info);
-
                 open_audio (FMT_FLOAT, vi->rate, vi->channels);
+
+                if (pcmout.len () < PCM_FRAMES * channels)
+                    pcmout.resize (PCM_FRAMES * channels);
             }
+
+            if (vi->bitrate_nominal > 0)
+                br = vi->bitrate_nominal;
         }
 
-        write_audio (pcmout, bytes);
+        decoded += bytes;
+        bytes = vorbis_interleave_buffer (pcm, bytes, channels, pcmout.begin ());
+        decode_time += std::chrono::steady_clock::now () - start;
+
+        write_audio (pcmout.begin (), bytes);
 
         if (current_section != last_section)
         {
@@ -338,6 +375,10 @@ bool VorbisPlugin::play (const char * filename, VFSFile & file)
         }
     } /* main loop */
 
+    if (samplerate > 0)
+        AUDDBG ("Decoded %.1f s of audio in %.1f ms.\n", (double) decoded / samplerate,
+         std::chrono::duration<double, std::milli> (decode_time).count ());
+
 play_cleanup:
 
     ov_clear(&vf);
@@ -395,12 +395,14 @@ static void prepare_generation(ayemu_ay_t *ay)
  * Fill sound buffer with current register data
  * Return value: pointer to next data in output sound buffer
  * \retval \b 1 if OK, \b 0 if error occures.
+ *
+ * The register data is fixed for the whole call (a player frame is normally
+ * rendered at once), so the generator state is kept in local variables and
+ * everything that depends only on the registers is worked out before the
+ * loop.
  */
 void *ayemu_gen_sound(ayemu_ay_t *ay, void *buff, size_t sound_bufsize)
 {
-  int mix_l, mix_r;
-  int tmpvol;
-  int m;
   int snd_numcount;
   unsigned char *sound_buf = (unsigned char *) buff;
 
@@ -409,56 +411,83 @@ void *ayemu_gen_sound(ayemu_ay_t *ay, void *buff, size_t sound_bufsize)
 
   prepare_generation(ay);
 
+  const int tacts = ay->ChipTacts_per_outcount;
+  const int tone_a = ay->regs.tone_a;
+  const int tone_b = ay->regs.tone_b;
+  const int tone_c = ay->regs.tone_c;
+  const int noise_period = ay->regs.noise * 2;
+  const int env_freq = ay->regs.env_freq;
+  const int *env = Envelope[ay->regs.env_style];
+
+  /* a channel sounds while (tone bit | tone off) & (noise bit | noise off) */
+  const int tone_off_a = !ay->regs.R7_tone_a, noise_off_a = !ay->regs.R7_noise_a;
+  const int tone_off_b = !ay->regs.R7_tone_b, noise_off_b = !ay->regs.R7_noise_b;
+  const int tone_off_c = !ay->regs.R7_tone_c, noise_off_c = !ay->regs.R7_noise_c;
+
+  /* -1 selects the envelope */
+  const int vol_a = ay->regs.env_a ? -1 : ay->regs.vol_a * 2 + 1;
+  const int vol_b = ay->regs.env_b ? -1 : ay->regs.vol_b * 2 + 1;
+  const int vol_c = ay->regs.env_c ? -1 : ay->regs.vol_c * 2 + 1;
+
+  const int *vol_al = ay->vols[0], *vol_ar = ay->vols[1];
+  const int *vol_bl = ay->vols[2], *vol_br = ay->vols[3];
+  const int *vol_cl = ay->vols[4], *vol_cr = ay->vols[5];
+
+  int cnt_a = ay->cnt_a, cnt_b = ay->cnt_b, cnt_c = ay->cnt_c;
+  int cnt_n = ay->cnt_n, cnt_e = ay->cnt_e;
+  int bit_a = ay->bit_a, bit_b = ay->bit_b, bit_c = ay->bit_c, bit_n = ay->bit_n;
+  int env_pos = ay->env_pos;
+  int seed = ay->Cur_Seed;
+
   snd_numcount = sound_bufsize / (ay->sndfmt.channels * (ay->sndfmt.bpc >> 3));
   while (snd_numcount-- > 0) {
-    mix_l = mix_r = 0;
+    int mix_l = 0, mix_r = 0;
 
-    for (m = 0 ; m < ay->ChipTacts_per_outcount ; m++) {
-      if (++ay->cnt_a >= ay->regs.tone_a) {
-	ay->cnt_a = 0;
-	ay->bit_a = ! ay->bit_a;
+    for (int m = 0 ; m < tacts ; m++) {
+      if (++cnt_a >= tone_a) {
+	cnt_a = 0;
+	bit_a = ! bit_a;
       }
-      if (++ay->cnt_b >= ay->regs.tone_b) {
-	ay->cnt_b = 0;
-	ay->bit_b = ! ay->bit_b;
+      if (++cnt_b >= tone_b) {
+	cnt_b = 0;
+	bit_b = ! bit_b;
       }
-      if (++ay->cnt_c >= ay->regs.tone_c) {
-	ay->cnt_c = 0;
-	ay->bit_c = ! ay->bit_c;
+      if (++cnt_c >= tone_c) {
+	cnt_c = 0;
+	bit_c = ! bit_c;
       }
 
       /* GenNoise (c) Hacker KAY & Sergey Bulba */
-      if (++ay->cnt_n >= (ay->regs.noise * 2)) {
-	ay->cnt_n = 0;
-	ay->Cur_Seed = (ay->Cur_Seed * 2 + 1) ^ \
-	  (((ay->Cur_Seed >> 16) ^ (ay->Cur_Seed >> 13)) & 1);
-	ay->bit_n = ((ay->Cur_Seed >> 16) & 1);
+      if (++cnt_n >= noise_period) {
+	cnt_n = 0;
+	seed = (seed * 2 + 1) ^ (((seed >> 16) ^ (seed >> 13)) & 1);
+	bit_n = ((seed >> 16) & 1);
       }
 
-      if (++ay->cnt_e >= ay->regs.env_freq) {
-	ay->cnt_e = 0;
-	if (++ay->env_pos > 127)
-	  ay->env_pos = 64;
+      if (++cnt_e >= env_freq) {
+	cnt_e = 0;
+	if (++env_pos > 127)
+	  env_pos = 64;
       }
 
-#define ENVVOL Envelope [ay->regs.env_style][ay->env_pos]
+      const int envvol = env[env_pos];
 
-      if ((ay->bit_a | !ay->regs.R7_tone_a) & (ay->bit_n | !ay->regs.R7_noise_a)) {
-	tmpvol = (ay->regs.env_a)? ENVVOL : ay->regs.vol_a * 2 + 1;
-	mix_l += ay->vols[0][tmpvol];
-	mix_r += ay->vols[1][tmpvol];
+      if ((bit_a | tone_off_a) & (bit_n | noise_off_a)) {
+	int tmpvol = (vol_a < 0) ? envvol : vol_a;
+	mix_l += vol_al[tmpvol];
+	mix_r += vol_ar[tmpvol];
       }
 
-      if ((ay->bit_b | !ay->regs.R7_tone_b) & (ay->bit_n | !ay->regs.R7_noise_b)) {
-	tmpvol =(ay->regs.env_b)? ENVVOL :  ay->regs.vol_b * 2 + 1;
-	mix_l += ay->vols[2][tmpvol];
-	mix_r += ay->vols[3][tmpvol];
+      if ((bit_b | tone_off_b) & (bit_n | noise_off_b)) {
+	int tmpvol = (vol_b < 0) ? envvol : vol_b;
+	mix_l += vol_bl[tmpvol];
+	mix_r += vol_br[tmpvol];
       }
 
-      if ((ay->bit_c | !ay->regs.R7_tone_c) & (ay->bit_n | !ay->regs.R7_noise_c)) {
-	tmpvol = (ay->regs.env_c)? ENVVOL : ay->regs.vol_c * 2 + 1;
-	mix_l += ay->vols[4][tmpvol];
-	mix_r += ay->vols[5][tmpvol];
+      if ((bit_c | tone_off_c) & (bit_n | noise_off_c)) {
+	int tmpvol = (vol_c < 0) ? envvol : vol_c;
+	mix_l += vol_cl[tmpvol];
+	mix_r += vol_cr[tmpvol];
       }
     } /* end for (m=0; ...) */
 
@@ -480,6 +509,19 @@ void *ayemu_gen_sound(ayemu_ay_t *ay, void *buff, size_t sound_bufsize)
       }
     }
   }
+
+  ay->cnt_a = cnt_a;
+  ay->cnt_b = cnt_b;
+  ay->cnt_c = cnt_c;
+  ay->cnt_n = cnt_n;
+  ay->cnt_e = cnt_e;
+  ay->bit_a = bit_a;
+  ay->bit_b = bit_b;
+  ay->bit_c = bit_c;
+  ay->bit_n = bit_n;
+  ay->env_pos = env_pos;
+  ay->Cur_Seed = seed;
+
   return sound_buf;
 }
 
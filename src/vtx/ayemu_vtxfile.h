@@ -50,9 +50,12 @@ struct VTXFileHeader
 struct ayemu_vtx_t
 {
   VTXFileHeader hdr;             /**< VTX header data */
-  Index<unsigned char> regdata;  /**< unpacked song data */
+  Index<unsigned char> regdata;  /**< unpacked song data, 14 bytes per frame */
   int pos;                       /**< current data frame offset */
 
+  /** Number of AY register frames in #regdata */
+  int num_frames() const { return regdata.len() / 14; }
+
   /** Read vtx file header
       \return Return true if success, else false
   */
@@ -2,7 +2,6 @@
    (c) Haruhiko Okumura
    (m) Roman Scherbakov
 */
-#include <string.h>   /* memmove */
 #include <limits.h>
 
 #include <libaudcore/runtime.h>
@@ -33,7 +32,6 @@ static unsigned short bitbuf;
 
 static unsigned long origsize, compsize;
 static const unsigned char *in_buf;
-static unsigned char *out_buf;
 
 static unsigned short  subbitbuf;
 static int   bitcount;
@@ -272,15 +270,16 @@ static void decode(unsigned short count, unsigned char buffer[])
   }
 }
 
-bool lh5_decode(const Index<char> &in, Index<unsigned char> &out)
+bool lh5_decode(const Index<char> &in, unsigned long size,
+                void (*output)(const unsigned char *data, int len, void *user),
+                void *user)
 {
   unsigned short n;
   Index<unsigned char> buffer;
 
   compsize = in.len();
-  origsize = out.len();
+  origsize = size;
   in_buf = (unsigned char *)in.begin();
-  out_buf = out.begin();
 
   buffer.resize(DICSIZ);
 
@@ -293,8 +292,7 @@ bool lh5_decode(const Index<char> &in, Index<unsigned char> &out)
     while (origsize != 0) {
       n = aud::min(DICSIZ, origsize);
       decode(n, buffer.begin());
-      memmove(out_buf, buffer.begin(), n);
-      out_buf += n;
+      output(buffer.begin(), n, user);
       origsize -= n;
     }
   } catch (DecodeError &) {
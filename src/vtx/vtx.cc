@@ -55,8 +55,9 @@ public:
 
 EXPORT VTXPlugin aud_plugin_instance;
 
-#define SNDBUFSIZE 1024
-static char sndbuf[SNDBUFSIZE];
+/* AY register frames rendered per write_audio() call */
+#define FRAMES_PER_WRITE 5
+
 static int freq = 44100;
 static int chans = 2;
 static int bits = 16;
@@ -81,7 +82,8 @@ bool VTXPlugin::read_tag(const char *filename, VFSFile &file, Tuple &tuple, Inde
     tuple.set_str(Tuple::Artist, tmp.hdr.author);
     tuple.set_str(Tuple::Title, tmp.hdr.title);
 
-    tuple.set_int(Tuple::Length, tmp.hdr.regdata_size / 14 * 1000 / 50);
+    if (tmp.hdr.playerFreq > 0)
+        tuple.set_int(Tuple::Length, tmp.hdr.regdata_size / 14 * 1000 / tmp.hdr.playerFreq);
 
     tuple.set_str(Tuple::Genre, (tmp.hdr.chiptype == AYEMU_AY) ? "AY chiptunes" : "YM chiptunes");
     tuple.set_str(Tuple::Album, tmp.hdr.from);
@@ -101,16 +103,8 @@ bool VTXPlugin::play(const char *filename, VFSFile &file)
     ayemu_ay_t ay;
     ayemu_vtx_t vtx;
 
-    bool eof = false;
-    void *stream;               /* pointer to current position in sound buffer */
     unsigned char regs[14];
-    int need;
-    int left;                   /* how many sound frames can play with current AY register frame */
-    int donow;
-    int rate;
-
-    left = 0;
-    rate = chans * (bits / 8);
+    int rate = chans * (bits / 8);
 
     memset(&ay, 0, sizeof(ay));
 
@@ -119,6 +113,11 @@ bool VTXPlugin::play(const char *filename, VFSFile &file)
         AUDERR("Error read vtx header from %s\n", filename);
         return false;
     }
+    else if (vtx.hdr.playerFreq <= 0)
+    {
+        AUDERR("Invalid player frequency in %s\n", filename);
+        return false;
+    }
     else if (!vtx.load_data(file))
     {
         AUDERR("Error read vtx data from %s\n", filename);
@@ -130,45 +129,40 @@ bool VTXPlugin::play(const char *filename, VFSFile &file)
     ayemu_set_chip_freq(&ay, vtx.hdr.chipFreq);
     ayemu_set_stereo(&ay, (ayemu_stereo_t) vtx.hdr.stereo, nullptr);
 
-    set_stream_bitrate(14 * 50 * 8);
+    set_stream_bitrate(14 * vtx.hdr.playerFreq * 8);
     open_audio(FMT_S16_NE, freq, chans);
 
+    /* each AY register frame is rendered in one go */
+    int frame_bytes = freq / vtx.hdr.playerFreq * rate;
+
+    Index<char> sndbuf;
+    sndbuf.resize(frame_bytes * FRAMES_PER_WRITE);
+
+    bool eof = false;
+
     while (!check_stop() && !eof)
     {
-        /* (time in sec) * 50 = offset in AY register data frames */
+        /* time in ms * playerFreq / 1000 = offset in AY register data frames */
         int seek_value = check_seek();
         if (seek_value >= 0)
-            vtx.pos = seek_value / 20;
+            vtx.pos = (int64_t) seek_value * vtx.hdr.playerFreq / 1000;
 
-        /* fill sound buffer */
-        stream = sndbuf;
+        char *stream = sndbuf.begin();
 
-        for (need = SNDBUFSIZE / rate; need > 0; need -= donow)
+        for (int i = 0; i < FRAMES_PER_WRITE; i++)
         {
-            if (left > 0)
-            {                   /* use current AY register frame */
-                donow = (need > left) ? left : need;
-                left -= donow;
-                stream = ayemu_gen_sound(&ay, (char *)stream, donow * rate);
-            }
-            else
-            {                   /* get next AY register frame */
-                if (!vtx.get_next_frame(regs))
-                {
-                    donow = need;
-                    memset(stream, 0, donow * rate);
-                    eof = true;
-                }
-                else
-                {
-                    left = freq / vtx.hdr.playerFreq;
-                    ayemu_set_regs(&ay, regs);
-                    donow = 0;
-                }
+            if (!vtx.get_next_frame(regs))
+            {
+                eof = true;
+                break;
             }
+
+            ayemu_set_regs(&ay, regs);
+            stream = (char *)ayemu_gen_sound(&ay, stream, frame_bytes);
         }
 
-        write_audio(sndbuf, SNDBUFSIZE);
+        if (stream > sndbuf.begin())
+            write_audio(sndbuf.begin(), stream - sndbuf.begin());
     }
 
     return true;
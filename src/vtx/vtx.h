@@ -9,6 +9,9 @@ class VFSFile;
 void vtx_file_info (const char *filename, VFSFile &file);
 
 /* lh5dec.cc */
-bool lh5_decode(const Index<char> &in, Index<unsigned char> &out);
+/* Unpacks <size> bytes, passing them to <output> one window (8 KiB) at a time. */
+bool lh5_decode(const Index<char> &in, unsigned long size,
+                void (*output)(const unsigned char *data, int len, void *user),
+                void *user);
 
 #endif
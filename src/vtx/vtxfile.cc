@@ -115,18 +115,50 @@ bool ayemu_vtx_t::read_header(VFSFile &file)
   return !error;
 }
 
+/* The register data is stored by register: the values of R0 for all frames,
+ * then R1 and so on.  It is rearranged into 14-byte frames while it is
+ * unpacked, so that a frame can be fetched (or seeked to) directly.
+ */
+struct FrameWriter
+{
+  unsigned char *frames;
+  int numframes;
+  int reg, frame;
+};
+
+static void write_frames(const unsigned char *data, int len, void *user)
+{
+  FrameWriter *w = (FrameWriter *)user;
+
+  for (int i = 0; i < len && w->reg < 14; i++) {
+    w->frames[w->frame * 14 + w->reg] = data[i];
+    if (++w->frame == w->numframes) {
+      w->frame = 0;
+      w->reg++;
+    }
+  }
+}
+
 /** Read and encode lha data from .vtx file
  *
- * Return value: pointer to unpacked data or nullptr
- * Note: you must call ayemu_vtx_open() first.
+ * Return value: true if success, else false
+ * Note: you must call read_header() first.
  */
 bool ayemu_vtx_t::load_data(VFSFile &file)
 {
+  int numframes = hdr.regdata_size / 14;
+  if (numframes < 1) {
+    AUDERR("No register data in %s\n", file.filename());
+    return false;
+  }
+
   /* read packed AY register data to end of file. */
   Index<char> packed_data = file.read_all();
 
-  regdata.resize(hdr.regdata_size);
-  if (!lh5_decode(packed_data, regdata))
+  regdata.resize(numframes * 14);
+
+  FrameWriter writer = {regdata.begin(), numframes, 0, 0};
+  if (!lh5_decode(packed_data, hdr.regdata_size, write_frames, &writer))
     return false;
 
   pos = 0;
@@ -139,16 +171,12 @@ bool ayemu_vtx_t::load_data(VFSFile &file)
  */
 bool ayemu_vtx_t::get_next_frame(unsigned char *regs)
 {
-  int numframes = hdr.regdata_size / 14;
-  if (pos++ >= numframes)
-    return 0;
-  else {
-    int n;
-    unsigned char *p = &regdata[pos];
-    for(n = 0 ; n < 14 ; n++, p+=numframes)
-      regs[n] = *p;
-    return 1;
-  }
+  if (pos < 0 || pos >= num_frames())
+    return false;
+
+  memcpy(regs, &regdata[pos * 14], 14);
+  pos++;
+  return true;
 }
 
 /** Print formatted file name. If fmt is nullptr the default format %a - %t will be used
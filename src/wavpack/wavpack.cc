@@ -10,7 +10,13 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/audstrings.h>
 
-#define BUFFER_SIZE 256 /* read buffer size, in samples / frames */
+#include "../decoder-common/sample-pack.h"
+
+/* decode about 100 ms at a time, within these limits (in frames / samples) */
+#define MIN_BLOCK_FRAMES 1024
+#define MAX_BLOCK_FRAMES 16384
+#define MAX_BLOCK_SAMPLES 65536
+
 #define SAMPLE_SIZE(a) (a <= 8 ? sizeof(uint8_t) : (a <= 16 ? sizeof(uint16_t) : sizeof(uint32_t)))
 #define SAMPLE_FMT(a) (a <= 8 ? FMT_S8 : (a <= 16 ? FMT_S16_NE : (a <= 24 ? FMT_S24_NE : FMT_S32_NE)))
 
@@ -147,11 +153,16 @@ bool WavpackPlugin::play (const char * filename, VFSFile & file)
     else
         open_audio(SAMPLE_FMT(bits_per_sample), sample_rate, num_channels);
 
+    int block_frames = aud::clamp (sample_rate / 10, MIN_BLOCK_FRAMES, MAX_BLOCK_FRAMES);
+    block_frames = aud::max (aud::min (block_frames, MAX_BLOCK_SAMPLES / num_channels), 1);
+
     Index<int32_t> input;
-    input.resize (BUFFER_SIZE * num_channels);
+    input.resize (block_frames * num_channels);
 
+    /* 32-bit samples are written out as decoded */
     Index<char> output;
-    output.resize (BUFFER_SIZE * num_channels * SAMPLE_SIZE (bits_per_sample));
+    if (SAMPLE_SIZE (bits_per_sample) < sizeof (int32_t))
+        output.resize (block_frames * num_channels * SAMPLE_SIZE (bits_per_sample));
 
     while (! check_stop ())
     {
@@ -165,39 +176,28 @@ bool WavpackPlugin::play (const char * filename, VFSFile & file)
         if (samples_left == 0)
             break;
 
-        int ret = WavpackUnpackSamples (ctx, input.begin (), BUFFER_SIZE);
+        int ret = WavpackUnpackSamples (ctx, input.begin (), block_frames);
 
         if (ret < 0)
         {
             AUDERR ("Error decoding file.\n");
             break;
         }
+        else if (ret == 0)
+            break;
         else
         {
             /* Perform audio data conversion and output */
-            int32_t * rp = input.begin ();
-            int8_t * wp = (int8_t *) output.begin ();
-            int16_t * wp2 = (int16_t *) output.begin ();
-            int32_t * wp4 = (int32_t *) output.begin ();
+            int samples = ret * num_channels;
 
-            if (bits_per_sample <= 8)
+            if (output.len ())
             {
-                for (int i = 0; i < ret * num_channels; i++, wp++, rp++)
-                    *wp = *rp & 0xff;
-            }
-            else if (bits_per_sample <= 16)
-            {
-                for (int i = 0; i < ret * num_channels; i++, wp2++, rp++)
-                    *wp2 = *rp & 0xffff;
+                sample_pack::pack_interleaved (input.begin (), samples,
+                 output.begin (), bits_per_sample);
+                write_audio (output.begin (), samples * SAMPLE_SIZE (bits_per_sample));
             }
             else
-            {
-                for (int i = 0; i < ret * num_channels; i++, wp4++, rp++)
-                    *wp4 = *rp;
-            }
-
-            write_audio (output.begin (),
-             ret * num_channels * SAMPLE_SIZE (bits_per_sample));
+                write_audio (input.begin (), samples * sizeof (int32_t));
         }
     }
 